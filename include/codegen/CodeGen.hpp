@@ -6,7 +6,13 @@
 
 class CodeGen {
   public:
-    explicit CodeGen(Module *module) : m(module) {}
+    /**
+     * @param bound_check_trap 把数组下标为负的检查翻译为 asrtle.d，
+     *        下标为负时由运行时库的 SIGSEGV 处理函数输出异常信息；
+     *        main 入口调用 __bound_check_init 安装该处理函数
+     */
+    explicit CodeGen(Module *module, bool bound_check_trap = false)
+        : m(module), bound_check_trap(bound_check_trap) {}
 
     std::string print() const;
 
@@ -49,7 +55,17 @@ class CodeGen {
     void gen_prologue();
     void gen_ret();
     void gen_br();
+    // 数组下标检查 br (idx < 0), exceptBB, cont
+    bool is_bound_check(Instruction *inst);
+    // 只被下标检查使用、不需要翻译的比较
+    bool is_bound_check_cond(Instruction *inst);
+    // 所有前驱都是被翻译为 asrtle.d 的下标检查，不需要翻译的 exceptBB
+    bool is_trapped_except_block(BasicBlock *bb);
     void gen_binary();
+    bool gen_binary_imm(int32_t);
+    // 乘除常量的强度削弱，按延迟估计不划算时返回 false
+    bool gen_mul_by_const(int32_t);
+    bool gen_sdiv_by_const(int32_t);
     void gen_float_binary();
     void gen_alloca();
     void gen_load();
@@ -79,6 +95,7 @@ class CodeGen {
         /* 随着ir遍历设置 */
         Function *func{nullptr};    // 当前函数
         BasicBlock *bb{nullptr};    // 当前基本块
+        BasicBlock *next_bb{nullptr}; // 下一个输出的基本块
         Instruction *inst{nullptr}; // 当前指令
         /* 在allocate()中设置 */
         unsigned frame_size{0}; // 当前函数的栈帧大小
@@ -88,6 +105,7 @@ class CodeGen {
         void clear() {
             func = nullptr;
             bb = nullptr;
+            next_bb = nullptr;
             inst = nullptr;
             frame_size = 0;
             fcmp_cnt = 0;
@@ -97,5 +115,6 @@ class CodeGen {
     } context;
 
     Module *m;
+    bool bound_check_trap;
     std::list<ASMInstruction> output;
 };
@@ -20,6 +20,12 @@ inline bool IS_IMM_12(int x) { return x <= IMM_12_MAX and x >= IMM_12_MIN; }
 #define PROLOGUE_OFFSET_BASE 16 // $ra $fp
 #define PROLOGUE_ALIGN 16
 
+/* 指令延迟（周期），用于选择乘除常量的指令序列
+ * div.w 的延迟随操作数变化，取一个保守的估计 */
+#define LATENCY_ALU 1
+#define LATENCY_MUL 4
+#define LATENCY_DIV 12
+
 /* 龙芯指令 */
 // Arithmetic
 #define ADD "add"
@@ -0,0 +1,119 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+/**
+ * 定长的稠密位向量，用于数据流分析中的集合运算
+ *
+ * 以 64 位为一个字存储，并、交、差都按字进行。
+ * 参与运算的两个位向量长度必须相同。
+ */
+class BitVector {
+  public:
+    BitVector() = default;
+    explicit BitVector(unsigned size, bool value = false) {
+        resize(size, value);
+    }
+
+    unsigned size() const { return size_; }
+
+    void resize(unsigned size, bool value = false) {
+        size_ = size;
+        words_.assign((size + 63) / 64, value ? ~uint64_t{0} : 0);
+        clear_unused_bits();
+    }
+
+    bool test(unsigned i) const { return (words_[i / 64] >> (i % 64)) & 1; }
+    void set(unsigned i) { words_[i / 64] |= uint64_t{1} << (i % 64); }
+    void reset(unsigned i) { words_[i / 64] &= ~(uint64_t{1} << (i % 64)); }
+    void set() {
+        for (auto &w : words_)
+            w = ~uint64_t{0};
+        clear_unused_bits();
+    }
+    void reset() {
+        for (auto &w : words_)
+            w = 0;
+    }
+
+    bool any() const {
+        for (auto w : words_)
+            if (w)
+                return true;
+        return false;
+    }
+    bool none() const { return not any(); }
+    unsigned count() const {
+        unsigned n = 0;
+        for (auto w : words_)
+            n += __builtin_popcountll(w);
+        return n;
+    }
+
+    // 返回 >= from 的第一个置位的下标，不存在时返回 size()
+    unsigned find_next(unsigned from) const {
+        if (from >= size_)
+            return size_;
+        unsigned idx = from / 64;
+        uint64_t w = words_[idx] & (~uint64_t{0} << (from % 64));
+        while (true) {
+            if (w)
+                return idx * 64 + __builtin_ctzll(w);
+            if (++idx == words_.size())
+                return size_;
+            w = words_[idx];
+        }
+    }
+    unsigned find_first() const { return find_next(0); }
+
+    // 依次访问所有置位的下标
+    template <typename Fn> void for_each(Fn &&fn) const {
+        for (unsigned i = find_first(); i < size_; i = find_next(i + 1))
+            fn(i);
+    }
+
+    // 集合运算，返回自身是否发生变化
+    bool operator|=(const BitVector &rhs) {
+        bool changed = false;
+        for (unsigned i = 0; i < words_.size(); ++i) {
+            auto w = words_[i] | rhs.words_[i];
+            changed |= w != words_[i];
+            words_[i] = w;
+        }
+        return changed;
+    }
+    bool operator&=(const BitVector &rhs) {
+        bool changed = false;
+        for (unsigned i = 0; i < words_.size(); ++i) {
+            auto w = words_[i] & rhs.words_[i];
+            changed |= w != words_[i];
+            words_[i] = w;
+        }
+        return changed;
+    }
+    // this = this - rhs
+    bool reset(const BitVector &rhs) {
+        bool changed = false;
+        for (unsigned i = 0; i < words_.size(); ++i) {
+            auto w = words_[i] & ~rhs.words_[i];
+            changed |= w != words_[i];
+            words_[i] = w;
+        }
+        return changed;
+    }
+
+    bool operator==(const BitVector &rhs) const {
+        return size_ == rhs.size_ && words_ == rhs.words_;
+    }
+    bool operator!=(const BitVector &rhs) const { return not(*this == rhs); }
+
+  private:
+    void clear_unused_bits() {
+        if (size_ % 64 != 0)
+            words_.back() &= (uint64_t{1} << (size_ % 64)) - 1;
+    }
+
+    unsigned size_{0};
+    std::vector<uint64_t> words_;
+};
@@ -35,10 +35,33 @@ class BasicBlock : public Value, public llvm::ilist_node<BasicBlock> {
     bool is_terminated() const;
     // Get terminator, only accept valid case use
     Instruction *get_terminator();
+    // IRBuilder 生成的 exceptBB：以调用 neg_idx_except 开始，之后程序结束
+    bool is_except_block();
 
     /****************api about Instruction****************/
     void add_instruction(Instruction *instr);
     void add_instr_begin(Instruction *instr) { instr_list_.push_front(instr); }
+    // 插入到 pos 之前 / 终结指令之前
+    void insert_instr_before(Instruction *pos, Instruction *instr);
+    void add_instr_before_terminator(Instruction *instr) {
+        insert_instr_before(get_terminator(), instr);
+    }
+    // 指令的 create 接口总是把新指令加到块尾，且不允许块已有终结指令；
+    // 这里临时摘下终结指令，用 create(this) 创建后再移动到 pos 之前
+    template <typename Fn>
+    auto create_instr_before(Instruction *pos, Fn &&create) {
+        Instruction *term = nullptr;
+        if (is_terminated()) {
+            term = get_terminator();
+            instr_list_.remove(term);
+        }
+        auto instr = create(this);
+        instr_list_.remove(instr);
+        if (term != nullptr)
+            instr_list_.push_back(term);
+        insert_instr_before(pos, instr);
+        return instr;
+    }
     void erase_instr(Instruction *instr) { instr_list_.erase(instr); }
     void remove_instr(Instruction *instr) { instr_list_.remove(instr); }
 
@@ -43,6 +43,16 @@ class Function : public Value, public llvm::ilist_node<Function> {
     std::list<Argument> &get_args() { return arguments_; }
 
     bool is_declaration() { return basic_blocks_.empty(); }
+    // 数组下标为负时调用的运行时函数，它输出信息后终止程序
+    bool is_neg_idx_except() const { return get_name() == "neg_idx_except"; }
+
+    // profile 中函数被调用的次数，-fprofile-use 时设置
+    bool has_entry_count() const { return has_entry_count_; }
+    unsigned long get_entry_count() const { return entry_count_; }
+    void set_entry_count(unsigned long count) {
+        has_entry_count_ = true;
+        entry_count_ = count;
+    }
 
     void set_instr_name();
     std::string print();
@@ -52,6 +62,8 @@ class Function : public Value, public llvm::ilist_node<Function> {
     std::list<Argument> arguments_;
     Module *parent_;
     unsigned seq_cnt_; // print use
+    bool has_entry_count_{false};
+    unsigned long entry_count_{0};
 };
 
 // Argument of Function, does not contain actual value
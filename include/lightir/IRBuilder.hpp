@@ -30,6 +30,28 @@ class IRBuilder {
     IBinaryInst *create_isdiv(Value *lhs, Value *rhs) {
         return IBinaryInst::create_sdiv(lhs, rhs, this->BB_);
     }
+    IBinaryInst *create_isrem(Value *lhs, Value *rhs) {
+        return IBinaryInst::create_srem(lhs, rhs, this->BB_);
+    }
+    // 移位与按位运算
+    IBinaryInst *create_shl(Value *lhs, Value *rhs) {
+        return IBinaryInst::create_shl(lhs, rhs, this->BB_);
+    }
+    IBinaryInst *create_ashr(Value *lhs, Value *rhs) {
+        return IBinaryInst::create_ashr(lhs, rhs, this->BB_);
+    }
+    IBinaryInst *create_lshr(Value *lhs, Value *rhs) {
+        return IBinaryInst::create_lshr(lhs, rhs, this->BB_);
+    }
+    IBinaryInst *create_and(Value *lhs, Value *rhs) {
+        return IBinaryInst::create_and(lhs, rhs, this->BB_);
+    }
+    IBinaryInst *create_or(Value *lhs, Value *rhs) {
+        return IBinaryInst::create_or(lhs, rhs, this->BB_);
+    }
+    IBinaryInst *create_xor(Value *lhs, Value *rhs) {
+        return IBinaryInst::create_xor(lhs, rhs, this->BB_);
+    }
 
     ICmpInst *create_icmp_eq(Value *lhs, Value *rhs) {
         return ICmpInst::create_eq(lhs, rhs, this->BB_);
@@ -4,6 +4,7 @@
 #include "User.hpp"
 
 #include <cstdint>
+#include <utility>
 #include <llvm/ADT/ilist_node.h>
 
 class BasicBlock;
@@ -20,6 +21,14 @@ class Instruction : public User, public llvm::ilist_node<Instruction> {
         sub,
         mul,
         sdiv,
+        srem,
+        // Shift and bitwise operators
+        shl,
+        ashr, // arithmetic shift right
+        lshr, // logical shift right
+        and_, // and/or/xor 是 C++ 的保留字
+        or_,
+        xor_,
         // float binary operators
         fadd,
         fsub,
@@ -86,6 +95,15 @@ class Instruction : public User, public llvm::ilist_node<Instruction> {
     bool is_sub() const { return op_id_ == sub; }
     bool is_mul() const { return op_id_ == mul; }
     bool is_div() const { return op_id_ == sdiv; }
+    bool is_rem() const { return op_id_ == srem; }
+    bool is_shl() const { return op_id_ == shl; }
+    bool is_ashr() const { return op_id_ == ashr; }
+    bool is_lshr() const { return op_id_ == lshr; }
+    bool is_and() const { return op_id_ == and_; }
+    bool is_or() const { return op_id_ == or_; }
+    bool is_xor() const { return op_id_ == xor_; }
+    bool is_shift() const { return shl <= op_id_ and op_id_ <= lshr; }
+    bool is_bitwise() const { return and_ <= op_id_ and op_id_ <= xor_; }
 
     bool is_fadd() const { return op_id_ == fadd; }
     bool is_fsub() const { return op_id_ == fsub; }
@@ -102,8 +120,9 @@ class Instruction : public User, public llvm::ilist_node<Instruction> {
     bool is_zext() const { return op_id_ == zext; }
 
     bool isBinary() const {
-        return (is_add() || is_sub() || is_mul() || is_div() || is_fadd() ||
-                is_fsub() || is_fmul() || is_fdiv()) &&
+        return (is_add() || is_sub() || is_mul() || is_div() || is_rem() ||
+                is_shift() || is_bitwise() || is_fadd() || is_fsub() ||
+                is_fmul() || is_fdiv()) &&
                (get_num_operand() == 2);
     }
 
@@ -135,6 +154,13 @@ class IBinaryInst : public BaseInst<IBinaryInst> {
     static IBinaryInst *create_sub(Value *v1, Value *v2, BasicBlock *bb);
     static IBinaryInst *create_mul(Value *v1, Value *v2, BasicBlock *bb);
     static IBinaryInst *create_sdiv(Value *v1, Value *v2, BasicBlock *bb);
+    static IBinaryInst *create_srem(Value *v1, Value *v2, BasicBlock *bb);
+    static IBinaryInst *create_shl(Value *v1, Value *v2, BasicBlock *bb);
+    static IBinaryInst *create_ashr(Value *v1, Value *v2, BasicBlock *bb);
+    static IBinaryInst *create_lshr(Value *v1, Value *v2, BasicBlock *bb);
+    static IBinaryInst *create_and(Value *v1, Value *v2, BasicBlock *bb);
+    static IBinaryInst *create_or(Value *v1, Value *v2, BasicBlock *bb);
+    static IBinaryInst *create_xor(Value *v1, Value *v2, BasicBlock *bb);
 
     virtual std::string print() override;
 };
@@ -199,7 +225,19 @@ class CallInst : public BaseInst<CallInst> {
                                  BasicBlock *bb);
     FunctionType *get_function_type() const;
 
+    // profile 中调用点的执行次数，-fprofile-use 时设置
+    bool has_profile_count() const { return has_profile_count_; }
+    unsigned long get_profile_count() const { return profile_count_; }
+    void set_profile_count(unsigned long count) {
+        has_profile_count_ = true;
+        profile_count_ = count;
+    }
+
     virtual std::string print() override;
+
+  private:
+    bool has_profile_count_{false};
+    unsigned long profile_count_{0};
 };
 
 class BranchInst : public BaseInst<BranchInst> {
@@ -219,7 +257,24 @@ class BranchInst : public BaseInst<BranchInst> {
 
     Value *get_condition() const { return get_operand(0); }
 
+    // 分支权重：profile 中跳向真、假目标的次数，-fprofile-use 时设置
+    bool has_branch_weights() const { return has_weights_; }
+    std::pair<unsigned long, unsigned long> get_branch_weights() const {
+        return {true_weight_, false_weight_};
+    }
+    void set_branch_weights(unsigned long true_weight,
+                            unsigned long false_weight) {
+        has_weights_ = true;
+        true_weight_ = true_weight;
+        false_weight_ = false_weight;
+    }
+
     virtual std::string print() override;
+
+  private:
+    bool has_weights_{false};
+    unsigned long true_weight_{0};
+    unsigned long false_weight_{0};
 };
 
 class ReturnInst : public BaseInst<ReturnInst> {
@@ -0,0 +1,61 @@
+#pragma once
+
+#include "CallGraph.hpp"
+#include "Instruction.hpp"
+#include "PassManager.hpp"
+
+#include <map>
+
+/**
+ * 基本的别名分析
+ *
+ * 把指针分解为 基址 + Σ 变量下标 × 步长 + 常量偏移（字节），
+ * 基址再沿 mem2reg 之前保存数组参数的局部变量追溯到底层对象：
+ * alloca、全局变量或函数参数。
+ *   - 两个不同的 alloca/全局变量互不别名；alloca、标量全局变量与参数也互不别名
+ *   - 基址与变量部分都相同时，比较常量偏移得到 MustAlias 或 NoAlias
+ *   - 其余情况为 MayAlias
+ * 对 call 的 mod/ref 查询基于 CallGraph 的副作用摘要。
+ */
+enum class AliasResult { NoAlias, MayAlias, MustAlias };
+
+enum ModRefInfo : unsigned {
+    NoModRef = 0,
+    Ref = 1,
+    Mod = 2,
+    ModRef = Ref | Mod,
+};
+
+class AliasAnalysis : public Pass {
+  public:
+    // ptr = base + Σ var × scale + offset
+    struct DecomposedPointer {
+        Value *base{nullptr};
+        std::map<Value *, long> var_indices;
+        long offset{0};
+    };
+
+    explicit AliasAnalysis(Module *m) : Pass(m), call_graph_(m) {}
+    ~AliasAnalysis() = default;
+    // 计算调用图摘要，函数体变化后需重新运行
+    void run() override { call_graph_.run(); }
+
+    AliasResult alias(Value *p1, Value *p2);
+    // inst 是否可能读 (Ref) / 写 (Mod) ptr 指向的位置
+    ModRefInfo get_mod_ref(Instruction *inst, Value *ptr);
+    // ptr 指向的 4 字节是否一定在某个 alloca/全局变量的范围内
+    bool is_known_dereferenceable(Value *ptr);
+
+    static DecomposedPointer decompose(Value *ptr);
+    // 底层对象：alloca、全局变量或参数；无法确定时返回 nullptr
+    static Value *get_underlying_object(Value *ptr);
+    // 是否是可以与其他对象区分开的对象 (alloca 或全局变量)
+    static bool is_identified_object(Value *obj);
+
+    const CallGraph &get_call_graph() const { return call_graph_; }
+
+  private:
+    ModRefInfo get_call_mod_ref(CallInst *call, Value *ptr);
+
+    CallGraph call_graph_;
+};
@@ -0,0 +1,69 @@
+#pragma once
+
+#include "BitVector.hpp"
+#include "DataFlow.hpp"
+#include "Instruction.hpp"
+#include "PassManager.hpp"
+
+#include <map>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+/**
+ * 可用表达式分析
+ *
+ * 表达式由 (操作码, 操作数) 确定，可交换运算的操作数按固定顺序排列，
+ * 因此不同指令只要计算同一个表达式就共享同一个编号。
+ * 参与分析的有算术、比较、类型转换、getelementptr 与 load；
+ * load 会被 store 和函数调用杀死（不区分地址）；在循环中，指令（包括 phi）
+ * 每次执行都会给自己的值重新定值，使用到它的表达式也随之被杀死。
+ */
+class AvailableExpressions : public Pass {
+  public:
+    using Expression = std::pair<Instruction::OpID, std::vector<Value *>>;
+
+    explicit AvailableExpressions(Module *m) : Pass(m) {}
+    ~AvailableExpressions() = default;
+    void run() override;
+    void run_on_func(Function *f);
+
+    unsigned get_num_expressions() const { return exprs_.size(); }
+    const Expression &get_expression(unsigned idx) const {
+        return exprs_.at(idx);
+    }
+    // inst 计算的表达式编号，不参与分析的指令返回 -1
+    int get_expression_index(Instruction *inst) const {
+        auto it = inst_expr_.find(inst);
+        return it == inst_expr_.end() ? -1 : static_cast<int>(it->second);
+    }
+
+    // 块开头/末尾处在所有路径上都已计算过的表达式
+    const BitVector &get_available_in(BasicBlock *bb) const {
+        return in_.at(bb);
+    }
+    const BitVector &get_available_out(BasicBlock *bb) const {
+        return out_.at(bb);
+    }
+    // 执行 inst 之前，它计算的表达式是否已经可用
+    bool is_available(Instruction *inst) const;
+
+  private:
+    struct Problem;
+
+    static bool is_candidate(Instruction *inst);
+    static bool kills_loads(Instruction *inst) {
+        return inst->is_store() or inst->is_call();
+    }
+
+    std::vector<Expression> exprs_;
+    std::map<Expression, unsigned> expr_index_;
+    std::unordered_map<Instruction *, unsigned> inst_expr_;
+    BitVector load_exprs_;
+    // 以某个值为操作数的表达式，该值被（循环中）重新定值时它们失效
+    std::unordered_map<Value *, BitVector> expr_users_;
+    std::unordered_map<BasicBlock *, BitVector> gen_;
+    std::unordered_map<BasicBlock *, BitVector> kill_;
+    std::unordered_map<BasicBlock *, BitVector> in_;
+    std::unordered_map<BasicBlock *, BitVector> out_;
+};
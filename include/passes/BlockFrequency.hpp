@@ -0,0 +1,43 @@
+#pragma once
+
+#include "BranchProbability.hpp"
+#include "PassManager.hpp"
+
+#include <memory>
+#include <unordered_map>
+
+/**
+ * 块频率：每个块相对于函数入口的期望执行次数
+ *
+ * 由 BranchProbability 的边概率传播得到。按逆后序，块的频率是各个前驱
+ * 的频率与边概率之积的和，回边不参与传播；循环 header 再乘以循环的
+ * 放大倍数 1 / (1 - p)，p 为从 header 出发、回到 header 的概率
+ * （把 header 的频率当作 1 在循环内传播后，各回边的频率之和）。
+ * 内层循环先求，其倍数在外层循环内传播时已生效。
+ * 倍数不超过 MAX_LOOP_SCALE，以免回边概率接近 1 的循环得到无穷大的频率。
+ */
+class BlockFrequency : public Pass {
+  public:
+    explicit BlockFrequency(Module *m)
+        : Pass(m), bpi_(std::make_unique<BranchProbability>(m)) {}
+    ~BlockFrequency() = default;
+    void run() override;
+
+    // 不可达的块频率为 0
+    double get_freq(BasicBlock *bb);
+    double get_edge_freq(BasicBlock *from, BasicBlock *to) {
+        return get_freq(from) * bpi_->get_edge_prob(from, to);
+    }
+    BranchProbability &get_branch_probability() { return *bpi_; }
+
+  private:
+    void run_on_func(Function *f);
+    // 以 entry 为起点（频率为 1）在 loop 内传播，loop 为空时在整个函数中传播
+    std::unordered_map<BasicBlock *, double>
+    propagate(const std::vector<BasicBlock *> &rpo, BasicBlock *entry,
+              Loop *loop);
+
+    std::unique_ptr<BranchProbability> bpi_;
+    std::unordered_map<BasicBlock *, double> scales_;
+    std::unordered_map<BasicBlock *, double> freqs_;
+};
@@ -0,0 +1,35 @@
+#pragma once
+
+#include "BlockFrequency.hpp"
+#include "PassManager.hpp"
+
+#include <memory>
+#include <unordered_set>
+
+/**
+ * 基本块布局：让热路径顺序执行，冷块移到函数末尾
+ *
+ * CodeGen 按函数中块的顺序输出，跳向紧随其后的块的分支可以省去。
+ * 从入口开始贪心地拼接链：当前块之后放边频率最高、且除回边外的前驱都已
+ * 放好的后继；没有这样的后继时取逆后序中下一个未放的块。
+ * BranchProbability 认为冷的块，以及频率低于入口 COLD_FREQ 倍的块，
+ * 按逆后序放在函数最后；不可达的块保持原来的相对顺序放在最后。
+ */
+class BlockPlacement : public Pass {
+  public:
+    explicit BlockPlacement(Module *m)
+        : Pass(m), freq_(std::make_unique<BlockFrequency>(m)) {}
+    ~BlockPlacement() = default;
+    void run() override;
+
+  private:
+    void place(Function *f);
+    bool is_cold(BasicBlock *bb);
+    // bb 之后最适合放的后继，没有时返回 nullptr
+    BasicBlock *best_successor(BasicBlock *bb);
+
+    std::unique_ptr<BlockFrequency> freq_;
+    std::unordered_set<BasicBlock *> reachable_;
+    std::unordered_set<BasicBlock *> placed_;
+    unsigned moved_{0};
+};
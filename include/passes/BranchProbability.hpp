@@ -0,0 +1,51 @@
+#pragma once
+
+#include "LoopDetection.hpp"
+#include "PassManager.hpp"
+
+#include <map>
+#include <memory>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+
+/**
+ * 分支概率
+ *
+ * 条件跳转带有 profile 的分支权重（-fprofile-use）且执行过时按权重计算；
+ * 否则按以下启发式依次为两条出边估计概率：
+ * 1. 冷块：调用不返回的运行时函数（neg_idx_except）的块，以及所有后继
+ *    都是冷块的块。只有一条出边通向冷块时，该边的概率为 COLD_PROB。
+ * 2. 循环：一条出边是回边、或留在最内层循环中而另一条离开循环时，
+ *    留在循环中的边的概率为 LOOP_TAKEN_PROB。
+ * 3. 其余的条件跳转两条出边各占一半。
+ * 无条件跳转的出边概率为 1。
+ */
+class BranchProbability : public Pass {
+  public:
+    explicit BranchProbability(Module *m)
+        : Pass(m), loop_detection_(std::make_unique<LoopDetection>(m)) {}
+    ~BranchProbability() = default;
+    void run() override;
+
+    // 从 from 跳向 to 的概率，to 不是 from 的后继时为 0
+    double get_edge_prob(BasicBlock *from, BasicBlock *to);
+    bool is_cold(BasicBlock *bb) { return cold_.count(bb) != 0; }
+    // to 是包含 from 的循环的 header
+    bool is_back_edge(BasicBlock *from, BasicBlock *to);
+    // 以 bb 为 header 的循环，bb 不是 header 时返回 nullptr
+    std::shared_ptr<Loop> get_loop_of_header(BasicBlock *bb);
+    // 包含 bb 的最内层循环，不在循环中时返回 nullptr
+    std::shared_ptr<Loop> get_innermost_loop(BasicBlock *bb);
+    LoopDetection &get_loop_detection() { return *loop_detection_; }
+
+  private:
+    void compute_cold(Function *f);
+    void compute_probs(BasicBlock *bb);
+
+    std::unique_ptr<LoopDetection> loop_detection_;
+    std::unordered_map<BasicBlock *, std::shared_ptr<Loop>> headers_;
+    std::unordered_map<BasicBlock *, std::shared_ptr<Loop>> innermost_;
+    std::unordered_set<BasicBlock *> cold_;
+    std::map<std::pair<BasicBlock *, BasicBlock *>, double> probs_;
+};
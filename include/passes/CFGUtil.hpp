@@ -0,0 +1,42 @@
+#pragma once
+
+#include "BasicBlock.hpp"
+
+#include <vector>
+
+/**
+ * 控制流图的编辑
+ *
+ * 这些函数同时维护终结指令的操作数、前驱/后继列表与 phi 的入边，
+ * 供需要改动控制流的变换共用。
+ */
+
+// 把 pred 跳向 old_succ 的边改为跳向 new_succ；不修改两者的 phi
+void replace_successor(BasicBlock *pred, BasicBlock *old_succ,
+                       BasicBlock *new_succ);
+
+/**
+ * @brief 在 preds 与 bb 之间插入一个新块
+ * @return 新块，它只含（可能的）phi 与跳向 bb 的无条件跳转
+ *
+ * preds 跳向 bb 的边都改为跳向新块；bb 的 phi 中来自 preds 的入边
+ * 合并为来自新块的一条，取值不同时在新块中建立 phi。
+ * 新块在函数的块列表中位于 bb 之前。
+ */
+BasicBlock *split_predecessors(BasicBlock *bb,
+                               const std::vector<BasicBlock *> &preds);
+
+/**
+ * @brief 把 bb 合并到它唯一的前驱末尾
+ * @return 前驱块
+ *
+ * 要求 bb 只有一个前驱且该前驱只跳向 bb。bb 的 phi 被替换为唯一的入边值，
+ * 后继中来自 bb 的 phi 入边改为来自前驱，bb 从函数中删除。
+ */
+BasicBlock *merge_into_predecessor(BasicBlock *bb);
+
+// 从入口可达的块的逆后序，不可达的块不在其中
+std::vector<BasicBlock *> reverse_post_order(Function *f);
+
+// 删除从入口不可达的块（包括不可达的环），返回是否删除了块
+bool remove_unreachable_blocks(Function *f);
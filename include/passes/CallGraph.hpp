@@ -0,0 +1,102 @@
+#pragma once
+
+#include "GlobalVariable.hpp"
+#include "Instruction.hpp"
+#include "PassManager.hpp"
+
+#include <set>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * 函数的副作用摘要
+ *
+ * 只记录函数对调用者可见的内存的访问：全局变量与指针参数所指的内存；
+ * 对自身 alloca 出来的局部变量的读写不计入。
+ * 无法归属到具体对象的访问，以及外部函数（input/output 等 IO）
+ * 记为 reads_unknown / writes_unknown。
+ * 越界检查调用的 neg_idx_except 不访问内存，但会输出并终止程序，
+ * 单独记为 may_exit：它不影响别名分析的 mod/ref，
+ * 但可能到达它的调用不能被删除，也不能提前到其他副作用之前执行。
+ */
+struct FunctionSummary {
+    std::set<GlobalVariable *> globals_read;
+    std::set<GlobalVariable *> globals_written;
+    std::set<unsigned> args_read;    // 被读的指针参数编号
+    std::set<unsigned> args_written; // 被写的指针参数编号
+    bool reads_unknown{false};
+    bool writes_unknown{false};
+    bool may_recurse{false};
+    bool may_exit{false}; // 可能调用 neg_idx_except 终止程序
+
+    bool is_readnone() const { return is_readonly() and not reads_memory(); }
+    bool is_readonly() const {
+        return globals_written.empty() and args_written.empty() and
+               not writes_unknown;
+    }
+    bool reads_memory() const {
+        return not globals_read.empty() or not args_read.empty() or
+               reads_unknown;
+    }
+
+    // 合并另一份摘要，返回自身是否发生变化
+    bool merge(const FunctionSummary &other);
+};
+
+/**
+ * 调用图分析
+ *
+ * 建立函数间的调用关系，用 Tarjan 算法求强连通分量，
+ * 然后按自底向上（被调用者先于调用者）的顺序计算每个函数的副作用摘要；
+ * 同一个强连通分量内的函数迭代到不动点。
+ */
+class CallGraph : public Pass {
+  public:
+    using FuncSet = std::set<Function *>;
+
+    explicit CallGraph(Module *m) : Pass(m) {}
+    ~CallGraph() = default;
+    void run() override;
+
+    const FuncSet &get_callees(Function *f) const { return callees_.at(f); }
+    const FuncSet &get_callers(Function *f) const { return callers_.at(f); }
+    // 调用 f 的所有 call 指令
+    const std::vector<CallInst *> &get_call_sites(Function *f) const {
+        return call_sites_.at(f);
+    }
+
+    // 强连通分量，按自底向上的顺序排列
+    const std::vector<std::vector<Function *>> &get_sccs() const {
+        return sccs_;
+    }
+    unsigned get_scc_id(Function *f) const { return scc_id_.at(f); }
+
+    const FunctionSummary &get_summary(Function *f) const {
+        return summary_.at(f);
+    }
+    bool is_readnone(Function *f) const { return get_summary(f).is_readnone(); }
+    bool is_readonly(Function *f) const { return get_summary(f).is_readonly(); }
+    bool may_recurse(Function *f) const { return get_summary(f).may_recurse; }
+    bool may_exit(Function *f) const { return get_summary(f).may_exit; }
+
+    // for debug
+    void print();
+
+  private:
+    void build_graph();
+    void compute_sccs();
+    void compute_summaries();
+    // 只看函数自身的指令，被调用者的摘要合并在 apply_call 中
+    void local_summary(Function *f, FunctionSummary &sum);
+    void apply_call(CallInst *call, FunctionSummary &sum);
+    void add_access(Value *ptr, bool is_write, FunctionSummary &sum);
+
+    std::unordered_map<Function *, FuncSet> callees_;
+    std::unordered_map<Function *, FuncSet> callers_;
+    std::unordered_map<Function *, std::vector<CallInst *>> call_sites_;
+
+    std::vector<std::vector<Function *>> sccs_;
+    std::unordered_map<Function *, unsigned> scc_id_;
+
+    std::unordered_map<Function *, FunctionSummary> summary_;
+};
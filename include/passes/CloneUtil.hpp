@@ -0,0 +1,39 @@
+#pragma once
+
+#include "BasicBlock.hpp"
+#include "Function.hpp"
+#include "Instruction.hpp"
+
+#include <unordered_map>
+#include <vector>
+
+/**
+ * 指令与基本块的复制
+ *
+ * ValueMap 记录原值到副本的映射（包括基本块），复制时操作数若在表中
+ * 就替换为对应的副本，否则保持原值。调用者可以预先在表中放入映射，
+ * 例如内联时把形参映射为实参。
+ */
+using ValueMap = std::unordered_map<Value *, Value *>;
+
+inline Value *map_value(const ValueMap &vmap, Value *val) {
+    auto it = vmap.find(val);
+    return it == vmap.end() ? val : it->second;
+}
+
+// 在 bb 末尾创建 inst 的副本，操作数按 vmap 映射；不处理 phi 与终结指令
+Instruction *clone_instruction(Instruction *inst, BasicBlock *bb,
+                               const ValueMap &vmap);
+
+/**
+ * @brief 把 blocks 复制到函数 f 的末尾
+ * @return 与 blocks 一一对应的副本
+ *
+ * 副本之间的跳转与 phi 入边按映射指向副本；指向 blocks 之外的跳转与
+ * phi 入边保持原来的块，由调用者按需要修正。
+ * 复制到其他函数时（内联）不复制 ret，以 ret 结尾的块的副本没有终结指令，
+ * 由调用者补上。
+ * blocks 中的指令可以按任意顺序引用 blocks 中定义的值。
+ */
+std::vector<BasicBlock *> clone_blocks(const std::vector<BasicBlock *> &blocks,
+                                       Function *f, ValueMap &vmap);
@@ -0,0 +1,18 @@
+#pragma once
+
+#include "Constant.hpp"
+#include "Instruction.hpp"
+
+#include <vector>
+
+/**
+ * 常量折叠
+ *
+ * 以给定的常量作为 inst 的操作数计算结果，结果通过 ConstantInt/ConstantFP
+ * 的唯一化接口获得。无法折叠时返回 nullptr，包括：
+ * 有副作用或与内存相关的指令、除以 0、INT_MIN / -1、越界的移位量、超出 i32 范围的 fptosi。
+ */
+Constant *constant_fold(Instruction *inst, const std::vector<Constant *> &ops);
+
+// 当 inst 的操作数全是常量时折叠，否则返回 nullptr
+Constant *constant_fold(Instruction *inst);
@@ -0,0 +1,114 @@
+#pragma once
+
+#include "BasicBlock.hpp"
+#include "BitVector.hpp"
+#include "Function.hpp"
+
+#include <algorithm>
+#include <functional>
+#include <list>
+#include <set>
+#include <unordered_map>
+#include <vector>
+
+enum class DataFlowDirection { Forward, Backward };
+
+/**
+ * 通用的工作表数据流求解器
+ *
+ * Problem 描述一个数据流问题，需要提供：
+ *   using Domain = ...;                       格的元素，需可拷贝、可比较
+ *   static constexpr DataFlowDirection direction;
+ *   Domain top();                             meet 的单位元，也是初值
+ *   Domain boundary();                        入口（前向）或出口（后向）处的值
+ *   void meet(Domain &acc, const Domain &val, BasicBlock *from, BasicBlock *to);
+ *                                             沿数据流方向的边 from->to 合并
+ *   Domain transfer(BasicBlock *bb, const Domain &in);
+ *
+ * 前向问题按逆后序、后向问题按后序为块编号，工作表总是先取编号最小的块，
+ * 使每轮迭代中前驱（按数据流方向）尽量先于后继被处理。
+ * 结果按程序顺序给出：get_block_entry 是块开头处的值，get_block_exit 是块末尾处的值。
+ */
+template <typename Problem> class DataFlowSolver {
+  public:
+    using Domain = typename Problem::Domain;
+    static constexpr bool forward =
+        Problem::direction == DataFlowDirection::Forward;
+
+    explicit DataFlowSolver(Problem &problem) : problem_(problem) {}
+
+    void solve(Function *f) {
+        order_.clear();
+        order_id_.clear();
+        input_.clear();
+        output_.clear();
+        compute_order(f);
+
+        for (auto bb : order_) {
+            input_[bb] = problem_.top();
+            output_[bb] = problem_.top();
+        }
+        BitVector worklist(order_.size(), true);
+        for (unsigned id = worklist.find_first(); id < order_.size();
+             id = worklist.find_first()) {
+            worklist.reset(id);
+            auto bb = order_[id];
+            auto &in = input_[bb];
+            auto &preds = flow_preds(bb);
+            in = preds.empty() ? problem_.boundary() : problem_.top();
+            for (auto pred : preds)
+                problem_.meet(in, output_[pred], pred, bb);
+
+            auto out = problem_.transfer(bb, in);
+            if (out != output_[bb]) {
+                output_[bb] = std::move(out);
+                for (auto succ : flow_succs(bb))
+                    worklist.set(order_id_.at(succ));
+            }
+        }
+    }
+
+    const Domain &get_block_entry(BasicBlock *bb) const {
+        return forward ? input_.at(bb) : output_.at(bb);
+    }
+    const Domain &get_block_exit(BasicBlock *bb) const {
+        return forward ? output_.at(bb) : input_.at(bb);
+    }
+
+  private:
+    const std::list<BasicBlock *> &flow_preds(BasicBlock *bb) const {
+        return forward ? bb->get_pre_basic_blocks()
+                       : bb->get_succ_basic_blocks();
+    }
+    const std::list<BasicBlock *> &flow_succs(BasicBlock *bb) const {
+        return forward ? bb->get_succ_basic_blocks()
+                       : bb->get_pre_basic_blocks();
+    }
+
+    // 逆后序；后向问题取其逆序。从入口不可达的块排在最后
+    void compute_order(Function *f) {
+        std::set<BasicBlock *> visited;
+        std::function<void(BasicBlock *)> dfs = [&](BasicBlock *bb) {
+            visited.insert(bb);
+            for (auto succ : bb->get_succ_basic_blocks())
+                if (visited.find(succ) == visited.end())
+                    dfs(succ);
+            order_.push_back(bb);
+        };
+        dfs(f->get_entry_block());
+        if (forward)
+            std::reverse(order_.begin(), order_.end());
+        for (auto &bb : f->get_basic_blocks())
+            if (visited.find(&bb) == visited.end())
+                order_.push_back(&bb);
+        for (unsigned i = 0; i < order_.size(); ++i)
+            order_id_[order_[i]] = i;
+    }
+
+    Problem &problem_;
+    std::vector<BasicBlock *> order_;
+    std::unordered_map<BasicBlock *, unsigned> order_id_;
+    // 按数据流方向的输入与输出
+    std::unordered_map<BasicBlock *, Domain> input_;
+    std::unordered_map<BasicBlock *, Domain> output_;
+};
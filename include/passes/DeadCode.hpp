@@ -1,30 +1,44 @@
 #pragma once
 
+#include "Dominators.hpp"
 #include "FuncInfo.hpp"
 #include "PassManager.hpp"
+#include "PostDominators.hpp"
 
+#include <deque>
+#include <unordered_map>
 #include <unordered_set>
 
 /**
  * 死代码消除：参见
  *https://www.clear.rice.edu/comp512/Lectures/10Dead-Clean-SCCP.pdf
+ *
+ * 采用激进的死代码消除：条件跳转不再默认有用，只有当某条有用指令
+ * 控制依赖于它时才保留；无用的条件跳转改写为跳向最近的有用后向支配块。
+ * 为了不删去可能不终止的循环，回边上的跳转仍视为有用。
  **/
 class DeadCode : public Pass {
   public:
-    DeadCode(Module *m) : Pass(m), func_info(std::make_shared<FuncInfo>(m)) {}
+    DeadCode(Module *m)
+        : Pass(m), func_info(std::make_shared<FuncInfo>(m)),
+          dominators(std::make_unique<Dominators>(m)),
+          post_dominators(std::make_unique<PostDominators>(m)) {}
 
     void run();
 
   private:
     std::shared_ptr<FuncInfo> func_info;
+    std::unique_ptr<Dominators> dominators;
+    std::unique_ptr<PostDominators> post_dominators;
     int ins_count{0}; // 用以衡量死代码消除的性能
     std::deque<Instruction *> work_list{};
     std::unordered_map<Instruction *, bool> marked{};
 
     void mark(Function *func);
     void mark(Instruction *ins);
+    void mark_terminator(BasicBlock *bb);
     bool sweep(Function *func);
-    bool clear_basic_blocks(Function *func);
+    bool sweep_branches(Function *func);
     bool is_critical(Instruction *ins);
     void sweep_globally();
 };
@@ -28,6 +28,11 @@ class Dominators : public Pass {
     void dump_cfg(Function *f);
     void dump_dominator_tree(Function *f);
 
+    // 从入口不可达的块不在支配树上
+    bool is_reachable(BasicBlock *bb) {
+        return dom_tree_L_.find(bb) != dom_tree_L_.end();
+    }
+
     // functions for dominance tree
     const bool is_dominate(BasicBlock *bb1, BasicBlock *bb2) {
         return dom_tree_L_.at(bb1) <= dom_tree_L_.at(bb2) &&
@@ -1,35 +1,38 @@
 #pragma once
 
+#include "CallGraph.hpp"
 #include "PassManager.hpp"
 #include "logging.hpp"
 
-#include <deque>
-#include <unordered_map>
-
 /**
  * 计算哪些函数是纯函数
- * WARN:
- * 假定所有函数都是纯函数，除非他写入了全局变量、修改了传入的数组、或者直接间接调用了非纯函数
+ *
+ * 基于 CallGraph 的副作用摘要：
+ * 纯函数 (readnone) 不读写任何调用者可见的内存，也不做 IO，
+ * 只读函数 (readonly) 可能读全局变量或参数所指的数组，但不写。
+ * 对局部变量的读写不影响判断，数组参数只要没有被访问也不影响。
  */
 class FuncInfo : public Pass {
   public:
-    FuncInfo(Module *m) : Pass(m) {}
+    FuncInfo(Module *m) : Pass(m), call_graph_(m) {}
 
     void run();
 
-    bool is_pure_function(Function *func) const { return is_pure.at(func); }
+    bool is_pure_function(Function *func) const {
+        return call_graph_.is_readnone(func);
+    }
+    bool is_readonly_function(Function *func) const {
+        return call_graph_.is_readonly(func);
+    }
+    // 可能终止程序的函数：不能删除对它的调用，也不能改变调用的执行时机
+    bool may_exit(Function *func) const { return call_graph_.may_exit(func); }
+    const FunctionSummary &get_summary(Function *func) const {
+        return call_graph_.get_summary(func);
+    }
+    const CallGraph &get_call_graph() const { return call_graph_; }
 
   private:
-    std::deque<Function *> worklist;
-    std::unordered_map<Function *, bool> is_pure;
-
-    void trivial_mark(Function *func);
-    void process(Function *func);
-    Value *get_first_addr(Value *val);
-
-    bool is_side_effect_inst(Instruction *inst);
-    bool is_local_load(LoadInst *inst);
-    bool is_local_store(StoreInst *inst);
+    CallGraph call_graph_;
 
     void log();
 };
@@ -0,0 +1,47 @@
+#pragma once
+
+#include "Dominators.hpp"
+#include "FuncInfo.hpp"
+#include "Instruction.hpp"
+#include "PassManager.hpp"
+
+#include <map>
+#include <memory>
+#include <utility>
+#include <vector>
+
+/**
+ * 基于支配树作用域的全局值编号
+ *
+ * 按支配树的先序遍历各块，维护一张带作用域的哈希表：
+ * 表中的值都定义在当前块的支配者中，因此可以直接替换后来的等价指令。
+ * 离开一棵支配子树时弹出该子树中加入的表项。
+ *
+ * 参与编号的是纯计算指令（算术、比较、类型转换、getelementptr）
+ * 与对纯函数的调用；同一块中操作数相同的 phi 也会合并。
+ * 另外做平凡 phi 的复制传播：所有入边的值相同（或是 phi 自身）时
+ * 用该值替换 phi。
+ */
+class GVN : public Pass {
+  public:
+    // (操作码, 操作数)，phi 额外以所在块作为最后一个操作数
+    using Expression = std::pair<unsigned, std::vector<Value *>>;
+
+    GVN(Module *m)
+        : Pass(m), func_info_(std::make_unique<FuncInfo>(m)),
+          dominators_(std::make_unique<Dominators>(m)) {}
+    ~GVN() = default;
+
+    void run() override;
+
+  private:
+    bool run_on_func(Function *f);
+    bool remove_trivial_phis(Function *f);
+    bool is_candidate(Instruction *inst);
+    Expression get_expression(Instruction *inst);
+
+    std::unique_ptr<FuncInfo> func_info_;
+    std::unique_ptr<Dominators> dominators_;
+    std::map<Expression, Instruction *> table_;
+    int erased_{0};
+};
@@ -0,0 +1,33 @@
+#pragma once
+
+#include "Dominators.hpp"
+#include "PassManager.hpp"
+#include "ScalarEvolution.hpp"
+
+#include <memory>
+
+/**
+ * 归纳变量化简：循环出口值替换
+ *
+ * 回边执行次数 K 已知时，循环中每次迭代都在退出判断之前计算的值，
+ * 离开循环时等于它在第 K 次迭代的取值。若该值可以由 ScalarEvolution
+ * 表示为循环不变量的线性表达式，就在出口块中计算这个闭式，
+ * 并让循环之后的使用改用它。循环中的计算随后可能变为无用，
+ * 循环本身也可能因此被删除。
+ */
+class IndVarSimplify : public Pass {
+  public:
+    explicit IndVarSimplify(Module *m)
+        : Pass(m), scev_(std::make_unique<ScalarEvolution>(m)),
+          dominators_(std::make_unique<Dominators>(m)) {}
+    ~IndVarSimplify() = default;
+    void run() override;
+
+  private:
+    void rewrite_exit_values(std::shared_ptr<Loop> loop);
+
+    std::unique_ptr<ScalarEvolution> scev_;
+    std::unique_ptr<Dominators> dominators_;
+    Function *dom_func_{nullptr}; // dominators_ 对应的函数
+    unsigned replaced_{0};
+};
@@ -0,0 +1,69 @@
+#pragma once
+
+#include "CallGraph.hpp"
+#include "CloneUtil.hpp"
+#include "LoopDetection.hpp"
+#include "PassManager.hpp"
+
+#include <memory>
+#include <unordered_map>
+
+/**
+ * 函数内联
+ *
+ * 按调用图强连通分量自底向上的顺序处理各函数：处理调用者时，
+ * 被调用者中值得内联的调用已经展开过。同一强连通分量内的调用
+ * 以及可能递归的函数不内联。
+ *
+ * 在 mem2reg 之前运行，被内联函数的局部变量移到调用者的入口块，
+ * 随后与调用者自己的局部变量一起被提升为 SSA 值并在上下文中优化。
+ *
+ * 代价模型以 mem2reg 之后的指令数估计被调用者的大小，
+ * 减去调用本身的开销（每个实参在调用点与被调用者中各一次栈上存取）
+ * 后与阈值比较。阈值在以下情况提高：
+ *   - 被调用者是叶函数（只调用外部函数）
+ *   - 调用点位于循环中，按循环深度增加
+ *   - 实参是常量，内联后可以继续传播
+ *   - 这是被调用者唯一的调用点，内联后被调用者可以删除
+ * 有 profile（-fprofile-use）时以调用点的执行次数代替循环深度：
+ * 次数不低于最热调用点 1/HOT_CALL_RATIO 的调用点得到 HOT_BONUS，
+ * 从未执行的调用点不得到任何加成。内联后，复制进来的调用点的次数
+ * 按本次调用占被调用者入口次数的比例缩放。
+ * 所有调用点都被内联的函数最后被删除。
+ */
+class Inliner : public Pass {
+  public:
+    explicit Inliner(Module *m) : Pass(m) {}
+    ~Inliner() = default;
+    void run() override;
+
+  private:
+    // 代价模型的参数，以指令数计
+    static constexpr int INLINE_THRESHOLD = 30;
+    static constexpr int LEAF_BONUS = 20;
+    static constexpr int LOOP_BONUS = 40; // 每层循环
+    static constexpr int MAX_LOOP_DEPTH = 3;
+    static constexpr int CONST_ARG_BONUS = 10;
+    static constexpr int CALL_COST = 4; // 跳转、返回与栈帧的维护
+    static constexpr int ARG_COST = 2;
+    static constexpr int LAST_CALL_LIMIT = 500;
+    static constexpr int CALLER_SIZE_LIMIT = 3000;
+    static constexpr int HOT_BONUS = 120;
+    static constexpr unsigned long HOT_CALL_RATIO = 100;
+
+    void run_on_func(Function *f);
+    bool should_inline(CallInst *call, int caller_size);
+    void inline_call(CallInst *call);
+    BasicBlock *split_block_after(Instruction *inst);
+    void remove_function(Function *f);
+
+    static int estimate_size(Function *f);
+    bool is_leaf(Function *f);
+
+    std::unique_ptr<CallGraph> call_graph_;
+    std::unique_ptr<LoopDetection> loop_detection_;
+    std::unordered_map<BasicBlock *, int> loop_depth_;
+    std::unordered_map<Function *, int> size_;
+    unsigned long max_call_count_{0}; // profile 中最热调用点的次数
+    int inlined_{0};
+};
@@ -0,0 +1,49 @@
+#pragma once
+
+#include "Instruction.hpp"
+#include "PassManager.hpp"
+
+#include <deque>
+#include <unordered_set>
+
+/**
+ * 窥孔优化：基于 PatternMatch 的指令合并
+ *
+ * 对每条指令尝试一组局部改写，改写成功后把受影响的指令重新加入工作表，
+ * 直到不再变化。主要的改写有：
+ *   - 代数恒等式：x+0, x-0, x*1, x*0, x/1, 0/x, x-x
+ *   - 取负：0-(0-x) => x, x+(0-y) => x-y, x-(0-y) => x+y
+ *   - 常量链重结合：(x+c1)+c2 => x+(c1+c2)，(x*c1)*c2 => x*(c1*c2)，
+ *     常量放到可交换运算的右边，x-c 改写为 x+(-c)
+ *   - 条件：zext(b) != 0 => b，zext(b) == 0 => 取反的比较
+ *   - fptosi(sitofp(x)) => x，仅当 x 一定能被 float 精确表示
+ */
+class InstCombine : public Pass {
+  public:
+    explicit InstCombine(Module *m) : Pass(m) {}
+    ~InstCombine() = default;
+    void run() override;
+
+  private:
+    void run_on_func(Function *f);
+    // 返回替换 inst 的值；原地修改时返回 inst 本身；无法改写时返回 nullptr
+    Value *visit(Instruction *inst);
+    Value *visit_add(Instruction *inst);
+    Value *visit_sub(Instruction *inst);
+    Value *visit_mul(Instruction *inst);
+    Value *visit_sdiv(Instruction *inst);
+    Value *visit_float(Instruction *inst);
+    Value *visit_cmp(Instruction *inst);
+    Value *visit_fptosi(Instruction *inst);
+
+    bool canonicalize_commutative(Instruction *inst);
+    bool is_exact_in_float(Value *val);
+    void push(Instruction *inst);
+    void push_users(Value *val);
+
+    std::deque<Instruction *> worklist_;
+    std::unordered_set<Instruction *> in_worklist_;
+    // 已被替换、移出基本块的指令，run_on_func 结束时释放
+    std::unordered_set<Instruction *> erased_;
+    int combined_{0};
+};
@@ -1,8 +1,12 @@
+#include "AliasAnalysis.hpp"
+#include "Dominators.hpp"
 #include "FuncInfo.hpp"
 #include "LoopDetection.hpp"
 #include "PassManager.hpp"
 #include <memory>
 #include <unordered_map>
+#include <unordered_set>
+#include <vector>
 
 class LoopInvariantCodeMotion : public Pass {
   public:
@@ -15,10 +19,29 @@ class LoopInvariantCodeMotion : public Pass {
     std::unordered_map<std::shared_ptr<Loop>, bool> is_loop_done_;
     std::unique_ptr<LoopDetection> loop_detection_;
     std::unique_ptr<FuncInfo> func_info_;
+    std::unique_ptr<AliasAnalysis> alias_analysis_;
+    std::unique_ptr<Dominators> dominators_;
+    Function *dom_func_{nullptr}; // dominators_ 对应的函数
+    // 块在支配树先序中的位置，按它遍历循环的块时定值先于使用
+    std::unordered_map<BasicBlock *, unsigned> dom_order_;
+
+    // 当前循环的信息，每个循环重新计算
+    std::vector<Instruction *> memory_writers_;
+    std::unordered_map<Value *, bool> invariant_ptrs_;
+    std::unordered_map<BasicBlock *, bool> guaranteed_blocks_;
+    // 同一次迭代中可能在副作用之后执行的块
+    std::unordered_set<BasicBlock *> after_side_effects_;
+
     void traverse_loop(std::shared_ptr<Loop> loop);
     void run_on_loop(std::shared_ptr<Loop> loop);
-    void collect_loop_info(std::shared_ptr<Loop> loop,
-                          std::set<Value *> &loop_instructions,
-                          std::set<Value *> &updated_global,
-                          bool &contains_impure_call);
-};
\ No newline at end of file
+    void prepare_function(Function *func);
+    std::vector<BasicBlock *> sorted_blocks(std::shared_ptr<Loop> loop);
+    bool has_side_effect(Instruction *inst);
+    void collect_loop_info(std::shared_ptr<Loop> loop);
+    bool is_invariant_load(LoadInst *load);
+    bool is_guaranteed_to_execute(std::shared_ptr<Loop> loop,
+                                  BasicBlock *bb);
+    bool can_hoist(std::shared_ptr<Loop> loop, Instruction *inst,
+                   bool after_side_effect);
+    BasicBlock *get_sink_block(std::shared_ptr<Loop> loop, Instruction *inst);
+};
@@ -0,0 +1,103 @@
+#pragma once
+
+#include "BasicBlock.hpp"
+#include "BitVector.hpp"
+#include "DataFlow.hpp"
+#include "Function.hpp"
+#include "PassManager.hpp"
+
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+/**
+ * 基于位向量的活跃变量分析
+ *
+ * 只跟踪 SSA 值：函数参数与有结果的指令，常量、全局变量等不参与分析。
+ * 每个函数内的值被编号为 [0, get_num_values())，集合用 BitVector 表示。
+ *
+ * phi 的处理：phi 的结果在所在块的开头定值，不属于该块的 live-in；
+ * phi 的操作数视为在对应前驱块的末尾被使用，只属于该前驱的 live-out，
+ * 而不会沿其他入边传播。
+ *
+ * 除块级的 live-in/live-out 外，还把函数内的指令按块的布局顺序线性编号，
+ * 为每个值给出活跃区间（若干个左闭右开的段），供后端使用。
+ */
+class Liveness : public Pass {
+  public:
+    // 左闭右开的指令编号区间
+    using Segment = std::pair<unsigned, unsigned>;
+    using Interval = std::vector<Segment>;
+
+    explicit Liveness(Module *m) : Pass(m) {}
+    ~Liveness() = default;
+    void run() override;
+    void run_on_func(Function *f);
+
+    unsigned get_num_values() const { return values_.size(); }
+    bool is_tracked(Value *val) const {
+        return value_index_.find(val) != value_index_.end();
+    }
+    unsigned get_value_index(Value *val) const { return value_index_.at(val); }
+    Value *get_value(unsigned idx) const { return values_.at(idx); }
+
+    const BitVector &get_live_in(BasicBlock *bb) const {
+        return live_in_.at(bb);
+    }
+    const BitVector &get_live_out(BasicBlock *bb) const {
+        return live_out_.at(bb);
+    }
+    std::vector<Value *> get_live_in_values(BasicBlock *bb) const;
+    std::vector<Value *> get_live_out_values(BasicBlock *bb) const;
+
+    // 指令的线性编号；块 bb 占据 [get_block_start(bb), get_block_end(bb))
+    unsigned get_instr_index(Instruction *inst) const {
+        return instr_index_.at(inst);
+    }
+    unsigned get_block_start(BasicBlock *bb) const {
+        return block_range_.at(bb).first;
+    }
+    unsigned get_block_end(BasicBlock *bb) const {
+        return block_range_.at(bb).second;
+    }
+
+    // 值的活跃区间，段按起点升序排列且互不相交
+    const Interval &get_interval(Value *val) const {
+        return intervals_.at(get_value_index(val));
+    }
+    // val 在编号为 pos 的指令处（执行前）是否活跃
+    bool is_live_at(Value *val, unsigned pos) const;
+    // val 在 inst 执行之后是否仍活跃
+    bool is_live_after(Value *val, Instruction *inst) const {
+        return is_live_at(val, get_instr_index(inst) + 1);
+    }
+
+    // for debug
+    void print(Function *f);
+
+  private:
+    struct Problem;
+
+    void number_values(Function *f);
+    void compute_local_sets(Function *f);
+    void solve(Function *f);
+    void build_intervals(Function *f);
+    void add_segment(unsigned idx, unsigned from, unsigned to);
+
+    std::vector<Value *> values_;
+    std::unordered_map<Value *, unsigned> value_index_;
+
+    // 块内向上暴露的使用（不含 phi 操作数）与定值（含 phi）
+    std::unordered_map<BasicBlock *, BitVector> use_;
+    std::unordered_map<BasicBlock *, BitVector> def_;
+    // 后继块中的 phi 经由 bb 这条入边所使用的值
+    std::unordered_map<BasicBlock *, BitVector> phi_use_;
+
+    std::unordered_map<BasicBlock *, BitVector> live_in_;
+    std::unordered_map<BasicBlock *, BitVector> live_out_;
+
+    std::unordered_map<Instruction *, unsigned> instr_index_;
+    std::unordered_map<BasicBlock *, std::pair<unsigned, unsigned>>
+        block_range_;
+    std::vector<Interval> intervals_;
+};
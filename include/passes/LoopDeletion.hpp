@@ -0,0 +1,39 @@
+#pragma once
+
+#include "FuncInfo.hpp"
+#include "PassManager.hpp"
+#include "ScalarEvolution.hpp"
+
+#include <memory>
+
+/**
+ * 删除无用的循环
+ *
+ * DeadCode 保留所有回边上的跳转，不会删除循环。这里删除满足以下条件的循环：
+ *   - 没有副作用：不含 store，调用的都是不会终止程序的只读函数
+ *     （与 DeadCode 相同，假定这样的函数一定返回）；
+ *   - 一定终止：循环及其所有子循环的回边执行次数都能由 ScalarEvolution
+ *     求出，且循环只有一个出口块；
+ *   - 循环之后对循环中的值的使用都能换成闭式：该值能由 ScalarEvolution
+ *     表示，在最后一次迭代（第 K 次，K 为回边执行次数）的取值只含循环
+ *     不变量。
+ * 闭式在 preheader 中计算，preheader 直接跳到出口块，循环的块随后删除。
+ * 外层循环先于内层循环检查，整个循环嵌套无用时一次删除。
+ */
+class LoopDeletion : public Pass {
+  public:
+    explicit LoopDeletion(Module *m)
+        : Pass(m), scev_(std::make_unique<ScalarEvolution>(m)),
+          func_info_(std::make_unique<FuncInfo>(m)) {}
+    ~LoopDeletion() = default;
+    void run() override;
+
+  private:
+    bool terminates(std::shared_ptr<Loop> loop);
+    bool has_side_effects(std::shared_ptr<Loop> loop);
+    bool delete_loop(std::shared_ptr<Loop> loop);
+
+    std::unique_ptr<ScalarEvolution> scev_;
+    std::unique_ptr<FuncInfo> func_info_;
+    unsigned deleted_{0};
+};
@@ -1,6 +1,7 @@
 #pragma once
 #include "Dominators.hpp"
 #include "PassManager.hpp"
+#include <algorithm>
 #include <memory>
 #include <unordered_map>
 #include <unordered_set>
@@ -22,15 +23,27 @@ class Loop {
 
     std::shared_ptr<Loop> parent_ = nullptr;
     BBvec blocks_;
+    std::unordered_set<BasicBlock *> block_set_;
     std::vector<std::shared_ptr<Loop>> sub_loops_;
     
     std::unordered_set<BasicBlock *> latches_;
+    // exiting: 循环内有后继在循环外的块; exits: 这些后继
+    BBvec exiting_blocks_;
+    BBvec exit_blocks_;
   public:
     Loop(BasicBlock *header) : header_(header) {
-        blocks_.push_back(header);
+        add_block(header);
     }
     ~Loop() = default;
-    void add_block(BasicBlock *bb) { blocks_.push_back(bb); }
+    void add_block(BasicBlock *bb) {
+        if (block_set_.insert(bb).second)
+            blocks_.push_back(bb);
+    }
+    void remove_block(BasicBlock *bb) {
+        if (block_set_.erase(bb))
+            blocks_.erase(std::find(blocks_.begin(), blocks_.end(), bb));
+    }
+    bool contains(BasicBlock *bb) const { return block_set_.count(bb) != 0; }
     BasicBlock *get_header() { return header_; }
     BasicBlock *get_preheader() { return preheader_; }
     std::shared_ptr<Loop> get_parent() { return parent_; }
@@ -41,6 +54,18 @@ class Loop {
     const std::vector<std::shared_ptr<Loop>>& get_sub_loops() { return sub_loops_; }
     const std::unordered_set<BasicBlock *>& get_latches() { return latches_; }
     void add_latch(BasicBlock *bb) { latches_.insert(bb); }
+    void remove_latch(BasicBlock *bb) { latches_.erase(bb); }
+    // 唯一的 latch，有多个时返回 nullptr
+    BasicBlock *get_latch() {
+        return latches_.size() == 1 ? *latches_.begin() : nullptr;
+    }
+    const BBvec &get_exiting_blocks() { return exiting_blocks_; }
+    const BBvec &get_exit_blocks() { return exit_blocks_; }
+    // 根据当前的 blocks 重新计算 exiting/exit 块
+    void compute_exits();
+    // 是否为 LoopSimplify 规范形式：有 preheader，唯一的 latch，
+    // 且每个出口块的前驱都在循环内
+    bool is_simplified();
 };
 
 class LoopDetection : public Pass {
@@ -52,6 +77,7 @@ class LoopDetection : public Pass {
     std::unordered_map<BasicBlock *, std::shared_ptr<Loop>> bb_to_loop_;
     void discover_loop_and_sub_loops(BasicBlock *bb, BBset &latches,
                                      std::shared_ptr<Loop> loop);
+    void find_preheader(std::shared_ptr<Loop> loop);
 
   public:
     LoopDetection(Module *m) : Pass(m) {}
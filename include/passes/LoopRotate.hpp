@@ -0,0 +1,47 @@
+#pragma once
+
+#include "LoopDetection.hpp"
+#include "PassManager.hpp"
+
+#include <memory>
+#include <vector>
+
+/**
+ * 循环旋转
+ *
+ * CminusfBuilder 把 while 翻译为在 header 中判断条件的循环，每次迭代
+ * 都要执行 header 的条件跳转与 latch 跳回 header 的无条件跳转。
+ * 旋转把 header 的判断复制到 preheader 作为入口守卫，
+ * 再把 header 合并进 latch，得到底部判断的 do-while：
+ *
+ *     P: br H                     P: c0 = ...; br c0, B, E
+ *     H: c = ...; br c, B, E  =>  B: phi [.., P], [.., L] ...
+ *     B: ...                      L: ...; c = ...; br c, B, E
+ *     L: br H
+ *
+ * 原 header 中定义、在循环体或循环后使用的值在 B 与 E 中插入 phi。
+ * 循环体中可以有其他出口（例如数组下标检查），但 header 需要足够小。
+ * 在 LoopSimplify 规范形式上运行，结束后重新规范化。
+ */
+class LoopRotate : public Pass {
+  public:
+    explicit LoopRotate(Module *m) : Pass(m) {}
+    ~LoopRotate() = default;
+    void run() override;
+
+  private:
+    struct HeaderUse {
+        Instruction *user;
+        unsigned arg_no;
+        BasicBlock *phi_bb; // 旋转后改用这个块中新建的 phi
+    };
+
+    bool can_rotate(std::shared_ptr<Loop> loop);
+    bool collect_uses(std::shared_ptr<Loop> loop);
+    void rotate(std::shared_ptr<Loop> loop);
+
+    std::unique_ptr<LoopDetection> loop_detection_;
+    std::unique_ptr<Dominators> dominators_;
+    std::vector<std::pair<Instruction *, std::vector<HeaderUse>>> uses_;
+    unsigned rotated_{0};
+};
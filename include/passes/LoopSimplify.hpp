@@ -0,0 +1,32 @@
+#pragma once
+
+#include "LoopDetection.hpp"
+#include "PassManager.hpp"
+
+#include <memory>
+
+/**
+ * 循环规范化
+ *
+ * 把每个自然循环整理为后续循环变换所依赖的形式：
+ *   - preheader：header 唯一的循环外前驱，且只跳向 header
+ *   - 唯一的 latch：多条回边先汇合到一个新块再跳回 header
+ *   - 专用的出口块：出口块的前驱都在循环内
+ * 新块的 phi 由 split_predecessors 维护。内层循环先于外层处理，
+ * 新建的块按其位置加入各层外层循环。
+ */
+class LoopSimplify : public Pass {
+  public:
+    explicit LoopSimplify(Module *m) : Pass(m) {}
+    ~LoopSimplify() = default;
+    void run() override;
+
+  private:
+    void simplify_loop(std::shared_ptr<Loop> loop);
+    void insert_preheader(std::shared_ptr<Loop> loop);
+    void merge_latches(std::shared_ptr<Loop> loop);
+    void form_dedicated_exits(std::shared_ptr<Loop> loop);
+
+    std::unique_ptr<LoopDetection> loop_detection_;
+    unsigned inserted_{0};
+};
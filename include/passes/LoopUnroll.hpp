@@ -0,0 +1,56 @@
+#pragma once
+
+#include "CloneUtil.hpp"
+#include "PassManager.hpp"
+#include "ScalarEvolution.hpp"
+
+#include <memory>
+#include <vector>
+
+/**
+ * 循环展开
+ *
+ * 只处理最内层、底部判断（exiting 块是 latch，LoopRotate 的结果）
+ * 且 ScalarEvolution 能求出回边执行次数的循环。数组下标检查跳向的
+ * exceptBB 随循环体一同复制，每一份循环体各自带有检查。
+ *   - 完全展开：迭代次数为常量且展开后不太大时，把循环体复制为
+ *     迭代次数份首尾相接，删除回边
+ *   - 部分展开：否则把循环体复制 factor 份组成主循环，
+ *     由一个按 factor 递减的计数器控制；原循环保留为余数循环，
+ *     执行剩下的 迭代次数 % factor 次，余数为 0 时跳过
+ * factor 取 2 的幂，展开后过大时减半；latch 带有 profile 的分支权重时，
+ * 还减半到不超过平均每次进入循环的迭代次数，从未执行的循环不部分展开。
+ */
+class LoopUnroll : public Pass {
+  public:
+    explicit LoopUnroll(Module *m, unsigned factor = 4)
+        : Pass(m), factor_(factor), scev_(std::make_unique<ScalarEvolution>(m)) {}
+    ~LoopUnroll() = default;
+    void run() override;
+
+  private:
+    bool can_unroll(std::shared_ptr<Loop> loop);
+    std::vector<ValueMap> clone_iterations(std::shared_ptr<Loop> loop,
+                                           unsigned count, bool keep_original);
+    void fully_unroll(std::shared_ptr<Loop> loop, unsigned trip_count);
+    bool partially_unroll(std::shared_ptr<Loop> loop, unsigned factor);
+    void merge_chained_blocks();
+    Value *latch_value(std::shared_ptr<Loop> loop, PhiInst *phi);
+
+    unsigned factor_;
+    std::unique_ptr<ScalarEvolution> scev_;
+    BBvec blocks_;                   // 按函数中的顺序排列的循环块
+    BBvec except_blocks_;            // 循环中的检查跳向的 exceptBB
+    BasicBlock *exit_{nullptr};      // 除 exceptBB 之外唯一的出口块
+    std::vector<PhiInst *> phis_;    // header 的 phi
+    // 循环之后对循环中的值的使用，在复制之前记录
+    struct LiveOutUse {
+        Instruction *val;
+        Instruction *user;
+        unsigned arg_no;
+    };
+    std::vector<LiveOutUse> live_out_uses_;
+    BBvec chained_; // clone_iterations 中由上一份 latch 跳入的 header
+    unsigned full_{0};
+    unsigned partial_{0};
+};
@@ -0,0 +1,40 @@
+#pragma once
+
+#include "LoopDetection.hpp"
+#include "LoopVersioning.hpp"
+#include "PassManager.hpp"
+
+#include <memory>
+#include <unordered_map>
+
+/**
+ * 循环反转（unswitching）：把循环中条件不变的分支提到循环之外
+ *
+ * 循环中的条件跳转若其条件不在循环中定义（LICM 之后，循环不变的计算
+ * 都已外提到 preheader），就用 LoopVersioning 复制循环，preheader 中
+ * 按该条件选择版本：条件为真时执行的原循环中该跳转改为只跳向真目标，
+ * 副本中改为只跳向假目标，不再执行的块随后删除。
+ *
+ * 外层循环先于内层循环处理，条件在整个循环嵌套中不变时只在最外层
+ * 复制一次。每次反转后重新规范化并检测循环，副本中剩下的不变条件
+ * 在之后的轮次中继续反转。复制受大小限制：单个循环不超过
+ * UNSWITCH_MAX_SIZE 条指令，每个函数复制的指令总数不超过
+ * UNSWITCH_FUNC_BUDGET。
+ */
+class LoopUnswitch : public Pass {
+  public:
+    explicit LoopUnswitch(Module *m)
+        : Pass(m), versioning_(std::make_unique<LoopVersioning>(m)) {}
+    ~LoopUnswitch() = default;
+    void run() override;
+
+  private:
+    BranchInst *find_invariant_branch(std::shared_ptr<Loop> loop);
+    bool unswitch_loop(std::shared_ptr<Loop> loop);
+    void fold_branch(BasicBlock *bb, BasicBlock *taken);
+
+    std::unique_ptr<LoopVersioning> versioning_;
+    // 每个函数已复制的指令数
+    std::unordered_map<Function *, unsigned> cloned_size_;
+    unsigned unswitched_{0};
+};
@@ -0,0 +1,68 @@
+#pragma once
+
+#include "CloneUtil.hpp"
+#include "Dominators.hpp"
+#include "PassManager.hpp"
+#include "ScalarEvolution.hpp"
+
+#include <memory>
+#include <vector>
+
+/**
+ * 循环版本化：把数组下标为负的检查提到循环之外
+ *
+ * IRBuilder 为每次数组访问生成 icmp lt idx, 0 与跳向 exceptBB 的分支。
+ * 若 idx 可由 ScalarEvolution 表示为 {init,+,stride} 且 stride 为非负常量，
+ * 只要下标不越过 INT_MAX 回绕，整个循环中 idx 的最小值就是第 0 次迭代的
+ * init，最大值是最后一次迭代的 last（由回边执行次数求出）。于是在 preheader
+ * 中一次性检查 init 非负、last 不越界的条件（化为一组表达式非负，它们按位或
+ * 的结果非负即可），通过时跳到删去了这些检查的循环副本，否则执行原循环。
+ * 条件都能静态确定时不需要副本，直接在原循环中删去检查。
+ *
+ * 只处理最内层循环。循环之后对循环中的值的使用需被某个出口块支配，
+ * 在该出口块中用 phi 合并两个版本的值。
+ */
+class LoopVersioning : public Pass {
+  public:
+    explicit LoopVersioning(Module *m)
+        : Pass(m), scev_(std::make_unique<ScalarEvolution>(m)),
+          dominators_(std::make_unique<Dominators>(m)) {}
+    ~LoopVersioning() = default;
+    void run() override;
+
+    // 计算 f 的支配树，为 f 中的循环建立版本前调用
+    void prepare_function(Function *f) { dominators_->run_on_func(f); }
+    /**
+     * @brief 检查能否为 loop 建立版本，并记录循环之后的使用
+     *
+     * 要求 loop 是 LoopSimplify 规范形式，且调用前已对 loop 所在的函数
+     * 调用 prepare_function。
+     */
+    bool can_version(std::shared_ptr<Loop> loop);
+    /**
+     * @brief 复制 loop，preheader 中 cond 为真时执行原循环，否则执行副本
+     * @return 原循环中的值（包括块）到副本的映射
+     *
+     * 两个版本共用 preheader 与出口块；之后 CFG 已变化，需要重新分析。
+     */
+    ValueMap version_loop(std::shared_ptr<Loop> loop, Value *cond);
+
+  private:
+    bool get_conditions(const ScalarEvolution::Expr &init,
+                        const ScalarEvolution::Expr &last,
+                        std::vector<ScalarEvolution::Expr> &conds);
+    bool version_checks(std::shared_ptr<Loop> loop);
+    void remove_check(BasicBlock *bb);
+
+    std::unique_ptr<ScalarEvolution> scev_;
+    std::unique_ptr<Dominators> dominators_;
+    // 循环中的值在循环之后的使用，按支配它们的出口块分组
+    struct LiveOut {
+        Instruction *val;
+        BasicBlock *exit;
+        std::vector<std::pair<Instruction *, unsigned>> uses;
+    };
+    std::vector<LiveOut> live_outs_;
+    unsigned versioned_{0};
+    unsigned removed_{0};
+};
@@ -0,0 +1,193 @@
+#pragma once
+
+#include "Constant.hpp"
+#include "Instruction.hpp"
+
+/**
+ * 指令模式匹配
+ *
+ * 用模板在编译期组合出模式，例如
+ *     Value *a; int c;
+ *     if (match(inst, m_Add(m_Value(a), m_ConstInt(c)))) ...
+ * 匹配成功时各个绑定的变量被赋值。可交换运算用 m_c_Add 等形式，
+ * 会依次尝试两种操作数顺序。
+ */
+namespace PatternMatch {
+
+template <typename Val, typename Pattern> bool match(Val *v, Pattern &&p) {
+    return p.match(v);
+}
+
+// 任意值
+struct AnyValue {
+    bool match(Value *) { return true; }
+};
+inline AnyValue m_Value() { return {}; }
+
+// 任意值并绑定
+template <typename T> struct BindValue {
+    T *&bind;
+    bool match(Value *v) {
+        if (auto t = dynamic_cast<T *>(v)) {
+            bind = t;
+            return true;
+        }
+        return false;
+    }
+};
+inline BindValue<Value> m_Value(Value *&v) { return {v}; }
+inline BindValue<Instruction> m_Instruction(Instruction *&v) { return {v}; }
+inline BindValue<ConstantInt> m_ConstInt(ConstantInt *&v) { return {v}; }
+inline BindValue<ConstantFP> m_ConstFP(ConstantFP *&v) { return {v}; }
+
+// 指定的值
+struct SpecificValue {
+    Value *val;
+    bool match(Value *v) { return v == val; }
+};
+inline SpecificValue m_Specific(Value *v) { return {v}; }
+
+// 整数常量并绑定其值
+struct BindConstInt {
+    int &bind;
+    bool match(Value *v) {
+        if (auto c = dynamic_cast<ConstantInt *>(v)) {
+            bind = c->get_value();
+            return true;
+        }
+        return false;
+    }
+};
+inline BindConstInt m_ConstInt(int &c) { return {c}; }
+
+// 指定值的整数常量
+struct SpecificInt {
+    int val;
+    bool match(Value *v) {
+        auto c = dynamic_cast<ConstantInt *>(v);
+        return c and c->get_value() == val;
+    }
+};
+inline SpecificInt m_SpecificInt(int val) { return {val}; }
+inline SpecificInt m_Zero() { return {0}; }
+inline SpecificInt m_One() { return {1}; }
+
+// 指定值的浮点常量
+struct SpecificFP {
+    float val;
+    bool match(Value *v) {
+        auto c = dynamic_cast<ConstantFP *>(v);
+        return c and c->get_value() == val;
+    }
+};
+inline SpecificFP m_SpecificFP(float val) { return {val}; }
+
+// 两个模式同时匹配
+template <typename L, typename R> struct BothMatch {
+    L l;
+    R r;
+    bool match(Value *v) { return l.match(v) and r.match(v); }
+};
+template <typename L, typename R> BothMatch<L, R> m_CombineAnd(L l, R r) {
+    return {l, r};
+}
+
+// 二元运算与比较
+template <Instruction::OpID Op, typename L, typename R,
+          bool Commutable = false>
+struct BinaryOpMatch {
+    L l;
+    R r;
+    bool match(Value *v) {
+        auto inst = dynamic_cast<Instruction *>(v);
+        if (inst == nullptr or inst->get_instr_type() != Op or
+            inst->get_num_operand() != 2)
+            return false;
+        if (l.match(inst->get_operand(0)) and r.match(inst->get_operand(1)))
+            return true;
+        return Commutable and l.match(inst->get_operand(1)) and
+               r.match(inst->get_operand(0));
+    }
+};
+
+#define BINARY_MATCHER(NAME, OP)                                               \
+    template <typename L, typename R>                                          \
+    BinaryOpMatch<Instruction::OP, L, R> m_##NAME(L l, R r) {                  \
+        return {l, r};                                                         \
+    }                                                                          \
+    template <typename L, typename R>                                          \
+    BinaryOpMatch<Instruction::OP, L, R, true> m_c_##NAME(L l, R r) {          \
+        return {l, r};                                                         \
+    }
+
+BINARY_MATCHER(Add, add)
+BINARY_MATCHER(Sub, sub)
+BINARY_MATCHER(Mul, mul)
+BINARY_MATCHER(SDiv, sdiv)
+BINARY_MATCHER(SRem, srem)
+BINARY_MATCHER(Shl, shl)
+BINARY_MATCHER(AShr, ashr)
+BINARY_MATCHER(LShr, lshr)
+BINARY_MATCHER(And, and_)
+BINARY_MATCHER(Or, or_)
+BINARY_MATCHER(Xor, xor_)
+BINARY_MATCHER(FAdd, fadd)
+BINARY_MATCHER(FSub, fsub)
+BINARY_MATCHER(FMul, fmul)
+BINARY_MATCHER(FDiv, fdiv)
+BINARY_MATCHER(ICmpEQ, eq)
+BINARY_MATCHER(ICmpNE, ne)
+BINARY_MATCHER(ICmpLT, lt)
+BINARY_MATCHER(ICmpLE, le)
+BINARY_MATCHER(ICmpGT, gt)
+BINARY_MATCHER(ICmpGE, ge)
+
+#undef BINARY_MATCHER
+
+// 任意整数比较，绑定比较的种类
+template <typename L, typename R> struct ICmpMatch {
+    Instruction::OpID &pred;
+    L l;
+    R r;
+    bool match(Value *v) {
+        auto inst = dynamic_cast<Instruction *>(v);
+        if (inst == nullptr or not inst->is_cmp())
+            return false;
+        if (l.match(inst->get_operand(0)) and r.match(inst->get_operand(1))) {
+            pred = inst->get_instr_type();
+            return true;
+        }
+        return false;
+    }
+};
+template <typename L, typename R>
+ICmpMatch<L, R> m_ICmp(Instruction::OpID &pred, L l, R r) {
+    return {pred, l, r};
+}
+
+// 一元的类型转换
+template <Instruction::OpID Op, typename P> struct CastMatch {
+    P p;
+    bool match(Value *v) {
+        auto inst = dynamic_cast<Instruction *>(v);
+        return inst and inst->get_instr_type() == Op and
+               p.match(inst->get_operand(0));
+    }
+};
+template <typename P> CastMatch<Instruction::zext, P> m_ZExt(P p) {
+    return {p};
+}
+template <typename P> CastMatch<Instruction::fptosi, P> m_FPToSI(P p) {
+    return {p};
+}
+template <typename P> CastMatch<Instruction::sitofp, P> m_SIToFP(P p) {
+    return {p};
+}
+
+// 0 - x
+template <typename P>
+BinaryOpMatch<Instruction::sub, SpecificInt, P> m_Neg(P p) {
+    return {m_Zero(), p};
+}
+
+} // namespace PatternMatch
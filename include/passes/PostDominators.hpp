@@ -0,0 +1,76 @@
+#pragma once
+
+#include "BasicBlock.hpp"
+#include "PassManager.hpp"
+
+#include <map>
+#include <set>
+#include <vector>
+
+/**
+ * 后向支配树与控制依赖图
+ *
+ * 在反向 CFG 上计算后向支配关系。函数中可能有多个 ret 块，
+ * 因此引入一个虚拟出口，所有 ret 块都连向它；虚拟出口用 nullptr 表示。
+ * 不能到达任何 ret 的块（死循环）不在后向支配树上，
+ * 对它们的查询一律返回保守结果。
+ */
+class PostDominators : public Pass {
+  public:
+    using BBSet = std::set<BasicBlock *>;
+
+    explicit PostDominators(Module *m) : Pass(m) {}
+    ~PostDominators() = default;
+    void run() override;
+    void run_on_func(Function *f);
+
+    // 是否在后向支配树上，即能否到达虚拟出口
+    bool is_reachable_to_exit(BasicBlock *bb) {
+        return post_order_.find(bb) != post_order_.end();
+    }
+    // 直接后向支配者，nullptr 表示虚拟出口
+    BasicBlock *get_ipdom(BasicBlock *bb) { return ipdom_.at(bb); }
+    // bb1 是否后向支配 bb2
+    bool is_post_dominate(BasicBlock *bb1, BasicBlock *bb2) {
+        if (not is_reachable_to_exit(bb1) or not is_reachable_to_exit(bb2))
+            return bb1 == bb2;
+        return pdom_tree_L_.at(bb1) <= pdom_tree_L_.at(bb2) &&
+               pdom_tree_R_.at(bb1) >= pdom_tree_L_.at(bb2);
+    }
+
+    // bb 控制依赖于哪些块的终结指令
+    const BBSet &get_control_dependence(BasicBlock *bb) {
+        return control_dep_.at(bb);
+    }
+    // 哪些块控制依赖于 bb 的终结指令
+    const BBSet &get_control_dependents(BasicBlock *bb) {
+        return control_dep_succ_.at(bb);
+    }
+
+    // for debug
+    void print_ipdom(Function *f);
+    void print_control_dependence(Function *f);
+
+  private:
+    void create_reverse_post_order(Function *f);
+    void create_ipdom(Function *f);
+    void create_pdom_dfs_order(Function *f);
+    void create_control_dependence(Function *f);
+
+    BasicBlock *intersect(BasicBlock *b1, BasicBlock *b2);
+
+    // 虚拟出口 (nullptr) 的后序号最大
+    unsigned int get_post_order(BasicBlock *bb) { return post_order_.at(bb); }
+
+    std::vector<BasicBlock *> post_order_vec_{}; // 反向 CFG 上的后序
+    std::map<BasicBlock *, unsigned int> post_order_{};
+    std::map<BasicBlock *, BasicBlock *> ipdom_{}; // 直接后向支配
+    std::map<BasicBlock *, BBSet> pdom_tree_succ_blocks_{};
+
+    // 后向支配树上的 dfs 序 L,R
+    std::map<BasicBlock *, unsigned int> pdom_tree_L_;
+    std::map<BasicBlock *, unsigned int> pdom_tree_R_;
+
+    std::map<BasicBlock *, BBSet> control_dep_{};      // 控制依赖
+    std::map<BasicBlock *, BBSet> control_dep_succ_{}; // 控制依赖的逆关系
+};
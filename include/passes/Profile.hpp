@@ -0,0 +1,55 @@
+#pragma once
+
+#include "PassManager.hpp"
+
+#include <string>
+#include <unordered_map>
+
+/**
+ * 基于 profile 的优化（PGO）
+ *
+ * -fprofile-generate 在 IRBuilder 刚生成的 IR 上插入计数器：
+ * 每个块一个执行次数计数器，以条件跳转结束的块再加一个跳向真目标的
+ * 次数计数器（exceptBB 除外，它的次数就是前驱跳向它的次数），都放在全局数组 __profile_counters 中。main 的入口调用
+ * 运行时库的 __profile_init 登记该数组，程序退出时次数被写入文件
+ * （环境变量 CMINUS_PROFILE，默认 cminus.profdata），多次运行累加。
+ * 文件头记录 CFG 形状的校验和（各函数的块数与每个块的后继数），
+ * 校验和或计数器个数不同的文件视为来自另一个程序。
+ * 调用点与函数入口的次数就是所在块的次数，不需要单独计数。
+ * 计数器是 32 位的，一次运行中的计数在 2^32-1 处饱和，不会回绕；
+ * 文件中多次运行累加的计数是 64 位的。
+ *
+ * -fprofile-use=<file> 在同一位置按相同的编号读回次数（校验和不符时忽略
+ * 该文件），记录为条件跳转的分支权重、调用点的次数与函数的入口次数。
+ * 此时的 IR 只取决于源程序，
+ * 与优化选项无关；之后的变换复制指令时一并复制这些信息。
+ * 使用者：BranchProbability（从而 BlockFrequency 与 BlockPlacement）、
+ * Inliner 与 LoopUnroll。
+ */
+
+// 计数器的编号，插桩与读回共用
+struct ProfileCounters {
+    std::unordered_map<BasicBlock *, unsigned> block;
+    std::unordered_map<BasicBlock *, unsigned> taken;
+    unsigned num{0};
+    unsigned checksum{0};
+
+    explicit ProfileCounters(Module *m);
+};
+
+class ProfileInstrument : public Pass {
+  public:
+    explicit ProfileInstrument(Module *m) : Pass(m) {}
+    ~ProfileInstrument() = default;
+    void run() override;
+};
+
+class ProfileUse : public Pass {
+  public:
+    ProfileUse(Module *m, std::string file) : Pass(m), file_(std::move(file)) {}
+    ~ProfileUse() = default;
+    void run() override;
+
+  private:
+    std::string file_;
+};
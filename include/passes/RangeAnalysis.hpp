@@ -0,0 +1,73 @@
+#pragma once
+
+#include "Dominators.hpp"
+#include "Instruction.hpp"
+#include "PassManager.hpp"
+
+#include <memory>
+#include <unordered_map>
+
+/**
+ * 整数值域分析，并据此删除数组下标为负的检查
+ *
+ * 为每个 i32 / i1 的 SSA 值求一个区间 [lo, hi]。在块 bb 中使用一个值时，
+ * 还会沿支配树向上收集支配 bb 的条件跳转边，用它们的比较条件收紧区间
+ * （correlated value）：例如在 while (i < n) 的循环体中 i <= n.hi - 1。
+ * phi 合并各入边上收紧后的区间，不可达的入边（区间为空）被忽略。
+ *
+ * 用迭代求不动点；phi 的区间扩大超过 WIDEN_THRESHOLD 次后，
+ * 继续扩大的一端直接放宽到 i32 的边界，保证收敛。
+ * i32 运算按补码回绕，加减乘与移位的结果可能超出 i32 时取全集。
+ *
+ * 求解后条件的区间为单点的条件跳转改写为无条件跳转。
+ * IRBuilder 为每次数组访问生成的 exceptBB（调用 neg_idx_except 后返回）
+ * 在失去唯一的前驱后直接删除，其他不可达的块留给 DeadCode。
+ */
+class RangeAnalysis : public Pass {
+  public:
+    // 闭区间，lo > hi 表示空：值尚未求出，或所在的块不可达
+    struct Range {
+        long lo;
+        long hi;
+
+        static Range full();
+        static Range empty() { return {1, 0}; }
+        static Range point(long c) { return {c, c}; }
+        bool is_empty() const { return lo > hi; }
+        bool is_point() const { return lo == hi; }
+        Range join(const Range &rhs) const;
+        Range intersect(const Range &rhs) const;
+        bool operator==(const Range &rhs) const {
+            return (is_empty() and rhs.is_empty()) or
+                   (lo == rhs.lo and hi == rhs.hi);
+        }
+        bool operator!=(const Range &rhs) const { return not(*this == rhs); }
+    };
+
+    explicit RangeAnalysis(Module *m)
+        : Pass(m), dominators_(std::make_unique<Dominators>(m)) {}
+    ~RangeAnalysis() = default;
+    void run() override;
+    // 只做分析，不修改函数
+    void run_on_func(Function *f);
+
+    // val 在整个函数中的区间
+    Range get_range(Value *val);
+    // val 在块 bb 中的区间，bb 需要从入口可达
+    Range get_range_at(Value *val, BasicBlock *bb);
+
+  private:
+    Range get_edge_range(Value *val, BasicBlock *from, BasicBlock *to);
+    Range refine(Range range, Value *val, Value *cond, bool taken);
+    Range evaluate(Instruction *inst);
+    Range evaluate_binary(Instruction *inst, Range lhs, Range rhs);
+    static Range evaluate_cmp(Instruction::OpID op, Range lhs, Range rhs);
+    bool update(Instruction *inst, Range range);
+
+    bool fold_branches(Function *f);
+
+    std::unique_ptr<Dominators> dominators_;
+    std::unordered_map<Value *, Range> ranges_;
+    std::unordered_map<Value *, unsigned> widen_count_;
+    unsigned folded_{0};
+};
@@ -0,0 +1,48 @@
+#pragma once
+
+#include "BitVector.hpp"
+#include "DataFlow.hpp"
+#include "Instruction.hpp"
+#include "PassManager.hpp"
+
+#include <unordered_map>
+#include <vector>
+
+/**
+ * 内存上的到达定值分析
+ *
+ * 在 SSA 形式下寄存器值只有唯一定值，因此这里只分析内存：
+ * 定值是 store 指令，地址只按指针值（get_lval）区分。
+ * store 只杀死写同一个指针值的其他 store；通过不同指针写同一位置的 store
+ * 不会互相杀死，所以结果是偏保守的“可能到达”。
+ */
+class ReachingDefinitions : public Pass {
+  public:
+    explicit ReachingDefinitions(Module *m) : Pass(m) {}
+    ~ReachingDefinitions() = default;
+    void run() override;
+    void run_on_func(Function *f);
+
+    unsigned get_num_stores() const { return stores_.size(); }
+    StoreInst *get_store(unsigned idx) const { return stores_.at(idx); }
+
+    // 块开头/末尾处可能到达的 store 集合
+    const BitVector &get_reaching_in(BasicBlock *bb) const {
+        return in_.at(bb);
+    }
+    const BitVector &get_reaching_out(BasicBlock *bb) const {
+        return out_.at(bb);
+    }
+    // 可能被 load 读到的、写同一个指针值的 store
+    std::vector<StoreInst *> get_reaching_stores(LoadInst *load) const;
+
+  private:
+    struct Problem;
+
+    std::vector<StoreInst *> stores_;
+    std::unordered_map<Value *, BitVector> stores_of_addr_;
+    std::unordered_map<BasicBlock *, BitVector> gen_;
+    std::unordered_map<BasicBlock *, BitVector> kill_;
+    std::unordered_map<BasicBlock *, BitVector> in_;
+    std::unordered_map<BasicBlock *, BitVector> out_;
+};
@@ -0,0 +1,57 @@
+#pragma once
+
+#include "BasicBlock.hpp"
+#include "Constant.hpp"
+#include "PassManager.hpp"
+
+#include <deque>
+#include <set>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+
+/**
+ * 稀疏条件常量传播，参见
+ * Wegman, Zadeck. "Constant propagation with conditional branches"
+ *
+ * 格：Undef (尚未确定) > 常量 > Overdefined (不是常量)。
+ * 只沿可执行的边传播：phi 只合并来自可执行前驱的值，
+ * 条件为常量的跳转只把对应的一条出边标为可执行。
+ * 求解后把常量结果替换掉原指令，常量条件跳转改写为无条件跳转；
+ * 因此而不可达的块留给 DeadCode::clear_basic_blocks 删除。
+ */
+class SCCP : public Pass {
+  public:
+    explicit SCCP(Module *m) : Pass(m) {}
+    ~SCCP() = default;
+    void run() override;
+    bool run_on_func(Function *f);
+
+  private:
+    struct LatticeValue {
+        enum State { Undef, Const, Overdefined };
+        State state{Undef};
+        Constant *value{nullptr};
+
+        bool operator==(const LatticeValue &other) const {
+            return state == other.state and value == other.value;
+        }
+    };
+
+    LatticeValue get_lattice(Value *val);
+    void update(Instruction *inst, LatticeValue new_val);
+    static LatticeValue meet(const LatticeValue &a, const LatticeValue &b);
+
+    void mark_edge(BasicBlock *from, BasicBlock *to);
+    void visit(Instruction *inst);
+    void visit_phi(PhiInst *phi);
+    void visit_br(BranchInst *br);
+
+    bool rewrite(Function *f);
+
+    std::unordered_map<Value *, LatticeValue> lattice_;
+    std::unordered_set<BasicBlock *> executable_blocks_;
+    std::set<std::pair<BasicBlock *, BasicBlock *>> executable_edges_;
+    std::deque<std::pair<BasicBlock *, BasicBlock *>> cfg_worklist_;
+    std::deque<Instruction *> ssa_worklist_;
+};
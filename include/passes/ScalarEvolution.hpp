@@ -0,0 +1,134 @@
+#pragma once
+
+#include "Instruction.hpp"
+#include "LoopDetection.hpp"
+#include "PassManager.hpp"
+
+#include <map>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * 标量演化（归纳变量分析）
+ *
+ * 把循环中的整数值表示为 Σ 系数 × 原子 + 常量 的线性表达式，
+ * 原子是循环不变量或该循环的基本归纳变量（header 中的 phi）。
+ * 基本归纳变量是加法递推 {start,+,step}：第 k 次迭代（k 从 0 开始）
+ * 时取值 start + step × k，其中 step 是循环不变的。
+ *
+ * 在此基础上求循环的回边执行次数。跳向 exceptBB 的 exiting 块结束整个程序，
+ * 不计在内，即求的是检查都通过时的次数。其余唯一的 exiting 块是 header 或 latch，
+ * 其条件可化为 “base + stride × k < 0 时继续”，stride 为正的常量时，
+ * 第一个不满足条件的 k 就是回边执行的次数，即
+ *     max(0, ceil(-base / stride))
+ * base 为常量时得到常量次数；否则只在 stride 为 1 时给出符号形式的 -base，
+ * preheader 前的守卫保证 base - stride < 0 时结果非负，没有这样的守卫时
+ * 回边执行次数是 max(0, -base)。
+ * 比较的两个操作数在最后一次判断时，以及在第一次判断或守卫中，都要是
+ * 单个的值或 i32 常量，于是它们在各次判断中都不越出 i32 的范围，
+ * 精确计算与运行时一致。
+ *
+ * 要求循环是 LoopSimplify 规范形式。
+ */
+class ScalarEvolution : public Pass {
+  public:
+    // Σ 系数 × 值 + 常量
+    struct Expr {
+        std::map<Value *, long> terms;
+        long constant{0};
+
+        Expr() = default;
+        Expr(long c) : constant(c) {}
+        static Expr value(Value *val) {
+            Expr res;
+            res.terms[val] = 1;
+            return res;
+        }
+        bool is_constant() const { return terms.empty(); }
+        Expr operator+(const Expr &rhs) const;
+        Expr operator-(const Expr &rhs) const { return *this + rhs * -1; }
+        Expr operator*(long c) const;
+        bool operator==(const Expr &rhs) const {
+            return constant == rhs.constant and terms == rhs.terms;
+        }
+    };
+
+    // 加法递推 {start,+,step}
+    struct AddRec {
+        PhiInst *phi;
+        Expr start;
+        Expr step;
+    };
+
+    explicit ScalarEvolution(Module *m) : Pass(m) {}
+    ~ScalarEvolution() = default;
+    // 检测循环并分析每个循环的归纳变量与回边执行次数
+    void run() override;
+
+    LoopDetection &get_loop_detection() { return *loop_detection_; }
+    const std::vector<AddRec> &get_induction_vars(std::shared_ptr<Loop> loop) {
+        return loop_info_.at(loop.get()).ivs;
+    }
+    // phi 是循环 loop 的归纳变量时返回其递推，否则返回 nullptr
+    const AddRec *get_add_rec(std::shared_ptr<Loop> loop, Value *phi);
+
+    // 以循环不变量与 loop 的归纳变量表示 val，无法表示时返回 false
+    bool get_expr(Value *val, std::shared_ptr<Loop> loop, Expr &res);
+    // 把 expr 中 loop 的归纳变量替换为第 k 次迭代时的取值
+    bool evaluate_at(const Expr &expr, std::shared_ptr<Loop> loop,
+                     const Expr &k, Expr &res);
+    // 指针表示为 基址 + 字节偏移，偏移以 loop 的归纳变量与循环不变量表示
+    bool get_access_function(Value *ptr, std::shared_ptr<Loop> loop,
+                             Value *&base, Expr &offset);
+
+    // 回边执行次数，未知时返回 false
+    bool get_backedge_taken_count(std::shared_ptr<Loop> loop, Expr &res);
+    // 回边执行次数为 max(0, res)，符号形式的 res 不要求守卫保证非负
+    bool get_clamped_backedge_taken_count(std::shared_ptr<Loop> loop,
+                                          Expr &res);
+    // 决定是否退出循环的块（不含跳向 exceptBB 的块），回边执行次数未知时为 nullptr
+    BasicBlock *get_exiting_block(std::shared_ptr<Loop> loop) {
+        auto &info = loop_info_.at(loop.get());
+        return info.clamped ? nullptr : info.exiting;
+    }
+    // header 执行次数（回边执行次数 + 1）为常量时返回它，否则返回 0
+    long get_constant_trip_count(std::shared_ptr<Loop> loop);
+
+    // 在 pos 之前生成计算 expr 的指令，原子需要支配 pos
+    Value *expand(const Expr &expr, Instruction *pos);
+
+    // for debug
+    void print();
+
+  private:
+    struct LoopInfo {
+        std::vector<AddRec> ivs;
+        BasicBlock *exiting{nullptr};
+        Expr backedge_taken;
+        // backedge_taken 可能为负，实际的次数是 max(0, backedge_taken)
+        bool clamped{false};
+    };
+    // 循环的退出条件：第 k 次迭代时 base + stride × k < 0 则继续
+    struct ExitCondition {
+        Expr base;
+        Expr stride;
+        // 比较的两个操作数
+        Expr lhs;
+        Expr rhs;
+    };
+
+    void analyze_loop(std::shared_ptr<Loop> loop);
+    void find_induction_vars(std::shared_ptr<Loop> loop);
+    bool compute_backedge_taken_count(std::shared_ptr<Loop> loop);
+    bool get_exit_condition(BranchInst *br, BasicBlock *stay,
+                            std::shared_ptr<Loop> loop, ExitCondition &cond);
+    bool is_guarded(std::shared_ptr<Loop> loop, const ExitCondition &cond);
+    bool fits_at(const ExitCondition &cond, std::shared_ptr<Loop> loop,
+                 const Expr &k, bool nonneg);
+
+    std::unique_ptr<LoopDetection> loop_detection_;
+    std::unordered_map<Loop *, LoopInfo> loop_info_;
+    // 分析归纳变量时暂时当作原子的 header phi
+    std::vector<PhiInst *> candidates_;
+};
@@ -0,0 +1,50 @@
+#pragma once
+
+#include "AliasAnalysis.hpp"
+#include "Dominators.hpp"
+#include "LoopDetection.hpp"
+#include "PassManager.hpp"
+
+#include <memory>
+#include <vector>
+
+/**
+ * 标量提升：把循环中反复读写的内存位置放到 SSA 值中
+ *
+ * 对循环中被 store 的、地址是循环不变量的位置 p（标量全局变量、
+ * 下标不变的数组元素），若
+ *   - 循环中其他的 load/store 都与 p 不别名（与 p 必然别名的访问一并提升），
+ *   - 循环中的调用都不读写 p（CallGraph 的副作用摘要），
+ *   - 在 preheader 中读 p 不会出错：p 一定在某个对象的范围内，
+ *     或者某个对 p 的访问只要进入循环就一定执行，
+ * 就在 preheader 中读一次 p，循环中对 p 的 load 改为使用当前值，
+ * store 只更新当前值；多个前驱汇合处（包括 header）用 phi 合并，
+ * 每个出口块开头把当前值写回 p。
+ *
+ * 要求循环是 LoopSimplify 规范形式，出口块的前驱都在循环内。
+ * 内层循环先处理，写回的 store 位于外层循环中，随后可以在外层继续提升。
+ */
+class ScalarPromotion : public Pass {
+  public:
+    explicit ScalarPromotion(Module *m)
+        : Pass(m), alias_analysis_(std::make_unique<AliasAnalysis>(m)),
+          dominators_(std::make_unique<Dominators>(m)) {}
+    ~ScalarPromotion() = default;
+    void run() override;
+
+  private:
+    void run_on_loop(std::shared_ptr<Loop> loop);
+    bool can_promote(std::shared_ptr<Loop> loop, Value *ptr,
+                     std::vector<Instruction *> &accesses);
+    void promote(std::shared_ptr<Loop> loop, Value *ptr,
+                 const std::vector<Instruction *> &accesses);
+
+    std::unique_ptr<LoopDetection> loop_detection_;
+    std::unique_ptr<AliasAnalysis> alias_analysis_;
+    std::unique_ptr<Dominators> dominators_;
+    // 循环中读写内存的指令
+    std::vector<Instruction *> loads_stores_;
+    std::vector<CallInst *> calls_;
+    std::vector<BasicBlock *> rpo_; // 当前函数的逆后序
+    unsigned promoted_{0};
+};
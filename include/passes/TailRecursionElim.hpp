@@ -0,0 +1,45 @@
+#pragma once
+
+#include "CallGraph.hpp"
+#include "Instruction.hpp"
+#include "PassManager.hpp"
+
+#include <vector>
+
+/**
+ * 尾递归消除
+ *
+ * 把对函数自身的尾调用改写为跳回函数开头的循环：
+ * 原入口块成为循环头，为每个参数插入 phi，入边分别来自新建的入口块
+ * （原参数）与各个尾调用点（调用的实参）。
+ *
+ * 除直接返回调用结果的尾调用外，也处理累加形式的
+ *     return f(...) + k;    return f(...) * k;
+ * 此时在循环头增加一个累加值的 phi（初值为运算的单位元），
+ * 尾调用点把 k 累积进去，其余的 ret 返回 v op 累加值。
+ * 整数加法与乘法按补码回绕，满足结合律与交换律，因此改写是等价的。
+ *
+ * 需要在 mem2reg 之后运行；若实参可能指向函数自己的局部数组则不做改写，
+ * 因为改写后各层递归共用同一块栈上空间。
+ * 调用与 ret 之间的指令改写后会在下一层递归之前执行，
+ * 因此其中的 load 只在函数不写内存时允许。
+ */
+class TailRecursionElim : public Pass {
+  public:
+    explicit TailRecursionElim(Module *m) : Pass(m), call_graph_(m) {}
+    ~TailRecursionElim() = default;
+    void run() override;
+
+  private:
+    struct TailCall {
+        CallInst *call;
+        Instruction *acc_inst; // 累加形式中的 add/mul，否则为 nullptr
+    };
+
+    bool run_on_func(Function *f);
+    bool find_tail_call(BasicBlock *bb, TailCall &tail_call);
+    bool may_pass_local(CallInst *call);
+
+    CallGraph call_graph_;
+    int eliminated_{0};
+};
@@ -5,11 +5,29 @@
 #include "cminusf_builder.hpp"
 #include "CodeGen.hpp"
 #include "PassManager.hpp"
+#include "BlockPlacement.hpp"
 #include "DeadCode.hpp"
 #include "Mem2Reg.hpp"
+#include "Profile.hpp"
 #include "LoopDetection.hpp"
+#include "GVN.hpp"
+#include "Inliner.hpp"
+#include "IndVarSimplify.hpp"
+#include "InstCombine.hpp"
 #include "LICM.hpp"
+#include "LoopDeletion.hpp"
+#include "LoopRotate.hpp"
+#include "LoopSimplify.hpp"
+#include "LoopUnswitch.hpp"
+#include "LoopUnroll.hpp"
+#include "LoopVersioning.hpp"
+#include "RangeAnalysis.hpp"
+#include "SCCP.hpp"
+#include "ScalarPromotion.hpp"
+#include "TailRecursionElim.hpp"
 
+#include <cstdlib>
+#include <cstring>
 #include <filesystem>
 #include <fstream>
 #include <iostream>
@@ -26,9 +44,28 @@ struct Config {
     bool emitast{false};
     bool emitasm{false};
     bool emitllvm{false};
+    bool bound_check_trap{false};
     // optization conifg
+    bool inliner{false};
     bool mem2reg{false};
     bool licm{false};
+    bool tre{false};
+    bool sccp{false};
+    bool instcombine{false};
+    bool range_analysis{false};
+    bool gvn{false};
+    bool loop_simplify{false};
+    bool loop_versioning{false};
+    bool loop_rotate{false};
+    bool indvars{false};
+    bool loop_deletion{false};
+    bool loop_unroll{false};
+    unsigned unroll_factor{4};
+    bool loop_unswitch{false};
+    bool scalar_promotion{false};
+    bool block_placement{false};
+    bool profile_generate{false};
+    string profile_use;
 
     Config(int argc, char **argv) : argc(argc), argv(argv) {
         parse_cmd_line();
@@ -62,15 +99,81 @@ int main(int argc, char **argv) {
         m = builder.getModule();
 
         PassManager PM(m.get());
+        // profile 插桩与读回都在 IRBuilder 的结果上进行，与优化选项无关
+        if(config.profile_generate) {
+            PM.add_pass<ProfileInstrument>();
+        }
+        if(not config.profile_use.empty()) {
+            PM.add_pass<ProfileUse>(config.profile_use);
+        }
         // optimization 
+        if(config.inliner) {
+            PM.add_pass<Inliner>();
+            PM.add_pass<DeadCode>();
+        }
         if(config.mem2reg) {
             PM.add_pass<Mem2Reg>();
             PM.add_pass<DeadCode>();
         }
+        if(config.tre) {
+            PM.add_pass<TailRecursionElim>();
+            PM.add_pass<DeadCode>();
+        }
+        if(config.sccp) {
+            PM.add_pass<SCCP>();
+            PM.add_pass<DeadCode>();
+        }
+        if(config.instcombine) {
+            PM.add_pass<InstCombine>();
+            PM.add_pass<DeadCode>();
+        }
+        if(config.range_analysis) {
+            PM.add_pass<RangeAnalysis>();
+            PM.add_pass<DeadCode>();
+        }
+        if(config.gvn) {
+            PM.add_pass<GVN>();
+            PM.add_pass<DeadCode>();
+        }
+        if(config.loop_versioning) {
+            PM.add_pass<LoopVersioning>();
+            PM.add_pass<DeadCode>();
+        }
+        if(config.loop_rotate) {
+            PM.add_pass<LoopRotate>();
+            PM.add_pass<DeadCode>();
+        }
+        if(config.indvars) {
+            PM.add_pass<IndVarSimplify>();
+            PM.add_pass<DeadCode>();
+        }
+        if(config.loop_deletion) {
+            PM.add_pass<LoopDeletion>();
+            PM.add_pass<DeadCode>();
+        }
+        if(config.loop_unroll) {
+            PM.add_pass<LoopUnroll>(config.unroll_factor);
+            PM.add_pass<DeadCode>();
+        }
+        if(config.loop_simplify) {
+            PM.add_pass<LoopSimplify>();
+            PM.add_pass<DeadCode>();
+        }
         if(config.licm) {
             PM.add_pass<LoopInvariantCodeMotion>();
             PM.add_pass<DeadCode>();
         }
+        if(config.loop_unswitch) {
+            PM.add_pass<LoopUnswitch>();
+            PM.add_pass<DeadCode>();
+        }
+        if(config.scalar_promotion) {
+            PM.add_pass<ScalarPromotion>();
+            PM.add_pass<DeadCode>();
+        }
+        if(config.block_placement) {
+            PM.add_pass<BlockPlacement>();
+        }
         PM.run();
 
         std::ofstream output_stream(config.output_file);
@@ -80,7 +183,7 @@ int main(int argc, char **argv) {
             output_stream << "source_filename = " << abs_path << "\n\n";
             output_stream << m->print();
         } else if (config.emitasm) {
-            CodeGen codegen(m.get());
+            CodeGen codegen(m.get(), config.bound_check_trap);
             codegen.run();
             output_stream << codegen.print();
         }
@@ -107,10 +210,55 @@ void Config::parse_cmd_line() {
             emitasm = true;
         } else if (argv[i] == "-emit-llvm"s) {
             emitllvm = true;
+        } else if (argv[i] == "-bound-check-trap"s) {
+            bound_check_trap = true;
+        } else if (argv[i] == "-inline"s) {
+            inliner = true;
         } else if (argv[i] == "-mem2reg"s) {
             mem2reg = true;
         } else if (argv[i] == "-licm"s) {
             licm = true;
+        } else if (argv[i] == "-tre"s) {
+            tre = true;
+        } else if (argv[i] == "-sccp"s) {
+            sccp = true;
+        } else if (argv[i] == "-instcombine"s) {
+            instcombine = true;
+        } else if (argv[i] == "-range-analysis"s) {
+            range_analysis = true;
+        } else if (argv[i] == "-gvn"s) {
+            gvn = true;
+        } else if (argv[i] == "-loop-simplify"s) {
+            loop_simplify = true;
+        } else if (argv[i] == "-loop-versioning"s) {
+            loop_versioning = true;
+        } else if (argv[i] == "-loop-rotate"s) {
+            loop_rotate = true;
+        } else if (argv[i] == "-indvars"s) {
+            indvars = true;
+        } else if (argv[i] == "-loop-deletion"s) {
+            loop_deletion = true;
+        } else if (argv[i] == "-loop-unroll"s) {
+            loop_unroll = true;
+        } else if (argv[i] == "-unroll-factor"s) {
+            if (i + 1 < argc and std::atoi(argv[i + 1]) >= 2) {
+                unroll_factor = std::atoi(argv[i + 1]);
+                i += 1;
+            } else {
+                print_err("bad unroll factor");
+            }
+        } else if (argv[i] == "-loop-unswitch"s) {
+            loop_unswitch = true;
+        } else if (argv[i] == "-scalar-promotion"s) {
+            scalar_promotion = true;
+        } else if (argv[i] == "-block-placement"s) {
+            block_placement = true;
+        } else if (argv[i] == "-fprofile-generate"s) {
+            profile_generate = true;
+        } else if (string(argv[i]).rfind("-fprofile-use=", 0) == 0) {
+            profile_use = string(argv[i]).substr(strlen("-fprofile-use="));
+            if (profile_use.empty())
+                print_err("bad profile file");
         }else {
             if (input_file.empty()) {
                 input_file = argv[i];
@@ -136,9 +284,57 @@ void Config::check() {
     if (not emitllvm and not emitasm and not emitast) {
         print_err("not supported: generate executable file directly");
     }
+    if (bound_check_trap and not emitasm) {
+        print_err("bound-check-trap must be used with -S");
+    }
     if (licm and not mem2reg) {
         print_err("licm must be used with mem2reg");
     }
+    if (tre and not mem2reg) {
+        print_err("tre must be used with mem2reg");
+    }
+    if (sccp and not mem2reg) {
+        print_err("sccp must be used with mem2reg");
+    }
+    if (instcombine and not mem2reg) {
+        print_err("instcombine must be used with mem2reg");
+    }
+    if (range_analysis and not mem2reg) {
+        print_err("range-analysis must be used with mem2reg");
+    }
+    if (gvn and not mem2reg) {
+        print_err("gvn must be used with mem2reg");
+    }
+    if (loop_versioning and not mem2reg) {
+        print_err("loop-versioning must be used with mem2reg");
+    }
+    if (loop_rotate and not mem2reg) {
+        print_err("loop-rotate must be used with mem2reg");
+    }
+    if (indvars and not mem2reg) {
+        print_err("indvars must be used with mem2reg");
+    }
+    if (loop_deletion and not mem2reg) {
+        print_err("loop-deletion must be used with mem2reg");
+    }
+    if (loop_unroll and not mem2reg) {
+        print_err("loop-unroll must be used with mem2reg");
+    }
+    if (loop_unswitch and not mem2reg) {
+        print_err("loop-unswitch must be used with mem2reg");
+    }
+    if (scalar_promotion and not mem2reg) {
+        print_err("scalar-promotion must be used with mem2reg");
+    }
+    if (profile_generate and not profile_use.empty()) {
+        print_err("fprofile-generate and fprofile-use both set");
+    }
+    if (not profile_use.empty() and not std::filesystem::exists(profile_use)) {
+        print_err("cannot open profile file " + profile_use);
+    }
+    if (unroll_factor & (unroll_factor - 1)) {
+        print_err("unroll factor must be a power of 2");
+    }
     if (output_file.empty()) {
         output_file = input_file.stem();
         if (emitllvm) {
@@ -152,7 +348,14 @@ void Config::check() {
 void Config::print_help() const {
     std::cout << "Usage: " << exe_name
               << " [-h|--help] [-o <target-file>] [-emit-llvm] [-S] [-dump-json]"
-                 "[-mem2reg] [-licm]"
+                 "[-bound-check-trap] "
+                 "[-inline] [-mem2reg] [-licm] [-tre] [-sccp] [-instcombine] [-gvn]"
+                 "[-range-analysis] [-loop-simplify] [-loop-versioning] "
+                 "[-loop-rotate] [-indvars] [-loop-deletion] [-loop-unroll] "
+                 "[-unroll-factor <n>] "
+                 "[-loop-unswitch] [-scalar-promotion] [-block-placement] "
+                 "[-fprofile-generate] "
+                 "[-fprofile-use=<profile-file>] "
                  "<input-file>"
               << std::endl;
     exit(0);
@@ -2,6 +2,11 @@
 
 #include "CodeGenUtil.hpp"
 
+#include <algorithm>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
 void CodeGen::allocate() {
     // 备份 $ra $fp
     unsigned offset = PROLOGUE_OFFSET_BASE;
@@ -256,6 +261,16 @@ void CodeGen::gen_ret() {
 
 void CodeGen::gen_br() {
     auto *branchInst = static_cast<BranchInst *>(context.inst);
+    if (is_bound_check(branchInst)) {
+        // 0 <= idx 不成立时触发边界检查例外；i32 在寄存器中是符号扩展的
+        auto *cmp = static_cast<Instruction *>(branchInst->get_operand(0));
+        auto *cont_bb = static_cast<BasicBlock *>(branchInst->get_operand(2));
+        load_to_greg(cmp->get_operand(0), Reg::t(0));
+        append_inst("asrtle.d", {"$zero", Reg::t(0).print()});
+        if (cont_bb != context.next_bb)
+            append_inst("b", {label_name(cont_bb)});
+        return;
+    }
     if (branchInst->is_cond_br()) {
         // TODO: 补全条件跳转的情况
 
@@ -263,19 +278,69 @@ void CodeGen::gen_br() {
         BasicBlock *true_bb = dynamic_cast<BasicBlock *>(branchInst->get_operand(1));
         BasicBlock *false_bb = dynamic_cast<BasicBlock *>(branchInst->get_operand(2));
         load_to_greg(cond, Reg::t(0));
-        append_inst("beqz", {Reg::t(0).print(), label_name(false_bb)});
-        append_inst("b", {label_name(true_bb)});
+        // 紧随其后的目标直接顺序执行
+        if (false_bb == context.next_bb) {
+            append_inst("bnez", {Reg::t(0).print(), label_name(true_bb)});
+        } else {
+            append_inst("beqz", {Reg::t(0).print(), label_name(false_bb)});
+            if (true_bb != context.next_bb)
+                append_inst("b", {label_name(true_bb)});
+        }
 
         // throw not_implemented_error{__FUNCTION__};
     } else {
         auto *branchbb = static_cast<BasicBlock *>(branchInst->get_operand(0));
-        append_inst("b " + label_name(branchbb));
+        if (branchbb != context.next_bb)
+            append_inst("b " + label_name(branchbb));
     }
 }
 
+bool CodeGen::is_bound_check(Instruction *inst) {
+    if (not bound_check_trap or inst == nullptr or not inst->is_br())
+        return false;
+    auto *br = static_cast<BranchInst *>(inst);
+    if (not br->is_cond_br())
+        return false;
+    auto *cmp = dynamic_cast<ICmpInst *>(br->get_operand(0));
+    if (cmp == nullptr or cmp->get_instr_type() != Instruction::lt)
+        return false;
+    auto *zero = dynamic_cast<ConstantInt *>(cmp->get_operand(1));
+    return zero and zero->get_value() == 0 and
+           static_cast<BasicBlock *>(br->get_operand(1))->is_except_block();
+}
+
+bool CodeGen::is_bound_check_cond(Instruction *inst) {
+    auto &uses = inst->get_use_list();
+    return bound_check_trap and uses.size() == 1 and
+           is_bound_check(static_cast<Instruction *>(uses.front().val_));
+}
+
+bool CodeGen::is_trapped_except_block(BasicBlock *bb) {
+    auto &preds = bb->get_pre_basic_blocks();
+    return bound_check_trap and bb->is_except_block() and not preds.empty() and
+           std::all_of(preds.begin(), preds.end(), [&](BasicBlock *pred) {
+               return is_bound_check(pred->get_terminator());
+           });
+}
+
 void CodeGen::gen_binary() {
-    load_to_greg(context.inst->get_operand(0), Reg::t(0));
-    load_to_greg(context.inst->get_operand(1), Reg::t(1));
+    auto *inst = context.inst;
+    auto *lhs = inst->get_operand(0);
+    auto *rhs = inst->get_operand(1);
+    // 可交换运算的常量操作数换到右边，以便使用立即数形式或强度削弱
+    if ((inst->is_add() or inst->is_mul() or inst->is_bitwise()) and
+        dynamic_cast<ConstantInt *>(lhs) and
+        not dynamic_cast<ConstantInt *>(rhs))
+        std::swap(lhs, rhs);
+
+    load_to_greg(lhs, Reg::t(0));
+    if (auto *c = dynamic_cast<ConstantInt *>(rhs)) {
+        if (gen_binary_imm(c->get_value())) {
+            store_from_greg(context.inst, Reg::t(2));
+            return;
+        }
+    }
+    load_to_greg(rhs, Reg::t(1));
     switch (context.inst->get_instr_type()) {
     case Instruction::add:
         output.emplace_back("add.w $t2, $t0, $t1");
@@ -289,12 +354,261 @@ void CodeGen::gen_binary() {
     case Instruction::sdiv:
         output.emplace_back("div.w $t2, $t0, $t1");
         break;
+    case Instruction::srem:
+        output.emplace_back("mod.w $t2, $t0, $t1");
+        break;
+    case Instruction::shl:
+        output.emplace_back("sll.w $t2, $t0, $t1");
+        break;
+    case Instruction::ashr:
+        output.emplace_back("sra.w $t2, $t0, $t1");
+        break;
+    case Instruction::lshr:
+        output.emplace_back("srl.w $t2, $t0, $t1");
+        break;
+    case Instruction::and_:
+        output.emplace_back("and $t2, $t0, $t1");
+        break;
+    case Instruction::or_:
+        output.emplace_back("or $t2, $t0, $t1");
+        break;
+    case Instruction::xor_:
+        output.emplace_back("xor $t2, $t0, $t1");
+        break;
     default:
         assert(false);
     }
     store_from_greg(context.inst, Reg::t(2));
 }
 
+/**
+ * @brief 右操作数为常量 imm 时生成 $t2 = $t0 op imm
+ * @return 是否已生成；否则由调用者按寄存器形式生成
+ */
+bool CodeGen::gen_binary_imm(int32_t imm) {
+    switch (context.inst->get_instr_type()) {
+    case Instruction::add:
+        if (not IS_IMM_12(imm))
+            return false;
+        output.emplace_back("addi.w $t2, $t0, " + std::to_string(imm));
+        return true;
+    case Instruction::mul:
+        return gen_mul_by_const(imm);
+    case Instruction::sdiv:
+        return gen_sdiv_by_const(imm);
+    case Instruction::shl:
+        output.emplace_back("slli.w $t2, $t0, " + std::to_string(imm & 31));
+        return true;
+    case Instruction::ashr:
+        output.emplace_back("srai.w $t2, $t0, " + std::to_string(imm & 31));
+        return true;
+    case Instruction::lshr:
+        output.emplace_back("srli.w $t2, $t0, " + std::to_string(imm & 31));
+        return true;
+    // andi/ori/xori 的立即数是零扩展的 12 位
+    case Instruction::and_:
+    case Instruction::or_:
+    case Instruction::xor_: {
+        if (imm < 0 or imm > LOW_12_MASK)
+            return false;
+        auto op = context.inst->is_and()  ? "andi"
+                  : context.inst->is_or() ? "ori"
+                                          : "xori";
+        output.emplace_back(std::string(op) + " $t2, $t0, " +
+                            std::to_string(imm));
+        return true;
+    }
+    default:
+        return false;
+    }
+}
+
+namespace {
+
+// 乘数的一项：± (x << shift)
+struct MulTerm {
+    unsigned shift;
+    bool neg;
+};
+
+/**
+ * @brief 求 c 在模 2^32 意义下的非相邻形式 (NAF)
+ *
+ * NAF 中相邻两位不同时非零，非零位数最少，例如 15 = 16 - 1；
+ * 超出 2^31 的项在模 2^32 下为 0，直接丢弃
+ */
+std::vector<MulTerm> naf_terms(uint32_t c) {
+    std::vector<MulTerm> terms;
+    uint64_t val = c;
+    for (unsigned shift = 0; val != 0 and shift < 32; ++shift, val >>= 1) {
+        if ((val & 1) == 0)
+            continue;
+        if ((val & 3) == 3) {
+            terms.push_back({shift, true});
+            val += 1;
+        } else {
+            terms.push_back({shift, false});
+            val -= 1;
+        }
+    }
+    return terms;
+}
+
+// 移位加减序列的关键路径延迟：各项的移位可以并行，加减依次进行
+int shift_add_latency(const std::vector<MulTerm> &terms) {
+    bool has_shift = false, has_pos = false;
+    for (auto &term : terms) {
+        has_shift |= term.shift != 0;
+        has_pos |= not term.neg;
+    }
+    return (has_shift ? LATENCY_ALU : 0) +
+           static_cast<int>(terms.size() - 1) * LATENCY_ALU +
+           (has_pos ? 0 : LATENCY_ALU);
+}
+
+/**
+ * @brief 有符号除以常量 d 的魔数 (Granlund-Montgomery)
+ *
+ * 要求 |d| >= 2。取 M = ceil(2^(32+s) / |d|)（d < 0 时取负）的低 32 位，
+ * 则 x / d = mulh(x, M) 经修正、算术右移 s 位后加上符号位。
+ * 算法见 Hacker's Delight 10-1 节。
+ */
+std::pair<int32_t, unsigned> sdiv_magic(int32_t d) {
+    const uint32_t two31 = 0x80000000u;
+    uint32_t ad = d < 0 ? 0u - static_cast<uint32_t>(d) : d;
+    uint32_t t = two31 + (static_cast<uint32_t>(d) >> 31);
+    uint32_t anc = t - 1 - t % ad; // |nc|
+    unsigned p = 31;
+    uint32_t q1 = two31 / anc, r1 = two31 - q1 * anc;
+    uint32_t q2 = two31 / ad, r2 = two31 - q2 * ad;
+    uint32_t delta;
+    do {
+        ++p;
+        q1 *= 2;
+        r1 *= 2;
+        if (r1 >= anc) {
+            ++q1;
+            r1 -= anc;
+        }
+        q2 *= 2;
+        r2 *= 2;
+        if (r2 >= ad) {
+            ++q2;
+            r2 -= ad;
+        }
+        delta = ad - r2;
+    } while (q1 < delta or (q1 == delta and r1 == 0));
+    uint32_t magic = q2 + 1;
+    if (d < 0)
+        magic = 0u - magic;
+    return {static_cast<int32_t>(magic), p - 32};
+}
+
+} // namespace
+
+/**
+ * @brief 乘以常量的强度削弱：$t2 = $t0 * c
+ *
+ * 把 c 与 -c 分别写成 NAF，按项数较少的一种生成移位与加减序列，
+ * 只有关键路径延迟低于 mul.w 时才采用。
+ */
+bool CodeGen::gen_mul_by_const(int32_t c) {
+    if (c == 0) {
+        output.emplace_back("addi.w $t2, $zero, 0");
+        return true;
+    }
+    auto terms = naf_terms(static_cast<uint32_t>(c));
+    auto neg_terms = naf_terms(0u - static_cast<uint32_t>(c));
+    for (auto &term : neg_terms)
+        term.neg = not term.neg;
+    if (shift_add_latency(neg_terms) < shift_add_latency(terms))
+        terms = std::move(neg_terms);
+    if (shift_add_latency(terms) >= LATENCY_MUL)
+        return false;
+
+    // 先生成一个正项，避免多余的取负
+    std::stable_partition(terms.begin(), terms.end(),
+                          [](const MulTerm &term) { return not term.neg; });
+    auto shifted = [&](const MulTerm &term, const char *reg) -> std::string {
+        if (term.shift == 0)
+            return "$t0";
+        output.emplace_back(std::string("slli.w ") + reg + ", $t0, " +
+                            std::to_string(term.shift));
+        return reg;
+    };
+    auto first = shifted(terms[0], "$t2");
+    if (terms[0].neg)
+        output.emplace_back("sub.w $t2, $zero, " + first);
+    else if (first != "$t2")
+        output.emplace_back("add.w $t2, " + first + ", $zero");
+    for (size_t i = 1; i < terms.size(); ++i) {
+        auto src = shifted(terms[i], "$t1");
+        output.emplace_back(std::string(terms[i].neg ? "sub.w" : "add.w") +
+                            " $t2, $t2, " + src);
+    }
+    return true;
+}
+
+/**
+ * @brief 有符号除以常量的强度削弱：$t2 = $t0 / d
+ *
+ * 除法向零取整，不能直接用算术右移：
+ *   - d = ±2^k：负数先加上偏置 2^k - 1 再右移，d < 0 时结果取负
+ *   - 其他 d：用 mulh.w 乘以魔数后修正，见 sdiv_magic
+ * 除以 0 保留 div.w，保持运行时的行为。
+ */
+bool CodeGen::gen_sdiv_by_const(int32_t d) {
+    if (d == 0)
+        return false;
+    if (d == 1 or d == -1) {
+        output.emplace_back(d == 1 ? "add.w $t2, $t0, $zero"
+                                   : "sub.w $t2, $zero, $t0");
+        return true;
+    }
+
+    uint32_t ad = d < 0 ? 0u - static_cast<uint32_t>(d) : d;
+    if ((ad & (ad - 1)) == 0) {
+        unsigned k = __builtin_ctz(ad);
+        int latency = (k == 1 ? 3 : 4) * LATENCY_ALU + (d < 0 ? 1 : 0);
+        if (latency >= LATENCY_DIV)
+            return false;
+        // 偏置 = x < 0 ? 2^k - 1 : 0
+        if (k == 1) {
+            output.emplace_back("srli.w $t1, $t0, 31");
+        } else {
+            output.emplace_back("srai.w $t1, $t0, 31");
+            output.emplace_back("srli.w $t1, $t1, " + std::to_string(32 - k));
+        }
+        output.emplace_back("add.w $t1, $t0, $t1");
+        output.emplace_back("srai.w $t2, $t1, " + std::to_string(k));
+        if (d < 0)
+            output.emplace_back("sub.w $t2, $zero, $t2");
+        return true;
+    }
+
+    auto [magic, shift] = sdiv_magic(d);
+    bool add_x = d > 0 and magic < 0, sub_x = d < 0 and magic > 0;
+    int latency = LATENCY_MUL + (add_x or sub_x ? LATENCY_ALU : 0) +
+                  (shift > 0 ? LATENCY_ALU : 0) + 2 * LATENCY_ALU;
+    if (latency >= LATENCY_DIV)
+        return false;
+    if (IS_IMM_12(magic))
+        output.emplace_back("addi.w $t1, $zero, " + std::to_string(magic));
+    else
+        load_large_int32(magic, Reg::t(1));
+    output.emplace_back("mulh.w $t2, $t0, $t1");
+    if (add_x)
+        output.emplace_back("add.w $t2, $t2, $t0");
+    if (sub_x)
+        output.emplace_back("sub.w $t2, $t2, $t0");
+    if (shift > 0)
+        output.emplace_back("srai.w $t2, $t2, " + std::to_string(shift));
+    // 商为负时加 1，使结果向零取整
+    output.emplace_back("srli.w $t1, $t2, 31");
+    output.emplace_back("add.w $t2, $t2, $t1");
+    return true;
+}
+
 void CodeGen::gen_float_binary() {
     // TODO: 浮点类型的二元指令
 
@@ -715,9 +1029,29 @@ void CodeGen::run() {
             allocate();
             // 生成 prologue
             gen_prologue();
+            // 下标检查翻译为 asrtle.d 时，由运行时库安装 SIGSEGV 处理函数
+            if (bound_check_trap and func.get_name() == "main")
+                append_inst("bl ", {"__bound_check_init"});
 
+            // 按输出顺序排列的块，用于省去跳向下一个块的分支
+            std::vector<BasicBlock *> blocks;
+            std::unordered_map<BasicBlock *, unsigned> index;
             for (auto &bb : func.get_basic_blocks()) {
+                if (is_trapped_except_block(&bb))
+                    continue;
+                index[&bb] = blocks.size();
+                blocks.push_back(&bb);
+            }
+            for (unsigned i = 0; i < blocks.size(); ++i) {
+                auto &bb = *blocks[i];
                 context.bb = &bb;
+                context.next_bb = i + 1 < blocks.size() ? blocks[i + 1] : nullptr;
+                // 有来自后面的块的跳转（循环的回边）时，按 16 字节对齐
+                auto &preds = bb.get_pre_basic_blocks();
+                if (std::any_of(preds.begin(), preds.end(), [&](auto pred) {
+                        return index.count(pred) and index.at(pred) >= i;
+                    }))
+                    append_inst(".p2align", {"4"}, ASMInstruction::Atrribute);
                 append_inst(label_name(context.bb), ASMInstruction::Label);
                 for (auto &instr : bb.get_instructions()) {
                     // For debug
@@ -735,6 +1069,13 @@ void CodeGen::run() {
                     case Instruction::sub:
                     case Instruction::mul:
                     case Instruction::sdiv:
+                    case Instruction::srem:
+                    case Instruction::shl:
+                    case Instruction::ashr:
+                    case Instruction::lshr:
+                    case Instruction::and_:
+                    case Instruction::or_:
+                    case Instruction::xor_:
                         gen_binary();
                         break;
                     case Instruction::fadd:
@@ -762,7 +1103,8 @@ void CodeGen::run() {
                     case Instruction::lt:
                     case Instruction::eq:
                     case Instruction::ne:
-                        gen_icmp();
+                        if (not is_bound_check_cond(&instr))
+                            gen_icmp();
                         break;
                     case Instruction::fge:
                     case Instruction::fgt:
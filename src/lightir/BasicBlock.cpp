@@ -35,11 +35,25 @@ Instruction *BasicBlock::get_terminator() {
     return &instr_list_.back();
 }
 
+bool BasicBlock::is_except_block() {
+    if (instr_list_.empty() or not instr_list_.front().is_call())
+        return false;
+    auto callee = static_cast<Function *>(instr_list_.front().get_operand(0));
+    return callee->is_neg_idx_except();
+}
+
 void BasicBlock::add_instruction(Instruction *instr) {
     assert(not is_terminated() && "Inserting instruction to terminated bb");
     instr_list_.push_back(instr);
 }
 
+void BasicBlock::insert_instr_before(Instruction *pos, Instruction *instr) {
+    assert(pos->get_parent() == this &&
+           "Inserting before an instruction of another bb");
+    instr->set_parent(this);
+    instr_list_.insert(pos->getIterator(), instr);
+}
+
 std::string BasicBlock::print() {
     std::string bb_ir;
     bb_ir += this->get_name();
@@ -37,6 +37,20 @@ std::string print_instr_op_name(Instruction::OpID id) {
         return "mul";
     case Instruction::sdiv:
         return "sdiv";
+    case Instruction::srem:
+        return "srem";
+    case Instruction::shl:
+        return "shl";
+    case Instruction::ashr:
+        return "ashr";
+    case Instruction::lshr:
+        return "lshr";
+    case Instruction::and_:
+        return "and";
+    case Instruction::or_:
+        return "or";
+    case Instruction::xor_:
+        return "xor";
     case Instruction::fadd:
         return "fadd";
     case Instruction::fsub:
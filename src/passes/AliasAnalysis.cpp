@@ -0,0 +1,191 @@
+#include "AliasAnalysis.hpp"
+#include "Constant.hpp"
+#include "Function.hpp"
+#include "GlobalVariable.hpp"
+
+/**
+ * @brief 沿 getelementptr 把指针分解为基址、变量下标与常量偏移
+ *
+ * 每个 gep 的第一个下标按指针所指类型的大小缩放，
+ * 之后的下标依次按数组元素类型的大小缩放。
+ */
+AliasAnalysis::DecomposedPointer AliasAnalysis::decompose(Value *ptr) {
+    DecomposedPointer res;
+    while (auto gep = dynamic_cast<GetElementPtrInst *>(ptr)) {
+        auto base = gep->get_operand(0);
+        auto type = base->get_type()->get_pointer_element_type();
+        for (unsigned i = 1; i < gep->get_num_operand(); ++i) {
+            if (i > 1)
+                type = type->get_array_element_type();
+            long scale = type->get_size();
+            auto idx = gep->get_operand(i);
+            if (auto c = dynamic_cast<ConstantInt *>(idx))
+                res.offset += scale * c->get_value();
+            else
+                res.var_indices[idx] += scale;
+        }
+        ptr = base;
+    }
+    res.base = ptr;
+    return res;
+}
+
+/**
+ * @brief 求指针所指向的底层对象
+ *
+ * 沿 getelementptr 向上找；mem2reg 之前数组参数先被存入一个局部变量，
+ * 使用时再 load 出来，若该局部变量只被写入过同一个值，就继续追踪这个值。
+ */
+Value *AliasAnalysis::get_underlying_object(Value *ptr) {
+    while (true) {
+        if (dynamic_cast<GlobalVariable *>(ptr) or
+            dynamic_cast<Argument *>(ptr))
+            return ptr;
+        auto inst = dynamic_cast<Instruction *>(ptr);
+        if (inst == nullptr)
+            return nullptr;
+        if (inst->is_alloca())
+            return ptr;
+        if (inst->is_gep()) {
+            ptr = inst->get_operand(0);
+            continue;
+        }
+        if (inst->is_load()) {
+            auto slot = dynamic_cast<Instruction *>(
+                static_cast<LoadInst *>(inst)->get_lval());
+            if (slot == nullptr or not slot->is_alloca())
+                return nullptr;
+            Value *stored = nullptr;
+            for (auto &use : slot->get_use_list()) {
+                auto store = dynamic_cast<StoreInst *>(use.val_);
+                if (store == nullptr or store->get_lval() != slot)
+                    continue;
+                if (stored != nullptr and stored != store->get_rval())
+                    return nullptr;
+                stored = store->get_rval();
+            }
+            if (stored == nullptr)
+                return nullptr;
+            ptr = stored;
+            continue;
+        }
+        return nullptr;
+    }
+}
+
+bool AliasAnalysis::is_identified_object(Value *obj) {
+    if (dynamic_cast<GlobalVariable *>(obj))
+        return true;
+    auto inst = dynamic_cast<Instruction *>(obj);
+    return inst and inst->is_alloca();
+}
+
+AliasResult AliasAnalysis::alias(Value *p1, Value *p2) {
+    if (p1 == p2)
+        return AliasResult::MustAlias;
+
+    auto o1 = get_underlying_object(p1);
+    auto o2 = get_underlying_object(p2);
+    if (o1 and o2 and o1 != o2) {
+        if (is_identified_object(o1) and is_identified_object(o2))
+            return AliasResult::NoAlias;
+        // 参数不可能指向被调用函数自己的 alloca；
+        // C-minus 只能传递数组，参数也不会指向标量全局变量
+        auto arg_cannot_point_to = [](Value *v) {
+            auto inst = dynamic_cast<Instruction *>(v);
+            if (inst and inst->is_alloca())
+                return true;
+            auto global = dynamic_cast<GlobalVariable *>(v);
+            return global and not global->get_type()
+                                      ->get_pointer_element_type()
+                                      ->is_array_type();
+        };
+        if ((arg_cannot_point_to(o1) and dynamic_cast<Argument *>(o2)) or
+            (arg_cannot_point_to(o2) and dynamic_cast<Argument *>(o1)))
+            return AliasResult::NoAlias;
+    }
+
+    auto d1 = decompose(p1);
+    auto d2 = decompose(p2);
+    if (d1.base == d2.base and d1.var_indices == d2.var_indices) {
+        // 访问的都是 4 字节的 i32/float，偏移不同就不重叠
+        return d1.offset == d2.offset ? AliasResult::MustAlias
+                                      : AliasResult::NoAlias;
+    }
+    return AliasResult::MayAlias;
+}
+
+ModRefInfo AliasAnalysis::get_mod_ref(Instruction *inst, Value *ptr) {
+    if (auto load = dynamic_cast<LoadInst *>(inst))
+        return alias(load->get_lval(), ptr) == AliasResult::NoAlias
+                   ? NoModRef
+                   : Ref;
+    if (auto store = dynamic_cast<StoreInst *>(inst))
+        return alias(store->get_lval(), ptr) == AliasResult::NoAlias
+                   ? NoModRef
+                   : Mod;
+    if (auto call = dynamic_cast<CallInst *>(inst))
+        return get_call_mod_ref(call, ptr);
+    return NoModRef;
+}
+
+/**
+ * @brief call 对 ptr 的 mod/ref
+ *
+ * 被调用者只能通过全局变量和指针参数访问调用者可见的内存：
+ * 调用者的 alloca 只能经由实参被访问；全局变量看摘要中的全局变量集合；
+ * 参数指向的内存可能是任何全局变量或实参。
+ */
+ModRefInfo AliasAnalysis::get_call_mod_ref(CallInst *call, Value *ptr) {
+    auto callee = static_cast<Function *>(call->get_operand(0));
+    auto &sum = call_graph_.get_summary(callee);
+    unsigned res = NoModRef;
+
+    for (auto arg_no : sum.args_read)
+        if (alias(call->get_operand(arg_no + 1), ptr) != AliasResult::NoAlias)
+            res |= Ref;
+    for (auto arg_no : sum.args_written)
+        if (alias(call->get_operand(arg_no + 1), ptr) != AliasResult::NoAlias)
+            res |= Mod;
+
+    auto obj = get_underlying_object(ptr);
+    auto inst = dynamic_cast<Instruction *>(obj);
+    if (inst and inst->is_alloca()) {
+        // 未知的访问只可能经由传入的指针
+        bool escapes = false;
+        for (unsigned i = 1; i < call->get_num_operand(); ++i)
+            if (call->get_operand(i)->get_type()->is_pointer_type() and
+                alias(call->get_operand(i), ptr) != AliasResult::NoAlias)
+                escapes = true;
+        if (escapes and sum.reads_unknown)
+            res |= Ref;
+        if (escapes and sum.writes_unknown)
+            res |= Mod;
+        return static_cast<ModRefInfo>(res);
+    }
+
+    auto global = dynamic_cast<GlobalVariable *>(obj);
+    if (sum.reads_unknown or
+        (global ? sum.globals_read.count(global) != 0
+                : not sum.globals_read.empty()))
+        res |= Ref;
+    if (sum.writes_unknown or
+        (global ? sum.globals_written.count(global) != 0
+                : not sum.globals_written.empty()))
+        res |= Mod;
+    return static_cast<ModRefInfo>(res);
+}
+
+bool AliasAnalysis::is_known_dereferenceable(Value *ptr) {
+    auto d = decompose(ptr);
+    if (not d.var_indices.empty())
+        return false;
+    long size;
+    if (auto global = dynamic_cast<GlobalVariable *>(d.base))
+        size = global->get_type()->get_pointer_element_type()->get_size();
+    else if (auto alloca = dynamic_cast<AllocaInst *>(d.base))
+        size = alloca->get_alloca_type()->get_size();
+    else
+        return false;
+    return d.offset >= 0 and d.offset + 4 <= size;
+}
@@ -0,0 +1,143 @@
+#include "AvailableExpressions.hpp"
+#include "BasicBlock.hpp"
+#include "Function.hpp"
+
+#include <algorithm>
+
+/**
+ * @brief 可用表达式的数据流方程（前向、交）
+ *
+ * in(B)  = ⋂_{P ∈ pred(B)} out(P)，入口处为空集
+ * out(B) = gen(B) ∪ (in(B) - kill(B))
+ */
+struct AvailableExpressions::Problem {
+    using Domain = BitVector;
+    static constexpr DataFlowDirection direction = DataFlowDirection::Forward;
+
+    AvailableExpressions &ae;
+
+    Domain top() { return BitVector(ae.exprs_.size(), true); }
+    Domain boundary() { return BitVector(ae.exprs_.size()); }
+    void meet(Domain &acc, const Domain &val, BasicBlock *, BasicBlock *) {
+        acc &= val;
+    }
+    Domain transfer(BasicBlock *bb, const Domain &in) {
+        Domain out = in;
+        out.reset(ae.kill_.at(bb));
+        out |= ae.gen_.at(bb);
+        return out;
+    }
+};
+
+bool AvailableExpressions::is_candidate(Instruction *inst) {
+    return inst->isBinary() or inst->is_cmp() or inst->is_fcmp() or
+           inst->is_zext() or inst->is_fp2si() or inst->is_si2fp() or
+           inst->is_gep() or inst->is_load();
+}
+
+void AvailableExpressions::run() {
+    for (auto &f1 : m_->get_functions()) {
+        auto f = &f1;
+        if (f->is_declaration())
+            continue;
+        run_on_func(f);
+    }
+}
+
+void AvailableExpressions::run_on_func(Function *f) {
+    exprs_.clear();
+    expr_index_.clear();
+    inst_expr_.clear();
+    expr_users_.clear();
+    gen_.clear();
+    kill_.clear();
+    in_.clear();
+    out_.clear();
+
+    for (auto &bb : f->get_basic_blocks()) {
+        for (auto &inst1 : bb.get_instructions()) {
+            auto inst = &inst1;
+            if (not is_candidate(inst))
+                continue;
+            Expression expr{inst->get_instr_type(), inst->get_operands()};
+            if (inst->is_add() or inst->is_mul() or inst->is_bitwise() or
+                inst->is_fadd() or inst->is_fmul() or
+                inst->get_instr_type() == Instruction::eq or
+                inst->get_instr_type() == Instruction::ne or
+                inst->get_instr_type() == Instruction::feq or
+                inst->get_instr_type() == Instruction::fne)
+                std::sort(expr.second.begin(), expr.second.end());
+            auto [it, inserted] = expr_index_.emplace(expr, exprs_.size());
+            if (inserted)
+                exprs_.push_back(expr);
+            inst_expr_[inst] = it->second;
+        }
+    }
+    unsigned n = exprs_.size();
+    load_exprs_.resize(n);
+    for (unsigned i = 0; i < n; ++i) {
+        if (exprs_[i].first == Instruction::load)
+            load_exprs_.set(i);
+        for (auto op : exprs_[i].second) {
+            auto &users = expr_users_[op];
+            if (users.size() == 0)
+                users.resize(n);
+            users.set(i);
+        }
+    }
+
+    for (auto &bb1 : f->get_basic_blocks()) {
+        auto bb = &bb1;
+        auto &gen = gen_[bb];
+        auto &kill = kill_[bb];
+        gen.resize(n);
+        kill.resize(n);
+        for (auto &inst1 : bb->get_instructions()) {
+            auto inst = &inst1;
+            if (kills_loads(inst)) {
+                gen.reset(load_exprs_);
+                kill |= load_exprs_;
+            }
+            auto it = inst_expr_.find(inst);
+            if (it != inst_expr_.end())
+                gen.set(it->second);
+            // 循环中重新定值后，用到旧值的表达式失效
+            auto users = expr_users_.find(inst);
+            if (users != expr_users_.end()) {
+                gen.reset(users->second);
+                kill |= users->second;
+            }
+        }
+    }
+
+    Problem problem{*this};
+    DataFlowSolver<Problem> solver(problem);
+    solver.solve(f);
+    for (auto &bb1 : f->get_basic_blocks()) {
+        auto bb = &bb1;
+        in_[bb] = solver.get_block_entry(bb);
+        out_[bb] = solver.get_block_exit(bb);
+    }
+}
+
+bool AvailableExpressions::is_available(Instruction *inst) const {
+    auto it = inst_expr_.find(inst);
+    if (it == inst_expr_.end())
+        return false;
+    unsigned idx = it->second;
+    bool is_load = load_exprs_.test(idx);
+    bool available = in_.at(inst->get_parent()).test(idx);
+    for (auto &prev : inst->get_parent()->get_instructions()) {
+        if (&prev == inst)
+            break;
+        if (is_load and kills_loads(&prev))
+            available = false;
+        auto prev_expr = inst_expr_.find(&prev);
+        if (prev_expr != inst_expr_.end() and prev_expr->second == idx)
+            available = true;
+        auto users = expr_users_.find(&prev);
+        if (users != expr_users_.end() and users->second.test(idx))
+            available = false;
+    }
+    return available;
+}
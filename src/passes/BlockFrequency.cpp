@@ -0,0 +1,73 @@
+#include "BlockFrequency.hpp"
+#include "CFGUtil.hpp"
+#include "Function.hpp"
+
+#include <algorithm>
+#include <unordered_set>
+
+namespace {
+constexpr double MAX_LOOP_SCALE = 1024;
+} // namespace
+
+void BlockFrequency::run() {
+    scales_.clear();
+    freqs_.clear();
+    bpi_->run();
+    for (auto &f : m_->get_functions())
+        if (not f.is_declaration())
+            run_on_func(&f);
+}
+
+double BlockFrequency::get_freq(BasicBlock *bb) {
+    auto it = freqs_.find(bb);
+    return it == freqs_.end() ? 0 : it->second;
+}
+
+void BlockFrequency::run_on_func(Function *f) {
+    auto rpo = reverse_post_order(f);
+    // 同一函数中内层循环在前
+    for (auto &loop : bpi_->get_loop_detection().get_loops()) {
+        auto header = loop->get_header();
+        if (header->get_parent() != f)
+            continue;
+        auto local = propagate(rpo, header, loop.get());
+        double back = 0;
+        for (auto latch : loop->get_latches())
+            back += local[latch] * bpi_->get_edge_prob(latch, header);
+        scales_[header] = 1 / std::max(1 - back, 1 / MAX_LOOP_SCALE);
+    }
+    for (auto [bb, freq] : propagate(rpo, f->get_entry_block(), nullptr))
+        freqs_[bb] = freq;
+}
+
+std::unordered_map<BasicBlock *, double>
+BlockFrequency::propagate(const std::vector<BasicBlock *> &rpo,
+                          BasicBlock *entry, Loop *loop) {
+    std::unordered_map<BasicBlock *, double> freqs;
+    for (auto bb : rpo) {
+        if (loop and not loop->contains(bb))
+            continue;
+        double freq = 0;
+        if (bb == entry) {
+            freq = 1;
+        } else {
+            // 两个目标相同的条件跳转在前驱列表中出现两次，只计一次
+            std::unordered_set<BasicBlock *> visited;
+            for (auto pred : bb->get_pre_basic_blocks()) {
+                if (not visited.insert(pred).second)
+                    continue;
+                auto it = freqs.find(pred);
+                // 区域外的前驱、回边与不可归约的环上尚未求出的前驱不计
+                if (it == freqs.end() or bpi_->is_back_edge(pred, bb))
+                    continue;
+                freq += it->second * bpi_->get_edge_prob(pred, bb);
+            }
+        }
+        // 正在求的循环自身的 header 不放大
+        auto scale = scales_.find(bb);
+        if (scale != scales_.end() and (loop == nullptr or bb != entry))
+            freq *= scale->second;
+        freqs[bb] = freq;
+    }
+    return freqs;
+}
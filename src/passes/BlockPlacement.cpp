@@ -0,0 +1,87 @@
+#include "BlockPlacement.hpp"
+#include "CFGUtil.hpp"
+#include "Function.hpp"
+#include "logging.hpp"
+
+#include <algorithm>
+#include <vector>
+
+namespace {
+// 频率低于入口的这一倍数的块视为冷块
+constexpr double COLD_FREQ = 1.0 / 4096;
+} // namespace
+
+void BlockPlacement::run() {
+    freq_->run();
+    for (auto &f : m_->get_functions())
+        if (not f.is_declaration())
+            place(&f);
+    LOG_INFO << "block placement moved " << moved_ << " blocks";
+}
+
+bool BlockPlacement::is_cold(BasicBlock *bb) {
+    return freq_->get_branch_probability().is_cold(bb) or
+           freq_->get_freq(bb) < COLD_FREQ;
+}
+
+void BlockPlacement::place(Function *f) {
+    auto rpo = reverse_post_order(f);
+    reachable_ = {rpo.begin(), rpo.end()};
+    placed_.clear();
+
+    std::vector<BasicBlock *> layout;
+    auto next_in_rpo = rpo.begin();
+    auto bb = f->get_entry_block();
+    while (bb != nullptr) {
+        layout.push_back(bb);
+        placed_.insert(bb);
+        bb = best_successor(bb);
+        if (bb != nullptr)
+            continue;
+        next_in_rpo = std::find_if(next_in_rpo, rpo.end(), [&](auto bb) {
+            return not placed_.count(bb) and not is_cold(bb);
+        });
+        if (next_in_rpo != rpo.end())
+            bb = *next_in_rpo;
+    }
+    for (auto bb : rpo)
+        if (not placed_.count(bb))
+            layout.push_back(bb);
+    for (auto &bb : f->get_basic_blocks())
+        if (not reachable_.count(&bb))
+            layout.push_back(&bb);
+
+    auto &bbs = f->get_basic_blocks();
+    auto it = bbs.begin();
+    for (auto bb : layout) {
+        if (&*it == bb) {
+            ++it;
+            continue;
+        }
+        bbs.remove(bb);
+        bbs.insert(it, bb);
+        ++moved_;
+    }
+}
+
+BasicBlock *BlockPlacement::best_successor(BasicBlock *bb) {
+    auto &bpi = freq_->get_branch_probability();
+    BasicBlock *best = nullptr;
+    double best_freq = 0;
+    for (auto succ : bb->get_succ_basic_blocks()) {
+        if (placed_.count(succ) or is_cold(succ))
+            continue;
+        auto &preds = succ->get_pre_basic_blocks();
+        // 还有别的前驱没有放好时，succ 接在它们后面可能更好
+        bool ready = std::all_of(preds.begin(), preds.end(), [&](auto pred) {
+            return placed_.count(pred) or not reachable_.count(pred) or
+                   bpi.is_back_edge(pred, succ);
+        });
+        auto edge_freq = freq_->get_edge_freq(bb, succ);
+        if (ready and (best == nullptr or edge_freq > best_freq)) {
+            best = succ;
+            best_freq = edge_freq;
+        }
+    }
+    return best;
+}
@@ -0,0 +1,115 @@
+#include "BranchProbability.hpp"
+#include "Function.hpp"
+
+#include <algorithm>
+
+namespace {
+// 通向冷块的边的概率
+constexpr double COLD_PROB = 1.0 / (1 << 20);
+// 留在循环中的边的概率
+constexpr double LOOP_TAKEN_PROB = 124.0 / 128;
+
+// 调用不返回的运行时函数
+bool calls_noreturn(BasicBlock *bb) {
+    for (auto &inst : bb->get_instructions()) {
+        if (inst.is_call() and
+            static_cast<Function *>(inst.get_operand(0))->is_neg_idx_except())
+            return true;
+    }
+    return false;
+}
+} // namespace
+
+void BranchProbability::run() {
+    headers_.clear();
+    innermost_.clear();
+    cold_.clear();
+    probs_.clear();
+    loop_detection_->run();
+    // 同一函数中内层循环先于外层循环被发现
+    for (auto &loop : loop_detection_->get_loops()) {
+        headers_[loop->get_header()] = loop;
+        for (auto bb : loop->get_blocks())
+            innermost_.insert({bb, loop});
+    }
+    for (auto &f : m_->get_functions()) {
+        if (f.is_declaration())
+            continue;
+        compute_cold(&f);
+        for (auto &bb : f.get_basic_blocks())
+            compute_probs(&bb);
+    }
+}
+
+double BranchProbability::get_edge_prob(BasicBlock *from, BasicBlock *to) {
+    auto it = probs_.find({from, to});
+    return it == probs_.end() ? 0 : it->second;
+}
+
+bool BranchProbability::is_back_edge(BasicBlock *from, BasicBlock *to) {
+    auto loop = get_loop_of_header(to);
+    return loop and loop->contains(from);
+}
+
+std::shared_ptr<Loop> BranchProbability::get_loop_of_header(BasicBlock *bb) {
+    auto it = headers_.find(bb);
+    return it == headers_.end() ? nullptr : it->second;
+}
+
+std::shared_ptr<Loop> BranchProbability::get_innermost_loop(BasicBlock *bb) {
+    auto it = innermost_.find(bb);
+    return it == innermost_.end() ? nullptr : it->second;
+}
+
+/**
+ * @brief 求冷块：调用不返回的函数，或所有后继都是冷块
+ */
+void BranchProbability::compute_cold(Function *f) {
+    for (auto &bb : f->get_basic_blocks())
+        if (calls_noreturn(&bb))
+            cold_.insert(&bb);
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (auto &bb : f->get_basic_blocks()) {
+            auto &succs = bb.get_succ_basic_blocks();
+            if (cold_.count(&bb) or succs.empty())
+                continue;
+            if (std::all_of(succs.begin(), succs.end(),
+                            [&](BasicBlock *succ) { return is_cold(succ); })) {
+                cold_.insert(&bb);
+                changed = true;
+            }
+        }
+    }
+}
+
+void BranchProbability::compute_probs(BasicBlock *bb) {
+    auto &succs = bb->get_succ_basic_blocks();
+    if (succs.empty())
+        return;
+    if (succs.size() == 1 or succs.front() == succs.back()) {
+        probs_[{bb, succs.front()}] = 1;
+        return;
+    }
+    auto br = static_cast<BranchInst *>(bb->get_terminator());
+    auto first = static_cast<BasicBlock *>(br->get_operand(1));
+    auto second = static_cast<BasicBlock *>(br->get_operand(2));
+    // 第一条出边的概率
+    double prob = 0.5;
+    auto loop = get_innermost_loop(bb);
+    auto [true_weight, false_weight] = br->get_branch_weights();
+    if (br->has_branch_weights() and true_weight + false_weight > 0) {
+        // profile 中从未走过的边仍保留极小的概率
+        prob = static_cast<double>(true_weight) / (true_weight + false_weight);
+        prob = std::clamp(prob, COLD_PROB, 1 - COLD_PROB);
+    } else if (is_cold(first) != is_cold(second)) {
+        prob = is_cold(first) ? COLD_PROB : 1 - COLD_PROB;
+    } else if (is_back_edge(bb, first) != is_back_edge(bb, second)) {
+        prob = is_back_edge(bb, first) ? LOOP_TAKEN_PROB : 1 - LOOP_TAKEN_PROB;
+    } else if (loop and loop->contains(first) != loop->contains(second)) {
+        prob = loop->contains(first) ? LOOP_TAKEN_PROB : 1 - LOOP_TAKEN_PROB;
+    }
+    probs_[{bb, first}] = prob;
+    probs_[{bb, second}] = 1 - prob;
+}
@@ -0,0 +1,145 @@
+#include "CFGUtil.hpp"
+#include "Function.hpp"
+
+#include <algorithm>
+#include <unordered_set>
+
+void replace_successor(BasicBlock *pred, BasicBlock *old_succ,
+                       BasicBlock *new_succ) {
+    auto term = pred->get_terminator();
+    // 条件跳转的两个目标可能相同，前驱/后继列表中相应地有两项
+    pred->remove_succ_basic_block(old_succ);
+    old_succ->remove_pre_basic_block(pred);
+    for (unsigned i = 0; i < term->get_num_operand(); ++i) {
+        if (term->get_operand(i) != old_succ)
+            continue;
+        term->set_operand(i, new_succ);
+        pred->add_succ_basic_block(new_succ);
+        new_succ->add_pre_basic_block(pred);
+    }
+}
+
+BasicBlock *split_predecessors(BasicBlock *bb,
+                               const std::vector<BasicBlock *> &preds) {
+    auto f = bb->get_parent();
+    auto new_bb = BasicBlock::create(bb->get_module(), "", f);
+    f->get_basic_blocks().remove(new_bb);
+    f->get_basic_blocks().insert(bb->getIterator(), new_bb);
+
+    for (auto pred : preds)
+        replace_successor(pred, bb, new_bb);
+
+    auto from_preds = [&](BasicBlock *b) {
+        return std::find(preds.begin(), preds.end(), b) != preds.end();
+    };
+    for (auto &inst : bb->get_instructions()) {
+        if (not inst.is_phi())
+            break;
+        auto phi = static_cast<PhiInst *>(&inst);
+        std::vector<Value *> vals;
+        std::vector<BasicBlock *> bbs;
+        for (auto [val, in_bb] : phi->get_phi_pairs()) {
+            if (not from_preds(in_bb))
+                continue;
+            vals.push_back(val);
+            bbs.push_back(in_bb);
+        }
+        if (vals.empty())
+            continue;
+        for (auto in_bb : bbs)
+            phi->remove_phi_operand(in_bb);
+        if (std::all_of(vals.begin(), vals.end(),
+                        [&](Value *v) { return v == vals[0]; })) {
+            phi->add_phi_pair_operand(vals[0], new_bb);
+        } else {
+            auto new_phi = PhiInst::create_phi(phi->get_type(), new_bb, vals, bbs);
+            new_bb->add_instr_begin(new_phi);
+            phi->add_phi_pair_operand(new_phi, new_bb);
+        }
+    }
+    BranchInst::create_br(bb, new_bb);
+    return new_bb;
+}
+
+BasicBlock *merge_into_predecessor(BasicBlock *bb) {
+    auto pred = bb->get_pre_basic_blocks().front();
+    pred->erase_instr(pred->get_terminator());
+
+    auto &insts = bb->get_instructions();
+    for (auto it = insts.begin(); it != insts.end();) {
+        auto inst = &*it++;
+        bb->remove_instr(inst);
+        if (inst->is_phi()) {
+            inst->replace_all_use_with(inst->get_operand(0));
+            delete inst;
+            continue;
+        }
+        inst->set_parent(pred);
+        pred->add_instruction(inst);
+    }
+    for (auto succ : bb->get_succ_basic_blocks()) {
+        pred->add_succ_basic_block(succ);
+        auto &preds = succ->get_pre_basic_blocks();
+        std::replace(preds.begin(), preds.end(), bb, pred);
+        for (auto &inst : succ->get_instructions()) {
+            if (not inst.is_phi())
+                break;
+            for (unsigned i = 1; i < inst.get_num_operand(); i += 2)
+                if (inst.get_operand(i) == bb)
+                    inst.set_operand(i, pred);
+        }
+    }
+    bb->get_succ_basic_blocks().clear();
+    bb->erase_from_parent();
+    delete bb;
+    return pred;
+}
+
+std::vector<BasicBlock *> reverse_post_order(Function *f) {
+    std::vector<BasicBlock *> order;
+    std::unordered_set<BasicBlock *> visited;
+    // 显式栈上保存块与下一个要访问的后继
+    std::vector<std::pair<BasicBlock *, std::list<BasicBlock *>::iterator>>
+        stack;
+    auto entry = f->get_entry_block();
+    visited.insert(entry);
+    stack.emplace_back(entry, entry->get_succ_basic_blocks().begin());
+    while (not stack.empty()) {
+        auto &[bb, it] = stack.back();
+        if (it == bb->get_succ_basic_blocks().end()) {
+            order.push_back(bb);
+            stack.pop_back();
+            continue;
+        }
+        auto succ = *it++;
+        if (visited.insert(succ).second)
+            stack.emplace_back(succ, succ->get_succ_basic_blocks().begin());
+    }
+    std::reverse(order.begin(), order.end());
+    return order;
+}
+
+bool remove_unreachable_blocks(Function *f) {
+    auto order = reverse_post_order(f);
+    std::unordered_set<BasicBlock *> reachable(order.begin(), order.end());
+    std::vector<BasicBlock *> to_erase;
+    for (auto &bb : f->get_basic_blocks())
+        if (reachable.count(&bb) == 0)
+            to_erase.push_back(&bb);
+    // 先删去所有 phi 入边再删除块：不可达的环中的值可能出现在
+    // 可达块的 phi 中，值被删除后 phi 的操作数会变为空指针
+    for (auto bb : to_erase) {
+        for (auto succ : bb->get_succ_basic_blocks()) {
+            for (auto &inst : succ->get_instructions()) {
+                if (not inst.is_phi())
+                    break;
+                static_cast<PhiInst *>(&inst)->remove_phi_operand(bb);
+            }
+        }
+    }
+    for (auto bb : to_erase) {
+        bb->erase_from_parent();
+        delete bb;
+    }
+    return not to_erase.empty();
+}
@@ -0,0 +1,215 @@
+#include "CallGraph.hpp"
+#include "AliasAnalysis.hpp"
+#include "Function.hpp"
+#include "logging.hpp"
+
+#include <algorithm>
+#include <functional>
+
+bool FunctionSummary::merge(const FunctionSummary &other) {
+    auto size = [](const FunctionSummary &s) {
+        return s.globals_read.size() + s.globals_written.size() +
+               s.args_read.size() + s.args_written.size() + s.reads_unknown +
+               s.writes_unknown + s.may_exit;
+    };
+    auto old_size = size(*this);
+    globals_read.insert(other.globals_read.begin(), other.globals_read.end());
+    globals_written.insert(other.globals_written.begin(),
+                           other.globals_written.end());
+    args_read.insert(other.args_read.begin(), other.args_read.end());
+    args_written.insert(other.args_written.begin(), other.args_written.end());
+    reads_unknown |= other.reads_unknown;
+    writes_unknown |= other.writes_unknown;
+    may_exit |= other.may_exit;
+    return size(*this) != old_size;
+}
+
+void CallGraph::run() {
+    callees_.clear();
+    callers_.clear();
+    call_sites_.clear();
+    sccs_.clear();
+    scc_id_.clear();
+    summary_.clear();
+
+    build_graph();
+    compute_sccs();
+    compute_summaries();
+}
+
+void CallGraph::build_graph() {
+    for (auto &f1 : m_->get_functions()) {
+        auto f = &f1;
+        callees_[f] = {};
+        callers_[f] = {};
+        call_sites_[f] = {};
+    }
+    for (auto &f1 : m_->get_functions()) {
+        auto f = &f1;
+        for (auto &bb : f->get_basic_blocks()) {
+            for (auto &inst : bb.get_instructions()) {
+                if (not inst.is_call())
+                    continue;
+                auto callee = static_cast<Function *>(inst.get_operand(0));
+                callees_[f].insert(callee);
+                callers_[callee].insert(f);
+                call_sites_[callee].push_back(static_cast<CallInst *>(&inst));
+            }
+        }
+    }
+}
+
+/**
+ * @brief Tarjan 算法求强连通分量
+ *
+ * Tarjan 算法弹出强连通分量的顺序恰好是调用图缩点后的逆拓扑序，
+ * 即被调用者所在的分量先于调用者，可直接用于自底向上的分析。
+ */
+void CallGraph::compute_sccs() {
+    std::unordered_map<Function *, unsigned> index, low;
+    std::set<Function *> on_stack;
+    std::vector<Function *> stack;
+    unsigned counter = 0;
+
+    std::function<void(Function *)> connect = [&](Function *f) {
+        index[f] = low[f] = counter++;
+        stack.push_back(f);
+        on_stack.insert(f);
+        for (auto callee : callees_.at(f)) {
+            if (index.find(callee) == index.end()) {
+                connect(callee);
+                low[f] = std::min(low[f], low[callee]);
+            } else if (on_stack.count(callee)) {
+                low[f] = std::min(low[f], index[callee]);
+            }
+        }
+        if (low[f] != index[f])
+            return;
+        std::vector<Function *> scc;
+        Function *member;
+        do {
+            member = stack.back();
+            stack.pop_back();
+            on_stack.erase(member);
+            scc_id_[member] = sccs_.size();
+            scc.push_back(member);
+        } while (member != f);
+        sccs_.push_back(std::move(scc));
+    };
+
+    for (auto &f : m_->get_functions())
+        if (index.find(&f) == index.end())
+            connect(&f);
+}
+
+void CallGraph::compute_summaries() {
+    for (auto &scc : sccs_) {
+        for (auto f : scc) {
+            auto &sum = summary_[f];
+            local_summary(f, sum);
+            sum.may_recurse =
+                scc.size() > 1 or callees_.at(f).count(f) != 0;
+        }
+        // 分量内的函数互相调用，迭代直到摘要不再变化
+        bool changed = true;
+        while (changed) {
+            changed = false;
+            for (auto f : scc) {
+                FunctionSummary callee_effects;
+                for (auto &bb : f->get_basic_blocks())
+                    for (auto &inst : bb.get_instructions())
+                        if (inst.is_call())
+                            apply_call(static_cast<CallInst *>(&inst),
+                                       callee_effects);
+                changed |= summary_[f].merge(callee_effects);
+            }
+        }
+    }
+}
+
+void CallGraph::local_summary(Function *f, FunctionSummary &sum) {
+    // neg_idx_except 不访问内存，只会终止程序；
+    // 其余外部函数（运行时库的 IO）的行为未知
+    if (f->is_neg_idx_except()) {
+        sum.may_exit = true;
+        return;
+    }
+    if (f->is_declaration()) {
+        sum.reads_unknown = true;
+        sum.writes_unknown = true;
+        return;
+    }
+    for (auto &bb : f->get_basic_blocks()) {
+        for (auto &inst : bb.get_instructions()) {
+            if (inst.is_load())
+                add_access(static_cast<LoadInst *>(&inst)->get_lval(), false,
+                           sum);
+            else if (inst.is_store())
+                add_access(static_cast<StoreInst *>(&inst)->get_lval(), true,
+                           sum);
+        }
+    }
+}
+
+// 把被调用者对参数、全局变量的访问翻译为调用者的访问
+void CallGraph::apply_call(CallInst *call, FunctionSummary &sum) {
+    auto callee = static_cast<Function *>(call->get_operand(0));
+    auto found = summary_.find(callee);
+    if (found == summary_.end())
+        return;
+    auto &callee_sum = found->second;
+    sum.globals_read.insert(callee_sum.globals_read.begin(),
+                            callee_sum.globals_read.end());
+    sum.globals_written.insert(callee_sum.globals_written.begin(),
+                               callee_sum.globals_written.end());
+    sum.reads_unknown |= callee_sum.reads_unknown;
+    sum.writes_unknown |= callee_sum.writes_unknown;
+    sum.may_exit |= callee_sum.may_exit;
+    for (auto arg_no : callee_sum.args_read)
+        add_access(call->get_operand(arg_no + 1), false, sum);
+    for (auto arg_no : callee_sum.args_written)
+        add_access(call->get_operand(arg_no + 1), true, sum);
+}
+
+void CallGraph::add_access(Value *ptr, bool is_write, FunctionSummary &sum) {
+    auto obj = AliasAnalysis::get_underlying_object(ptr);
+    if (auto inst = dynamic_cast<Instruction *>(obj); inst and inst->is_alloca())
+        return;
+    if (auto global = dynamic_cast<GlobalVariable *>(obj)) {
+        (is_write ? sum.globals_written : sum.globals_read).insert(global);
+    } else if (auto arg = dynamic_cast<Argument *>(obj)) {
+        (is_write ? sum.args_written : sum.args_read).insert(arg->get_arg_no());
+    } else {
+        (is_write ? sum.writes_unknown : sum.reads_unknown) = true;
+    }
+}
+
+void CallGraph::print() {
+    for (auto &scc : sccs_) {
+        for (auto f : scc) {
+            auto &sum = summary_.at(f);
+            std::string output = f->get_name() + ":";
+            if (sum.is_readnone())
+                output += " readnone";
+            else if (sum.is_readonly())
+                output += " readonly";
+            if (sum.may_exit)
+                output += " may_exit";
+            if (sum.may_recurse)
+                output += " recursive";
+            for (auto g : sum.globals_read)
+                output += " r:@" + g->get_name();
+            for (auto g : sum.globals_written)
+                output += " w:@" + g->get_name();
+            for (auto i : sum.args_read)
+                output += " r:arg" + std::to_string(i);
+            for (auto i : sum.args_written)
+                output += " w:arg" + std::to_string(i);
+            if (sum.reads_unknown)
+                output += " r:?";
+            if (sum.writes_unknown)
+                output += " w:?";
+            LOG_INFO << output;
+        }
+    }
+}
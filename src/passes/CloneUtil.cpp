@@ -0,0 +1,176 @@
+#include "CloneUtil.hpp"
+#include "Module.hpp"
+
+#include <cassert>
+
+Instruction *clone_instruction(Instruction *inst, BasicBlock *bb,
+                               const ValueMap &vmap) {
+    auto op = [&](unsigned i) { return map_value(vmap, inst->get_operand(i)); };
+    switch (inst->get_instr_type()) {
+    case Instruction::add:
+        return IBinaryInst::create_add(op(0), op(1), bb);
+    case Instruction::sub:
+        return IBinaryInst::create_sub(op(0), op(1), bb);
+    case Instruction::mul:
+        return IBinaryInst::create_mul(op(0), op(1), bb);
+    case Instruction::sdiv:
+        return IBinaryInst::create_sdiv(op(0), op(1), bb);
+    case Instruction::srem:
+        return IBinaryInst::create_srem(op(0), op(1), bb);
+    case Instruction::shl:
+        return IBinaryInst::create_shl(op(0), op(1), bb);
+    case Instruction::ashr:
+        return IBinaryInst::create_ashr(op(0), op(1), bb);
+    case Instruction::lshr:
+        return IBinaryInst::create_lshr(op(0), op(1), bb);
+    case Instruction::and_:
+        return IBinaryInst::create_and(op(0), op(1), bb);
+    case Instruction::or_:
+        return IBinaryInst::create_or(op(0), op(1), bb);
+    case Instruction::xor_:
+        return IBinaryInst::create_xor(op(0), op(1), bb);
+    case Instruction::fadd:
+        return FBinaryInst::create_fadd(op(0), op(1), bb);
+    case Instruction::fsub:
+        return FBinaryInst::create_fsub(op(0), op(1), bb);
+    case Instruction::fmul:
+        return FBinaryInst::create_fmul(op(0), op(1), bb);
+    case Instruction::fdiv:
+        return FBinaryInst::create_fdiv(op(0), op(1), bb);
+    case Instruction::ge:
+        return ICmpInst::create_ge(op(0), op(1), bb);
+    case Instruction::gt:
+        return ICmpInst::create_gt(op(0), op(1), bb);
+    case Instruction::le:
+        return ICmpInst::create_le(op(0), op(1), bb);
+    case Instruction::lt:
+        return ICmpInst::create_lt(op(0), op(1), bb);
+    case Instruction::eq:
+        return ICmpInst::create_eq(op(0), op(1), bb);
+    case Instruction::ne:
+        return ICmpInst::create_ne(op(0), op(1), bb);
+    case Instruction::fge:
+        return FCmpInst::create_fge(op(0), op(1), bb);
+    case Instruction::fgt:
+        return FCmpInst::create_fgt(op(0), op(1), bb);
+    case Instruction::fle:
+        return FCmpInst::create_fle(op(0), op(1), bb);
+    case Instruction::flt:
+        return FCmpInst::create_flt(op(0), op(1), bb);
+    case Instruction::feq:
+        return FCmpInst::create_feq(op(0), op(1), bb);
+    case Instruction::fne:
+        return FCmpInst::create_fne(op(0), op(1), bb);
+    case Instruction::alloca:
+        return AllocaInst::create_alloca(
+            static_cast<AllocaInst *>(inst)->get_alloca_type(), bb);
+    case Instruction::load:
+        return LoadInst::create_load(op(0), bb);
+    case Instruction::store:
+        return StoreInst::create_store(op(0), op(1), bb);
+    case Instruction::call: {
+        std::vector<Value *> args;
+        for (unsigned i = 1; i < inst->get_num_operand(); ++i)
+            args.push_back(op(i));
+        auto call = CallInst::create_call(static_cast<Function *>(op(0)),
+                                          args, bb);
+        auto orig = static_cast<CallInst *>(inst);
+        if (orig->has_profile_count())
+            call->set_profile_count(orig->get_profile_count());
+        return call;
+    }
+    case Instruction::getelementptr: {
+        std::vector<Value *> idxs;
+        for (unsigned i = 1; i < inst->get_num_operand(); ++i)
+            idxs.push_back(op(i));
+        return GetElementPtrInst::create_gep(op(0), idxs, bb);
+    }
+    case Instruction::zext:
+        return ZextInst::create_zext(op(0), inst->get_type(), bb);
+    case Instruction::fptosi:
+        return FpToSiInst::create_fptosi(op(0), inst->get_type(), bb);
+    case Instruction::sitofp:
+        return SiToFpInst::create_sitofp(op(0), bb);
+    default:
+        assert(false && "clone_instruction: unsupported instruction");
+        return nullptr;
+    }
+}
+
+/**
+ * @brief 分三遍复制
+ *
+ * 1. 按顺序复制普通指令，phi 先建立空的副本；
+ *    此时后定义的值还没有副本，操作数可能仍指向原值
+ * 2. 重新映射普通指令的操作数
+ * 3. 补全 phi 的入边，创建终结指令（其构造函数会维护前驱后继关系）
+ */
+std::vector<BasicBlock *> clone_blocks(const std::vector<BasicBlock *> &blocks,
+                                       Function *f, ValueMap &vmap) {
+    auto m = f->get_parent();
+    std::vector<BasicBlock *> clones;
+    for (auto bb : blocks) {
+        auto clone = BasicBlock::create(m, "", f);
+        vmap[bb] = clone;
+        clones.push_back(clone);
+    }
+
+    std::vector<Instruction *> cloned;
+    for (unsigned i = 0; i < blocks.size(); ++i) {
+        for (auto &inst : blocks[i]->get_instructions()) {
+            if (inst.isTerminator())
+                continue;
+            Instruction *clone;
+            if (inst.is_phi()) {
+                clone = PhiInst::create_phi(inst.get_type(), clones[i]);
+                clones[i]->add_instruction(clone);
+            } else {
+                clone = clone_instruction(&inst, clones[i], vmap);
+                cloned.push_back(clone);
+            }
+            vmap[&inst] = clone;
+        }
+    }
+
+    for (auto inst : cloned)
+        for (unsigned i = 0; i < inst->get_num_operand(); ++i)
+            inst->set_operand(i, map_value(vmap, inst->get_operand(i)));
+
+    for (unsigned i = 0; i < blocks.size(); ++i) {
+        auto clone_bb = clones[i];
+        for (auto &inst : blocks[i]->get_instructions()) {
+            if (inst.is_phi()) {
+                auto phi = static_cast<PhiInst *>(vmap.at(&inst));
+                for (auto [val, pred] : static_cast<PhiInst *>(&inst)
+                                            ->get_phi_pairs())
+                    phi->add_phi_pair_operand(
+                        map_value(vmap, val),
+                        static_cast<BasicBlock *>(map_value(vmap, pred)));
+            } else if (inst.is_br()) {
+                auto br = static_cast<BranchInst *>(&inst);
+                auto target = [&](unsigned i) {
+                    return static_cast<BasicBlock *>(
+                        map_value(vmap, br->get_operand(i)));
+                };
+                if (br->is_cond_br()) {
+                    auto clone = BranchInst::create_cond_br(
+                        map_value(vmap, br->get_condition()), target(1),
+                        target(2), clone_bb);
+                    if (br->has_branch_weights()) {
+                        auto [t, f] = br->get_branch_weights();
+                        clone->set_branch_weights(t, f);
+                    }
+                } else
+                    BranchInst::create_br(target(0), clone_bb);
+            } else if (inst.is_ret() and blocks[i]->get_parent() == f) {
+                auto ret = static_cast<ReturnInst *>(&inst);
+                if (ret->is_void_ret())
+                    ReturnInst::create_void_ret(clone_bb);
+                else
+                    ReturnInst::create_ret(map_value(vmap, ret->get_operand(0)),
+                                           clone_bb);
+            }
+        }
+    }
+    return clones;
+}
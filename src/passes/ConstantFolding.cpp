@@ -0,0 +1,141 @@
+#include "ConstantFolding.hpp"
+#include "Module.hpp"
+
+#include <climits>
+#include <cmath>
+
+namespace {
+
+Constant *fold_int(Instruction::OpID op, int lhs, int rhs, Module *m) {
+    // 先转为无符号数计算，使溢出按补码回绕
+    auto l = static_cast<unsigned>(lhs), r = static_cast<unsigned>(rhs);
+    switch (op) {
+    case Instruction::add:
+        return ConstantInt::get(static_cast<int>(l + r), m);
+    case Instruction::sub:
+        return ConstantInt::get(static_cast<int>(l - r), m);
+    case Instruction::mul:
+        return ConstantInt::get(static_cast<int>(l * r), m);
+    case Instruction::sdiv:
+        if (rhs == 0 or (lhs == INT_MIN and rhs == -1))
+            return nullptr;
+        return ConstantInt::get(lhs / rhs, m);
+    case Instruction::srem:
+        if (rhs == 0 or (lhs == INT_MIN and rhs == -1))
+            return nullptr;
+        return ConstantInt::get(lhs % rhs, m);
+    // 移位量不在 [0, 32) 内时结果未定义
+    case Instruction::shl:
+        if (rhs < 0 or rhs >= 32)
+            return nullptr;
+        return ConstantInt::get(static_cast<int>(l << r), m);
+    case Instruction::ashr:
+        if (rhs < 0 or rhs >= 32)
+            return nullptr;
+        return ConstantInt::get(lhs >> rhs, m);
+    case Instruction::lshr:
+        if (rhs < 0 or rhs >= 32)
+            return nullptr;
+        return ConstantInt::get(static_cast<int>(l >> r), m);
+    case Instruction::and_:
+        return ConstantInt::get(lhs & rhs, m);
+    case Instruction::or_:
+        return ConstantInt::get(lhs | rhs, m);
+    case Instruction::xor_:
+        return ConstantInt::get(lhs ^ rhs, m);
+    case Instruction::ge:
+        return ConstantInt::get(lhs >= rhs, m);
+    case Instruction::gt:
+        return ConstantInt::get(lhs > rhs, m);
+    case Instruction::le:
+        return ConstantInt::get(lhs <= rhs, m);
+    case Instruction::lt:
+        return ConstantInt::get(lhs < rhs, m);
+    case Instruction::eq:
+        return ConstantInt::get(lhs == rhs, m);
+    case Instruction::ne:
+        return ConstantInt::get(lhs != rhs, m);
+    default:
+        return nullptr;
+    }
+}
+
+Constant *fold_float(Instruction::OpID op, float lhs, float rhs, Module *m) {
+    switch (op) {
+    case Instruction::fadd:
+        return ConstantFP::get(lhs + rhs, m);
+    case Instruction::fsub:
+        return ConstantFP::get(lhs - rhs, m);
+    case Instruction::fmul:
+        return ConstantFP::get(lhs * rhs, m);
+    case Instruction::fdiv:
+        return ConstantFP::get(lhs / rhs, m);
+    case Instruction::fge:
+        return ConstantInt::get(lhs >= rhs, m);
+    case Instruction::fgt:
+        return ConstantInt::get(lhs > rhs, m);
+    case Instruction::fle:
+        return ConstantInt::get(lhs <= rhs, m);
+    case Instruction::flt:
+        return ConstantInt::get(lhs < rhs, m);
+    case Instruction::feq:
+        return ConstantInt::get(lhs == rhs, m);
+    case Instruction::fne:
+        return ConstantInt::get(lhs != rhs, m);
+    default:
+        return nullptr;
+    }
+}
+
+} // namespace
+
+Constant *constant_fold(Instruction *inst, const std::vector<Constant *> &ops) {
+    auto m = inst->get_module();
+    auto op = inst->get_instr_type();
+
+    if (inst->isBinary() or inst->is_cmp() or inst->is_fcmp()) {
+        auto li = dynamic_cast<ConstantInt *>(ops[0]);
+        auto ri = dynamic_cast<ConstantInt *>(ops[1]);
+        if (li and ri)
+            return fold_int(op, li->get_value(), ri->get_value(), m);
+        auto lf = dynamic_cast<ConstantFP *>(ops[0]);
+        auto rf = dynamic_cast<ConstantFP *>(ops[1]);
+        if (lf and rf)
+            return fold_float(op, lf->get_value(), rf->get_value(), m);
+        return nullptr;
+    }
+    if (inst->is_zext()) {
+        if (auto c = dynamic_cast<ConstantInt *>(ops[0]))
+            return ConstantInt::get(c->get_value() != 0 ? 1 : 0, m);
+        return nullptr;
+    }
+    if (inst->is_si2fp()) {
+        if (auto c = dynamic_cast<ConstantInt *>(ops[0]))
+            return ConstantFP::get(static_cast<float>(c->get_value()), m);
+        return nullptr;
+    }
+    if (inst->is_fp2si()) {
+        auto c = dynamic_cast<ConstantFP *>(ops[0]);
+        if (c == nullptr or std::isnan(c->get_value()))
+            return nullptr;
+        // 超出范围的转换结果未定义，不折叠
+        auto val = std::trunc(c->get_value());
+        if (val < -2147483648.0f or val >= 2147483648.0f)
+            return nullptr;
+        return ConstantInt::get(static_cast<int>(val), m);
+    }
+    return nullptr;
+}
+
+Constant *constant_fold(Instruction *inst) {
+    std::vector<Constant *> ops;
+    for (auto op : inst->get_operands()) {
+        auto c = dynamic_cast<Constant *>(op);
+        if (c == nullptr)
+            return nullptr;
+        ops.push_back(c);
+    }
+    if (ops.empty())
+        return nullptr;
+    return constant_fold(inst, ops);
+}
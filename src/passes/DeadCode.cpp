@@ -1,5 +1,7 @@
 #include "DeadCode.hpp"
+#include "CFGUtil.hpp"
 #include "logging.hpp"
+#include <unordered_set>
 #include <vector>
 
 // 处理流程：两趟处理，mark 标记有用变量，sweep 删除无用指令
@@ -10,34 +12,22 @@ void DeadCode::run() {
         changed = false;
         for (auto &F : m_->get_functions()) {
             auto func = &F;
-            changed |= clear_basic_blocks(func);
+            if (func->is_declaration())
+                continue;
+            changed |= remove_unreachable_blocks(func);
             mark(func);
+            changed |= sweep_branches(func);
             changed |= sweep(func);
         }
     } while (changed);
     LOG_INFO << "dead code pass erased " << ins_count << " instructions";
 }
 
-bool DeadCode::clear_basic_blocks(Function *func) {
-    bool changed = 0;
-    std::vector<BasicBlock *> to_erase;
-    for (auto &bb1 : func->get_basic_blocks()) {
-        auto bb = &bb1;
-        if(bb->get_pre_basic_blocks().empty() && bb != func->get_entry_block()) {
-            to_erase.push_back(bb);
-            changed = 1;
-        }
-    }
-    for (auto &bb : to_erase) {
-        bb->erase_from_parent();
-        delete bb;
-    }
-    return changed;
-}
-
 void DeadCode::mark(Function *func) {
     work_list.clear();
     marked.clear();
+    dominators->run_on_func(func);
+    post_dominators->run_on_func(func);
 
     for (auto &bb : func->get_basic_blocks()) {
         for (auto &ins : bb.get_instructions()) {
@@ -68,6 +58,76 @@ void DeadCode::mark(Instruction *ins) {
         marked[def] = true;
         work_list.push_back(def);
     }
+    // 有用指令所控制依赖的跳转也是有用的
+    for (auto dep : post_dominators->get_control_dependence(ins->get_parent()))
+        mark_terminator(dep);
+    // phi 需要保留每条入边
+    if (ins->is_phi()) {
+        for (auto [val, pre_bb] : static_cast<PhiInst *>(ins)->get_phi_pairs())
+            mark_terminator(pre_bb);
+    }
+}
+
+void DeadCode::mark_terminator(BasicBlock *bb) {
+    if (not bb->is_terminated())
+        return;
+    auto term = bb->get_terminator();
+    if (marked[term])
+        return;
+    marked[term] = true;
+    work_list.push_back(term);
+}
+
+// 将无用的条件跳转改写为跳向最近的有用后向支配块
+bool DeadCode::sweep_branches(Function *func) {
+    std::unordered_set<BasicBlock *> live_blocks;
+    for (auto &bb : func->get_basic_blocks())
+        for (auto &ins : bb.get_instructions())
+            if (marked[&ins]) {
+                live_blocks.insert(&bb);
+                break;
+            }
+
+    bool changed = false;
+    for (auto &bb1 : func->get_basic_blocks()) {
+        auto bb = &bb1;
+        if (not bb->is_terminated())
+            continue;
+        auto br = dynamic_cast<BranchInst *>(bb->get_terminator());
+        if (br == nullptr or not br->is_cond_br() or marked[br])
+            continue;
+        auto target = post_dominators->get_ipdom(bb);
+        while (target != nullptr and
+               live_blocks.find(target) == live_blocks.end())
+            target = post_dominators->get_ipdom(target);
+        if (target == nullptr)
+            continue;
+        // 保守起见：目标块中有用的 phi 需要来自 bb 的入边，不做改写
+        bool has_live_phi = false;
+        for (auto &ins : target->get_instructions()) {
+            if (not ins.is_phi())
+                break;
+            has_live_phi |= marked[&ins];
+        }
+        if (has_live_phi)
+            continue;
+
+        std::vector<BasicBlock *> old_succs(bb->get_succ_basic_blocks().begin(),
+                                            bb->get_succ_basic_blocks().end());
+        bb->erase_instr(br);
+        BranchInst::create_br(target, bb);
+        for (auto succ : old_succs) {
+            if (succ == target)
+                continue;
+            for (auto &ins : succ->get_instructions()) {
+                if (not ins.is_phi())
+                    break;
+                static_cast<PhiInst *>(&ins)->remove_phi_operand(bb);
+            }
+        }
+        changed = true;
+    }
+    return changed;
 }
 
 bool DeadCode::sweep(Function *func) {
@@ -75,7 +135,8 @@ bool DeadCode::sweep(Function *func) {
     for (auto &bb : func->get_basic_blocks()) {
         for (auto it = bb.get_instructions().begin();
              it != bb.get_instructions().end();) {
-            if (marked[&*it]) {
+            // 终结指令由 sweep_branches 处理
+            if (marked[&*it] or it->isTerminator()) {
                 ++it;
                 continue;
             } else {
@@ -94,16 +155,33 @@ bool DeadCode::sweep(Function *func) {
 }
 
 bool DeadCode::is_critical(Instruction *ins) {
-    // 对纯函数的无用调用也可以在删除之列
+    // 对只读函数的无用调用也可以在删除之列，可能终止程序的除外
     if (ins->is_call()) {
         auto call_inst = dynamic_cast<CallInst *>(ins);
         auto callee = dynamic_cast<Function *>(call_inst->get_operand(0));
-        if (func_info->is_pure_function(callee))
+        if (not callee->is_declaration() and
+            func_info->is_readonly_function(callee) and
+            not func_info->may_exit(callee))
             return false;
         return true;
     }
-    if (ins->is_br() || ins->is_ret())
+    if (ins->is_ret())
         return true;
+    if (ins->is_br()) {
+        auto bb = ins->get_parent();
+        // 可能陷入死循环的块：保守地保留跳转
+        if (not post_dominators->is_reachable_to_exit(bb))
+            return true;
+        for (auto succ : bb->get_succ_basic_blocks()) {
+            if (not post_dominators->is_reachable_to_exit(succ))
+                return true;
+            // 回边：不删除循环，循环删除需要证明其终止
+            if (dominators->is_reachable(bb) and
+                dominators->is_dominate(succ, bb))
+                return true;
+        }
+        return false;
+    }
     if (ins->is_store())
         return true;
     return false;
@@ -32,11 +32,16 @@ void Dominators::run() {
 void Dominators::run_on_func(Function *f) {
     dom_post_order_.clear();
     dom_dfs_order_.clear();
+    // 允许在 CFG 变化后对同一函数重新分析，需清掉上一次的遍历序
+    post_order_vec_.clear();
+    post_order_.clear();
     for(auto &bb1 : f->get_basic_blocks()) {
         auto bb = &bb1;
-        idom_.insert({bb, nullptr});
-        dom_frontier_.insert({bb, {}});
-        dom_tree_succ_blocks_.insert({bb, {}});
+        idom_[bb] = nullptr;
+        dom_frontier_[bb] = {};
+        dom_tree_succ_blocks_[bb] = {};
+        dom_tree_L_.erase(bb);
+        dom_tree_R_.erase(bb);
     }
     create_reverse_post_order(f);
     create_idom(f);
@@ -165,9 +170,12 @@ void Dominators::create_dominance_frontier(Function *f) {
     for (auto &bb1 : f->get_basic_blocks()) {
         auto b = &bb1;
         // 如果基本块 b 的前驱数量大于等于 2（即 b 是一个合流点）
-        if (b->get_pre_basic_blocks().size() >= 2) {
+        if (b->get_pre_basic_blocks().size() >= 2 && idom_[b] != nullptr) {
             // 遍历 b 的每个前驱 p
             for (auto p : b->get_pre_basic_blocks()) {
+                // 不可达的前驱不在支配树上
+                if (idom_[p] == nullptr)
+                    continue;
                 auto runner = p;
                 // 沿着支配树向上遍历
                 while (runner != idom_[b]) {
@@ -0,0 +1,154 @@
+#include "GVN.hpp"
+#include "Function.hpp"
+#include "logging.hpp"
+
+#include <algorithm>
+#include <unordered_set>
+
+void GVN::run() {
+    func_info_->run();
+    for (auto &f1 : m_->get_functions()) {
+        auto f = &f1;
+        if (f->is_declaration())
+            continue;
+        // 合并指令可能使 phi 变得平凡，反之亦然
+        while (run_on_func(f))
+            ;
+    }
+    LOG_INFO << "gvn erased " << erased_ << " instructions";
+}
+
+bool GVN::is_candidate(Instruction *inst) {
+    if (inst->isBinary() or inst->is_cmp() or inst->is_fcmp() or
+        inst->is_zext() or inst->is_fp2si() or inst->is_si2fp() or
+        inst->is_gep() or inst->is_phi())
+        return true;
+    if (inst->is_call() and not inst->is_void()) {
+        auto callee = static_cast<Function *>(inst->get_operand(0));
+        return not callee->is_declaration() and
+               func_info_->is_pure_function(callee);
+    }
+    return false;
+}
+
+GVN::Expression GVN::get_expression(Instruction *inst) {
+    Expression expr{inst->get_instr_type(), inst->get_operands()};
+    switch (inst->get_instr_type()) {
+    case Instruction::add:
+    case Instruction::mul:
+    case Instruction::and_:
+    case Instruction::or_:
+    case Instruction::xor_:
+    case Instruction::fadd:
+    case Instruction::fmul:
+    case Instruction::eq:
+    case Instruction::ne:
+    case Instruction::feq:
+    case Instruction::fne:
+        std::sort(expr.second.begin(), expr.second.end());
+        break;
+    case Instruction::phi:
+        expr.second.push_back(inst->get_parent());
+        break;
+    default:
+        break;
+    }
+    return expr;
+}
+
+namespace {
+// phi 对所在块的每个前驱都有入边
+bool has_all_incoming(PhiInst *phi) {
+    std::unordered_set<Value *> in_bbs;
+    for (auto [val, bb] : phi->get_phi_pairs())
+        in_bbs.insert(bb);
+    for (auto pred : phi->get_parent()->get_pre_basic_blocks())
+        if (in_bbs.count(pred) == 0)
+            return false;
+    return true;
+}
+} // namespace
+
+/**
+ * @brief 删除平凡的 phi
+ *
+ * phi 的所有入边值都是同一个值 v（或 phi 自身），且每个前驱都有入边时，
+ * phi 就等于 v。
+ * 替换后使用它的 phi 可能也变得平凡，因此迭代到不动点。
+ */
+bool GVN::remove_trivial_phis(Function *f) {
+    bool changed = false, again = true;
+    while (again) {
+        again = false;
+        for (auto &bb : f->get_basic_blocks()) {
+            for (auto it = bb.get_instructions().begin();
+                 it != bb.get_instructions().end() and it->is_phi();) {
+                auto phi = &*it++;
+                Value *same = nullptr;
+                bool trivial = true;
+                for (auto op : static_cast<PhiInst *>(phi)->get_phi_pairs()) {
+                    auto val = op.first;
+                    if (val == phi or val == same)
+                        continue;
+                    if (same != nullptr) {
+                        trivial = false;
+                        break;
+                    }
+                    same = val;
+                }
+                // 没有入边（不可达）的 phi 留给死代码删除
+                if (not trivial or same == nullptr)
+                    continue;
+                // 省略的入边上 phi 未定义，v 不一定支配 phi，不能替换
+                if (not has_all_incoming(static_cast<PhiInst *>(phi)))
+                    continue;
+                phi->replace_all_use_with(same);
+                bb.erase_instr(phi);
+                ++erased_;
+                again = changed = true;
+            }
+        }
+    }
+    return changed;
+}
+
+/**
+ * @brief 在支配树上做值编号
+ *
+ * get_dom_dfs_order 是支配树的先序，scopes 栈中保存当前块在支配树上的祖先
+ * 以及各自加入表中的表达式；遇到不被栈顶支配的块时逐层弹出。
+ */
+bool GVN::run_on_func(Function *f) {
+    bool changed = remove_trivial_phis(f);
+
+    dominators_->run_on_func(f);
+    table_.clear();
+    std::vector<std::pair<BasicBlock *, std::vector<Expression>>> scopes;
+    for (auto bb : dominators_->get_dom_dfs_order()) {
+        while (not scopes.empty() and
+               not dominators_->is_dominate(scopes.back().first, bb)) {
+            for (auto &expr : scopes.back().second)
+                table_.erase(expr);
+            scopes.pop_back();
+        }
+        scopes.push_back({bb, {}});
+
+        for (auto it = bb->get_instructions().begin();
+             it != bb->get_instructions().end();) {
+            auto inst = &*it++;
+            if (not is_candidate(inst))
+                continue;
+            auto expr = get_expression(inst);
+            auto [leader, inserted] = table_.emplace(expr, inst);
+            if (inserted) {
+                scopes.back().second.push_back(std::move(expr));
+                continue;
+            }
+            inst->replace_all_use_with(leader->second);
+            bb->erase_instr(inst);
+            ++erased_;
+            changed = true;
+        }
+    }
+    return changed;
+}
@@ -0,0 +1,84 @@
+#include "IndVarSimplify.hpp"
+#include "Function.hpp"
+#include "LoopSimplify.hpp"
+#include "logging.hpp"
+
+#include <vector>
+
+namespace {
+// 出口值的闭式最多包含的项数，避免在出口块中生成过多的指令
+constexpr size_t EXIT_VALUE_MAX_TERMS = 2;
+} // namespace
+
+void IndVarSimplify::run() {
+    LoopSimplify(m_).run();
+    scev_->run();
+    dom_func_ = nullptr;
+    for (auto &loop : scev_->get_loop_detection().get_loops())
+        rewrite_exit_values(loop);
+    LOG_INFO << "indvars replaced " << replaced_ << " exit values";
+}
+
+/**
+ * @brief 用闭式替换循环之后对循环中的值的使用
+ *
+ * 要求循环只有一个出口块（LoopSimplify 保证它的前驱只有 exiting 块），
+ * 于是循环之后的使用都被出口块支配，闭式插入在出口块的 phi 之后。
+ * 只替换所在块支配 exiting 块的值，它们在最后一次迭代中一定被计算过。
+ */
+void IndVarSimplify::rewrite_exit_values(std::shared_ptr<Loop> loop) {
+    ScalarEvolution::Expr count;
+    if (not scev_->get_backedge_taken_count(loop, count))
+        return;
+    auto exiting = scev_->get_exiting_block(loop);
+    auto &exits = loop->get_exit_blocks();
+    if (exits.size() != 1)
+        return;
+    auto exit = exits[0];
+
+    auto func = exiting->get_parent();
+    if (dom_func_ != func) {
+        dominators_->run_on_func(func);
+        dom_func_ = func;
+    }
+    Instruction *pos = nullptr;
+    for (auto &inst : exit->get_instructions())
+        if (not inst.is_phi()) {
+            pos = &inst;
+            break;
+        }
+
+    for (auto bb : loop->get_blocks()) {
+        if (not dominators_->is_dominate(bb, exiting))
+            continue;
+        for (auto &inst : bb->get_instructions()) {
+            if (not inst.get_type()->is_int32_type())
+                continue;
+            std::vector<std::pair<Instruction *, unsigned>> outside_uses;
+            for (auto &use : inst.get_use_list()) {
+                auto user = static_cast<Instruction *>(use.val_);
+                auto user_bb = user->get_parent();
+                if (loop->contains(user_bb) or
+                    (user->is_phi() and user_bb == exit))
+                    continue;
+                outside_uses.push_back({user, use.arg_no_});
+            }
+            if (outside_uses.empty())
+                continue;
+
+            ScalarEvolution::Expr expr, final_value;
+            if (not scev_->get_expr(&inst, loop, expr) or
+                not scev_->evaluate_at(expr, loop, count, final_value))
+                continue;
+            // 不含归纳变量的值是循环不变的，留给 LICM
+            if (final_value == expr or
+                final_value.terms.size() > EXIT_VALUE_MAX_TERMS)
+                continue;
+
+            auto val = scev_->expand(final_value, pos);
+            for (auto [user, arg_no] : outside_uses)
+                user->set_operand(arg_no, val);
+            ++replaced_;
+        }
+    }
+}
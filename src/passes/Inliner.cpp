@@ -0,0 +1,291 @@
+#include "Inliner.hpp"
+#include "Constant.hpp"
+#include "Function.hpp"
+#include "logging.hpp"
+
+#include <algorithm>
+
+void Inliner::run() {
+    call_graph_ = std::make_unique<CallGraph>(m_);
+    call_graph_->run();
+    loop_detection_ = std::make_unique<LoopDetection>(m_);
+    loop_detection_->run();
+    // 外层循环也包含内层循环的块，因此计数即为循环深度
+    for (auto &loop : loop_detection_->get_loops())
+        for (auto bb : loop->get_blocks())
+            ++loop_depth_[bb];
+
+    for (auto &f : m_->get_functions())
+        if (not f.is_declaration())
+            size_[&f] = estimate_size(&f);
+    for (auto &f : m_->get_functions())
+        for (auto &bb : f.get_basic_blocks())
+            for (auto &inst : bb.get_instructions())
+                if (inst.is_call())
+                    max_call_count_ = std::max(
+                        max_call_count_,
+                        static_cast<CallInst *>(&inst)->get_profile_count());
+    for (auto &scc : call_graph_->get_sccs())
+        for (auto f : scc)
+            if (not f->is_declaration())
+                run_on_func(f);
+
+    // 自顶向下删除不再被调用的函数，调用者先于被调用者被删除
+    auto &sccs = call_graph_->get_sccs();
+    for (auto scc = sccs.rbegin(); scc != sccs.rend(); ++scc)
+        for (auto f : *scc)
+            if (not f->is_declaration() and f->get_name() != "main" and
+                f->get_use_list().empty())
+                remove_function(f);
+    LOG_INFO << "inliner inlined " << inlined_ << " call sites";
+}
+
+/**
+ * @brief 删除函数
+ *
+ * 先删除终结指令以维护块间的前驱后继关系，
+ * 再断开其余指令的操作数，使析构时不再访问其他已删除的值。
+ */
+void Inliner::remove_function(Function *f) {
+    for (auto &bb : f->get_basic_blocks())
+        if (bb.is_terminated())
+            bb.erase_instr(bb.get_terminator());
+    for (auto &bb : f->get_basic_blocks())
+        for (auto &inst : bb.get_instructions())
+            inst.remove_all_operands();
+    m_->get_functions().erase(f);
+}
+
+/**
+ * @brief 估计函数在 mem2reg 之后的指令数
+ *
+ * 标量局部变量的 alloca 及对它的 load/store 会被 mem2reg 消除，不计入。
+ */
+int Inliner::estimate_size(Function *f) {
+    auto is_scalar_alloca = [](Value *ptr) {
+        auto alloca = dynamic_cast<AllocaInst *>(ptr);
+        return alloca and not alloca->get_alloca_type()->is_array_type();
+    };
+    int size = 0;
+    for (auto &bb : f->get_basic_blocks()) {
+        for (auto &inst : bb.get_instructions()) {
+            if (inst.is_alloca())
+                continue;
+            if (inst.is_load() and is_scalar_alloca(inst.get_operand(0)))
+                continue;
+            if (inst.is_store() and is_scalar_alloca(inst.get_operand(1)))
+                continue;
+            ++size;
+        }
+    }
+    return size;
+}
+
+// 只调用外部函数（IO 与运行时库）的函数
+bool Inliner::is_leaf(Function *f) {
+    for (auto &bb : f->get_basic_blocks())
+        for (auto &inst : bb.get_instructions())
+            if (inst.is_call() and
+                not static_cast<Function *>(inst.get_operand(0))
+                        ->is_declaration())
+                return false;
+    return true;
+}
+
+void Inliner::run_on_func(Function *f) {
+    std::vector<CallInst *> calls;
+    for (auto &bb : f->get_basic_blocks())
+        for (auto &inst : bb.get_instructions())
+            if (inst.is_call())
+                calls.push_back(static_cast<CallInst *>(&inst));
+
+    int caller_size = size_.at(f);
+    for (auto call : calls) {
+        if (not should_inline(call, caller_size))
+            continue;
+        caller_size += size_.at(static_cast<Function *>(call->get_operand(0)));
+        inline_call(call);
+        ++inlined_;
+    }
+    size_[f] = estimate_size(f);
+}
+
+bool Inliner::should_inline(CallInst *call, int caller_size) {
+    auto caller = call->get_function();
+    auto callee = static_cast<Function *>(call->get_operand(0));
+    if (callee->is_declaration() or callee == caller or
+        call_graph_->get_scc_id(callee) == call_graph_->get_scc_id(caller) or
+        call_graph_->may_recurse(callee))
+        return false;
+
+    int size = size_.at(callee);
+    if (caller_size + size > CALLER_SIZE_LIMIT)
+        return false;
+    // 函数没有地址，调用点就是它全部的使用
+    if (callee->get_use_list().size() == 1 and size <= LAST_CALL_LIMIT)
+        return true;
+
+    int num_args = call->get_num_operand() - 1;
+    int cost = size - CALL_COST - ARG_COST * num_args;
+    // profile 中从未执行的调用点，只内联不增大代码的函数
+    if (call->has_profile_count() and call->get_profile_count() == 0)
+        return cost <= 0;
+
+    int threshold = INLINE_THRESHOLD;
+    if (is_leaf(callee))
+        threshold += LEAF_BONUS;
+    if (call->has_profile_count()) {
+        if (call->get_profile_count() * HOT_CALL_RATIO >= max_call_count_)
+            threshold += HOT_BONUS;
+    } else {
+        auto depth = loop_depth_.find(call->get_parent());
+        if (depth != loop_depth_.end())
+            threshold += LOOP_BONUS * std::min(depth->second, MAX_LOOP_DEPTH);
+    }
+    for (int i = 1; i <= num_args; ++i)
+        if (dynamic_cast<Constant *>(call->get_operand(i)))
+            threshold += CONST_ARG_BONUS;
+    return cost <= threshold;
+}
+
+/**
+ * @brief 把 inst 之后的指令移到新建的块中
+ * @return 新块，原块的后继都改为新块的后继
+ */
+BasicBlock *Inliner::split_block_after(Instruction *inst) {
+    auto bb = inst->get_parent();
+    auto new_bb = BasicBlock::create(m_, "", bb->get_parent());
+    auto &insts = bb->get_instructions();
+    for (auto it = std::next(inst->getIterator()); it != insts.end();) {
+        auto moved = &*it++;
+        bb->remove_instr(moved);
+        moved->set_parent(new_bb);
+        new_bb->add_instruction(moved);
+    }
+    for (auto succ : bb->get_succ_basic_blocks()) {
+        new_bb->add_succ_basic_block(succ);
+        auto &preds = succ->get_pre_basic_blocks();
+        std::replace(preds.begin(), preds.end(), bb, new_bb);
+        for (auto &succ_inst : succ->get_instructions()) {
+            if (not succ_inst.is_phi())
+                break;
+            for (unsigned i = 1; i < succ_inst.get_num_operand(); i += 2)
+                if (succ_inst.get_operand(i) == bb)
+                    succ_inst.set_operand(i, new_bb);
+        }
+    }
+    bb->get_succ_basic_blocks().clear();
+    return new_bb;
+}
+
+/**
+ * @brief 在调用点展开被调用函数
+ *
+ * 调用所在的块在调用之后断开，复制的函数体插入两者之间：
+ * 调用前的部分跳到复制的入口块，每个 ret 改为跳到调用后的部分，
+ * 返回值多于一个时在调用后的部分用 phi 合并。越界处理块（exceptBB）
+ * 仍以 ret 结尾，返回调用者返回类型的零值。
+ */
+void Inliner::inline_call(CallInst *call) {
+    auto callee = static_cast<Function *>(call->get_operand(0));
+    auto bb = call->get_parent();
+    auto caller = bb->get_parent();
+    // 新建的块都在函数末尾，之后移到 bb 与原来的下一个块之间
+    auto &caller_blocks = caller->get_basic_blocks();
+    auto pos = std::next(bb->getIterator());
+    auto cont = split_block_after(call);
+
+    ValueMap vmap;
+    unsigned arg_no = 1;
+    for (auto &arg : callee->get_args())
+        vmap[&arg] = call->get_operand(arg_no++);
+    std::vector<BasicBlock *> blocks;
+    for (auto &callee_bb : callee->get_basic_blocks())
+        blocks.push_back(&callee_bb);
+    auto clones = clone_blocks(blocks, caller, vmap);
+    // 复制进来的调用点只在本次调用中执行
+    if (call->has_profile_count() and callee->has_entry_count() and
+        callee->get_entry_count() > 0) {
+        auto scale = static_cast<double>(call->get_profile_count()) /
+                     callee->get_entry_count();
+        for (auto bb : blocks)
+            for (auto &inst : bb->get_instructions())
+                if (inst.is_call() and static_cast<CallInst *>(&inst)
+                                           ->has_profile_count()) {
+                    auto clone = static_cast<CallInst *>(vmap.at(&inst));
+                    clone->set_profile_count(static_cast<unsigned long>(
+                        clone->get_profile_count() * std::min(scale, 1.0)));
+                }
+    }
+
+    // 保持布局顺序：调用前的部分、函数体、调用后的部分
+    for (auto clone : clones) {
+        caller_blocks.remove(clone);
+        caller_blocks.insert(pos, clone);
+    }
+    caller_blocks.remove(cont);
+    caller_blocks.insert(pos, cont);
+
+    int depth = loop_depth_[bb];
+    loop_depth_[cont] = depth;
+    for (unsigned i = 0; i < blocks.size(); ++i)
+        loop_depth_[clones[i]] = depth + loop_depth_[blocks[i]];
+
+    std::vector<std::pair<Value *, BasicBlock *>> ret_vals;
+    auto entry = caller->get_entry_block();
+    for (unsigned i = 0; i < blocks.size(); ++i) {
+        auto clone = clones[i];
+        auto term = blocks[i]->get_terminator();
+        if (term->is_ret() and clone->is_except_block()) {
+            // 越界处理块保持原样：调用 neg_idx_except 后直接从调用者返回
+            auto ret_type = caller->get_return_type();
+            if (ret_type->is_void_type())
+                ReturnInst::create_void_ret(clone);
+            else if (ret_type->is_float_type())
+                ReturnInst::create_ret(ConstantFP::get(0.0f, m_), clone);
+            else
+                ReturnInst::create_ret(ConstantInt::get(0, m_), clone);
+        } else if (term->is_ret()) {
+            if (not static_cast<ReturnInst *>(term)->is_void_ret())
+                ret_vals.push_back(
+                    {map_value(vmap, term->get_operand(0)), clone});
+            BranchInst::create_br(cont, clone);
+        }
+        // 局部变量移到调用者的入口块，每次调用不必重新分配
+        for (auto it = clone->get_instructions().begin();
+             it != clone->get_instructions().end();) {
+            auto inst = &*it++;
+            if (not inst->is_alloca())
+                continue;
+            clone->remove_instr(inst);
+            inst->set_parent(entry);
+            entry->add_instr_begin(inst);
+        }
+    }
+
+    if (not call->is_void()) {
+        Value *ret_val;
+        if (ret_vals.empty()) {
+            // 被调用者不会返回，调用之后的部分不可达
+            if (call->get_type()->is_float_type())
+                ret_val = ConstantFP::get(0.0f, m_);
+            else
+                ret_val = ConstantInt::get(0, m_);
+        } else if (ret_vals.size() == 1) {
+            ret_val = ret_vals[0].first;
+        } else {
+            std::vector<Value *> vals;
+            std::vector<BasicBlock *> preds;
+            for (auto [val, pred] : ret_vals) {
+                vals.push_back(val);
+                preds.push_back(pred);
+            }
+            auto phi = PhiInst::create_phi(call->get_type(), cont, vals, preds);
+            cont->add_instr_begin(phi);
+            ret_val = phi;
+        }
+        call->replace_all_use_with(ret_val);
+    }
+    BranchInst::create_br(clones.front(), bb);
+    bb->erase_instr(call);
+}
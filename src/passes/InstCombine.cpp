@@ -0,0 +1,295 @@
+#include "InstCombine.hpp"
+#include "ConstantFolding.hpp"
+#include "Function.hpp"
+#include "PatternMatch.hpp"
+#include "logging.hpp"
+
+#include <climits>
+#include <cmath>
+
+using namespace PatternMatch;
+
+void InstCombine::run() {
+    for (auto &f : m_->get_functions()) {
+        if (f.is_declaration())
+            continue;
+        run_on_func(&f);
+    }
+    LOG_INFO << "instcombine combined " << combined_ << " instructions";
+}
+
+void InstCombine::push(Instruction *inst) {
+    if (in_worklist_.insert(inst).second)
+        worklist_.push_back(inst);
+}
+
+void InstCombine::push_users(Value *val) {
+    for (auto &use : val->get_use_list())
+        if (auto inst = dynamic_cast<Instruction *>(use.val_))
+            push(inst);
+}
+
+/**
+ * @brief 以工作表驱动的改写
+ *
+ * 初始时所有指令都在工作表中。指令被替换时，它的使用者与操作数重新入表，
+ * 然后把该指令移出基本块并记入 erased_：出表时跳过它，结束时统一释放，
+ * 以免其地址被新指令复用；原地修改时，指令自身与使用者重新入表。
+ * 改写后变为无用的其他指令留给死代码删除。
+ */
+void InstCombine::run_on_func(Function *f) {
+    worklist_.clear();
+    in_worklist_.clear();
+    erased_.clear();
+    for (auto &bb : f->get_basic_blocks())
+        for (auto &inst : bb.get_instructions())
+            push(&inst);
+
+    while (not worklist_.empty()) {
+        auto inst = worklist_.front();
+        worklist_.pop_front();
+        in_worklist_.erase(inst);
+        if (erased_.count(inst))
+            continue;
+
+        auto res = visit(inst);
+        if (res == nullptr)
+            continue;
+        ++combined_;
+        if (res == inst) {
+            push(inst);
+            push_users(inst);
+            continue;
+        }
+        if (auto new_inst = dynamic_cast<Instruction *>(res))
+            push(new_inst);
+        push_users(inst);
+        inst->replace_all_use_with(res);
+        // 操作数可能因此变为无用，让它们也有机会被重新考察
+        for (auto op : inst->get_operands())
+            if (auto op_inst = dynamic_cast<Instruction *>(op))
+                push(op_inst);
+        inst->remove_all_operands();
+        inst->get_parent()->remove_instr(inst);
+        erased_.insert(inst);
+    }
+    for (auto inst : erased_)
+        delete inst;
+    erased_.clear();
+}
+
+Value *InstCombine::visit(Instruction *inst) {
+    if (auto c = constant_fold(inst))
+        return c;
+    switch (inst->get_instr_type()) {
+    case Instruction::add:
+        return visit_add(inst);
+    case Instruction::sub:
+        return visit_sub(inst);
+    case Instruction::mul:
+        return visit_mul(inst);
+    case Instruction::sdiv:
+        return visit_sdiv(inst);
+    case Instruction::fadd:
+    case Instruction::fsub:
+    case Instruction::fmul:
+    case Instruction::fdiv:
+        return visit_float(inst);
+    case Instruction::fptosi:
+        return visit_fptosi(inst);
+    default:
+        if (inst->is_cmp())
+            return visit_cmp(inst);
+        return nullptr;
+    }
+}
+
+// 把可交换运算的常量操作数换到右边，便于后续的模式只匹配一种顺序
+bool InstCombine::canonicalize_commutative(Instruction *inst) {
+    auto lhs = inst->get_operand(0), rhs = inst->get_operand(1);
+    if (dynamic_cast<Constant *>(lhs) == nullptr or
+        dynamic_cast<Constant *>(rhs) != nullptr)
+        return false;
+    inst->set_operand(0, rhs);
+    inst->set_operand(1, lhs);
+    return true;
+}
+
+Value *InstCombine::visit_add(Instruction *inst) {
+    bool changed = canonicalize_commutative(inst);
+    auto bb = inst->get_parent();
+    auto m = inst->get_module();
+    Value *x, *y;
+    int c1, c2;
+
+    // x + 0 => x
+    if (match(inst, m_Add(m_Value(x), m_Zero())))
+        return x;
+    // (x + c1) + c2 => x + (c1 + c2)
+    if (match(inst, m_Add(m_Add(m_Value(x), m_ConstInt(c1)), m_ConstInt(c2)))) {
+        auto sum = static_cast<unsigned>(c1) + static_cast<unsigned>(c2);
+        inst->set_operand(0, x);
+        inst->set_operand(1, ConstantInt::get(static_cast<int>(sum), m));
+        return inst;
+    }
+    // x + (0 - y) => x - y
+    if (match(inst, m_c_Add(m_Value(x), m_Neg(m_Value(y)))))
+        return bb->create_instr_before(inst, [&](BasicBlock *bb) {
+            return IBinaryInst::create_sub(x, y, bb);
+        });
+    return changed ? inst : nullptr;
+}
+
+Value *InstCombine::visit_sub(Instruction *inst) {
+    auto bb = inst->get_parent();
+    auto m = inst->get_module();
+    Value *x, *y;
+    int c;
+
+    // x - 0 => x
+    if (match(inst, m_Sub(m_Value(x), m_Zero())))
+        return x;
+    // x - x => 0
+    if (inst->get_operand(0) == inst->get_operand(1))
+        return ConstantInt::get(0, m);
+    // 0 - (0 - x) => x
+    if (match(inst, m_Neg(m_Neg(m_Value(x)))))
+        return x;
+    // x - (0 - y) => x + y
+    if (match(inst, m_Sub(m_Value(x), m_Neg(m_Value(y)))))
+        return bb->create_instr_before(inst, [&](BasicBlock *bb) {
+            return IBinaryInst::create_add(x, y, bb);
+        });
+    // x - c => x + (-c)，使常量链统一由 visit_add 处理
+    if (match(inst, m_Sub(m_Value(x), m_ConstInt(c))) and c != INT_MIN)
+        return bb->create_instr_before(inst, [&](BasicBlock *bb) {
+            return IBinaryInst::create_add(x, ConstantInt::get(-c, m), bb);
+        });
+    return nullptr;
+}
+
+Value *InstCombine::visit_mul(Instruction *inst) {
+    bool changed = canonicalize_commutative(inst);
+    auto m = inst->get_module();
+    Value *x;
+    int c1, c2;
+
+    // x * 1 => x
+    if (match(inst, m_Mul(m_Value(x), m_One())))
+        return x;
+    // x * 0 => 0
+    if (match(inst, m_Mul(m_Value(), m_Zero())))
+        return ConstantInt::get(0, m);
+    // (x * c1) * c2 => x * (c1 * c2)
+    if (match(inst, m_Mul(m_Mul(m_Value(x), m_ConstInt(c1)), m_ConstInt(c2)))) {
+        auto prod = static_cast<unsigned>(c1) * static_cast<unsigned>(c2);
+        inst->set_operand(0, x);
+        inst->set_operand(1, ConstantInt::get(static_cast<int>(prod), m));
+        return inst;
+    }
+    return changed ? inst : nullptr;
+}
+
+Value *InstCombine::visit_sdiv(Instruction *inst) {
+    Value *x;
+    // x / 1 => x
+    if (match(inst, m_SDiv(m_Value(x), m_One())))
+        return x;
+    // 0 / x => 0，x 为 0 时行为未定义
+    if (match(inst, m_SDiv(m_Zero(), m_Value())))
+        return inst->get_operand(0);
+    return nullptr;
+}
+
+/**
+ * @brief 浮点的恒等式
+ *
+ * 只做在 IEEE 754 下严格成立的改写：x + 0.0 在 x 为 -0.0 时得到 +0.0，
+ * 因此加法只消去 -0.0，减法只消去 +0.0。
+ */
+Value *InstCombine::visit_float(Instruction *inst) {
+    bool changed = false;
+    if (inst->get_instr_type() == Instruction::fadd or
+        inst->get_instr_type() == Instruction::fmul)
+        changed = canonicalize_commutative(inst);
+    Value *x;
+    ConstantFP *c;
+
+    // x * 1.0 => x, x / 1.0 => x
+    if (match(inst, m_FMul(m_Value(x), m_SpecificFP(1.0f))) or
+        match(inst, m_FDiv(m_Value(x), m_SpecificFP(1.0f))))
+        return x;
+    // x + (-0.0) => x
+    if (match(inst, m_FAdd(m_Value(x), m_ConstFP(c))) and
+        c->get_value() == 0.0f and std::signbit(c->get_value()))
+        return x;
+    // x - 0.0 => x
+    if (match(inst, m_FSub(m_Value(x), m_ConstFP(c))) and
+        c->get_value() == 0.0f and not std::signbit(c->get_value()))
+        return x;
+    return changed ? inst : nullptr;
+}
+
+/**
+ * @brief 化简条件
+ *
+ * IRBuilder 把比较结果 zext 为 i32 后再与 0 比较以得到分支条件，
+ * 这里把这样的往返还原成原来的 i1 值或取反的比较。
+ */
+Value *InstCombine::visit_cmp(Instruction *inst) {
+    Value *b, *lhs, *rhs;
+    Instruction::OpID pred;
+
+    // zext(b) != 0 => b, zext(b) == 1 => b
+    if (match(inst, m_ICmpNE(m_ZExt(m_Value(b)), m_Zero())) or
+        match(inst, m_ICmpEQ(m_ZExt(m_Value(b)), m_One())))
+        return b;
+    // zext(a op b) == 0 => a !op b
+    if (match(inst, m_ICmpEQ(m_ZExt(m_ICmp(pred, m_Value(lhs), m_Value(rhs))),
+                             m_Zero()))) {
+        return inst->get_parent()->create_instr_before(
+            inst, [&](BasicBlock *bb) {
+                switch (pred) {
+                case Instruction::ge:
+                    return ICmpInst::create_lt(lhs, rhs, bb);
+                case Instruction::gt:
+                    return ICmpInst::create_le(lhs, rhs, bb);
+                case Instruction::le:
+                    return ICmpInst::create_gt(lhs, rhs, bb);
+                case Instruction::lt:
+                    return ICmpInst::create_ge(lhs, rhs, bb);
+                case Instruction::eq:
+                    return ICmpInst::create_ne(lhs, rhs, bb);
+                default:
+                    return ICmpInst::create_eq(lhs, rhs, bb);
+                }
+            });
+    }
+    return nullptr;
+}
+
+/**
+ * @brief x 转为 float 是否一定没有舍入
+ *
+ * float 有 24 位有效数字，绝对值不超过 2^24 的整数都能精确表示。
+ * 能证明的情况：zext 得到的 0/1、足够小的常量，
+ * 以及除以绝对值不小于 256 的常量的商（|x / c| <= 2^31 / 2^8 = 2^23）。
+ */
+bool InstCombine::is_exact_in_float(Value *val) {
+    if (auto c = dynamic_cast<ConstantInt *>(val))
+        return std::abs(static_cast<long>(c->get_value())) <= (1l << 24);
+    int c;
+    if (match(val, m_ZExt(m_Value())))
+        return true;
+    if (match(val, m_SDiv(m_Value(), m_ConstInt(c))))
+        return std::abs(static_cast<long>(c)) >= 256;
+    return false;
+}
+
+Value *InstCombine::visit_fptosi(Instruction *inst) {
+    Value *x;
+    // fptosi(sitofp(x)) => x
+    if (match(inst, m_FPToSI(m_SIToFP(m_Value(x)))) and is_exact_in_float(x))
+        return x;
+    return nullptr;
+}
@@ -4,7 +4,9 @@
 #include "GlobalVariable.hpp"
 #include "Instruction.hpp"
 #include "LICM.hpp"
+#include "LoopSimplify.hpp"
 #include "PassManager.hpp"
+#include <algorithm>
 #include <cstddef>
 #include <memory>
 #include <vector>
@@ -15,10 +17,16 @@
  */
 void LoopInvariantCodeMotion::run() {
 
+    // 规范化后每个循环都有 preheader
+    LoopSimplify(m_).run();
     loop_detection_ = std::make_unique<LoopDetection>(m_);
     loop_detection_->run();
     func_info_ = std::make_unique<FuncInfo>(m_);
     func_info_->run();
+    alias_analysis_ = std::make_unique<AliasAnalysis>(m_);
+    alias_analysis_->run();
+    dominators_ = std::make_unique<Dominators>(m_);
+    dom_func_ = nullptr;
     for (auto &loop : loop_detection_->get_loops()) {
         is_loop_done_[loop] = false;
     }
@@ -44,145 +52,255 @@ void LoopInvariantCodeMotion::traverse_loop(std::shared_ptr<Loop> loop) {
     run_on_loop(loop);
 }
 
-// TODO: 实现collect_loop_info函数
-// 1. 遍历当前循环及其子循环的所有指令
-// 2. 收集所有指令到loop_instructions中
-// 3. 检查store指令是否修改了全局变量，如果是则添加到updated_global中
-// 4. 检查是否包含非纯函数调用，如果有则设置contains_impure_call为true
-void LoopInvariantCodeMotion::collect_loop_info(
-    std::shared_ptr<Loop> loop,
-    std::set<Value *> &loop_instructions,
-    std::set<Value *> &updated_global,
-    bool &contains_impure_call) {
-    
-    // 当前循环所有指令
+// LICM 不改变 CFG，同一函数的支配树只需计算一次
+void LoopInvariantCodeMotion::prepare_function(Function *func) {
+    if (dom_func_ == func)
+        return;
+    dominators_->run_on_func(func);
+    dom_func_ = func;
+    dom_order_.clear();
+    for (auto bb : dominators_->get_dom_dfs_order())
+        dom_order_[bb] = dom_order_.size();
+}
+
+// 循环中从入口可达的块，按支配树先序排列
+std::vector<BasicBlock *>
+LoopInvariantCodeMotion::sorted_blocks(std::shared_ptr<Loop> loop) {
+    std::vector<BasicBlock *> blocks;
+    for (auto bb : loop->get_blocks())
+        if (dom_order_.count(bb))
+            blocks.push_back(bb);
+    std::sort(blocks.begin(), blocks.end(), [&](auto a, auto b) {
+        return dom_order_.at(a) < dom_order_.at(b);
+    });
+    return blocks;
+}
+
+// 可观察的副作用：写内存、IO 与可能终止程序的调用
+bool LoopInvariantCodeMotion::has_side_effect(Instruction *inst) {
+    if (inst->is_store())
+        return true;
+    if (not inst->is_call())
+        return false;
+    auto callee = static_cast<Function *>(inst->get_operand(0));
+    return callee->is_declaration() or
+           not func_info_->is_readonly_function(callee) or
+           func_info_->may_exit(callee);
+}
+
+/**
+ * @brief 收集循环（含子循环）中可能写内存的 store 和 call，
+ * 以及从 header 出发、不经过回边时可能在副作用之后到达的块
+ */
+void LoopInvariantCodeMotion::collect_loop_info(std::shared_ptr<Loop> loop) {
+    memory_writers_.clear();
+    invariant_ptrs_.clear();
+    guaranteed_blocks_.clear();
+    after_side_effects_.clear();
+    std::vector<BasicBlock *> work_list;
+    auto header = loop->get_header();
+    auto add_succs = [&](BasicBlock *bb) {
+        for (auto succ : bb->get_succ_basic_blocks())
+            if (succ != header and loop->contains(succ) and
+                after_side_effects_.insert(succ).second)
+                work_list.push_back(succ);
+    };
+    // 循环的块中已包含子循环的块
     for (auto bb : loop->get_blocks()) {
+        bool side_effect = false;
         for (auto &inst : bb->get_instructions()) {
-            loop_instructions.insert(&inst);
-            // 检测是否修改了全局变量
-            if (auto store = dynamic_cast<StoreInst *>(&inst)) {
-                auto ptr = store->get_operand(1);
-                if (dynamic_cast<GlobalVariable *>(ptr)) {
-                    updated_global.insert(ptr);
-                }
-            }
-            // 检测非纯函数
+            side_effect |= has_side_effect(&inst);
+            if (inst.is_store())
+                memory_writers_.push_back(&inst);
             else if (auto call = dynamic_cast<CallInst *>(&inst)) {
-                if (!func_info_->is_pure_function(call->get_function())) {
-                    contains_impure_call = true;
-                }
+                auto callee = static_cast<Function *>(call->get_operand(0));
+                if (not func_info_->is_readonly_function(callee))
+                    memory_writers_.push_back(&inst);
             }
         }
+        if (side_effect)
+            add_succs(bb);
     }
-    // 递归遍历子循环
-    for (auto &sub_loop : loop->get_sub_loops()) {
-        collect_loop_info(sub_loop, loop_instructions, updated_global,
-                          contains_impure_call);
+    while (not work_list.empty()) {
+        auto bb = work_list.back();
+        work_list.pop_back();
+        add_succs(bb);
     }
 }
 
-/**
- * @brief 对单个循环执行不变式外提优化
- * @param loop 要优化的循环
- * 
- */
-void LoopInvariantCodeMotion::run_on_loop(std::shared_ptr<Loop> loop) {
-    std::set<Value *> loop_instructions;
-    std::set<Value *> updated_global;
-    bool contains_impure_call = false;
-    collect_loop_info(loop, loop_instructions, updated_global, contains_impure_call);
-
-    std::vector<Value *> loop_invariant;
-
-    // 识别循环不变式指令
-    bool changed;
-    do {
-        changed = false;
-        for (auto inst : loop_instructions) {
-            // 跳过已确定不变的指令
-            if (std::find(loop_invariant.begin(), loop_invariant.end(), inst) != loop_invariant.end())
-                continue;
-
-            auto now_inst = dynamic_cast<Instruction *>(inst);
-
-            // 跳过store、ret、br、phi、非纯函数调用等
-            if (now_inst->is_store() || now_inst->is_ret() || now_inst->is_br() || now_inst->is_phi() ||
-                (now_inst->is_call() && !func_info_->is_pure_function((Function *)now_inst->get_operand(0))))
-                continue;
-
-            // 特殊处理全局变量的load指令
-            if (now_inst->is_load() &&
-                (dynamic_cast<GlobalVariable *>(now_inst->get_operand(0)) && 
-                dynamic_cast<GetElementPtrInst *>(now_inst->get_operand(0))))
-                continue;
-
-            // 检查所有操作数是否都是循环不变的
-            bool operands_are_invariant = true;
-            for (auto op : now_inst->get_operands()) {
-                if (std::find(loop_invariant.begin(), loop_invariant.end(), op) == loop_invariant.end()) {
-                    operands_are_invariant = false;
-                    break;
-                }
-            }
+// 循环中没有任何指令可能写 load 的地址时，load 的结果不变；
+// 结果按地址缓存，同一地址的 load 只检查一次
+bool LoopInvariantCodeMotion::is_invariant_load(LoadInst *load) {
+    auto ptr = load->get_lval();
+    auto it = invariant_ptrs_.find(ptr);
+    if (it != invariant_ptrs_.end())
+        return it->second;
+    bool invariant = std::none_of(
+        memory_writers_.begin(), memory_writers_.end(), [&](auto writer) {
+            return alias_analysis_->get_mod_ref(writer, ptr) & Mod;
+        });
+    invariant_ptrs_[ptr] = invariant;
+    return invariant;
+}
 
-            if (operands_are_invariant) {
-                loop_invariant.push_back(now_inst);
-                changed = true;
-            }
-        }
-    } while (changed);
+// bb 支配循环的所有 exiting 块时，只要进入循环 bb 就一定会执行；
+// 没有 exiting 块的循环不能据此判断，保守地返回 false
+bool LoopInvariantCodeMotion::is_guaranteed_to_execute(
+    std::shared_ptr<Loop> loop, BasicBlock *bb) {
+    auto it = guaranteed_blocks_.find(bb);
+    if (it != guaranteed_blocks_.end())
+        return it->second;
+    auto &exiting = loop->get_exiting_blocks();
+    bool guaranteed =
+        not exiting.empty() and
+        std::all_of(exiting.begin(), exiting.end(), [&](auto exit) {
+            return dominators_->is_dominate(bb, exit);
+        });
+    guaranteed_blocks_[bb] = guaranteed;
+    return guaranteed;
+}
 
-    if (loop->get_preheader() == nullptr) {
-        loop->set_preheader(BasicBlock::create(m_, "", loop->get_header()->get_parent()));
+/**
+ * @brief 判断 inst 能否外提到 preheader
+ *
+ * 操作数都定义在循环外的指令是不变式（已外提的指令不再属于循环）；
+ * load 还要求循环中没有可能写其地址的指令（由别名分析判断）。
+ * 外提到 preheader 后，即使循环一次都不执行也会执行该指令，
+ * 因此可能出错的指令（地址不一定有效的 load、可能除以 0 的 sdiv/srem、
+ * 函数调用）只有在进入循环就一定执行时才外提；它们还会被提前到
+ * 同一次迭代中先执行的副作用之前，after_side_effect 表示 inst 之前
+ * 可能已执行了副作用，此时不外提。
+ */
+bool LoopInvariantCodeMotion::can_hoist(std::shared_ptr<Loop> loop,
+                                        Instruction *inst,
+                                        bool after_side_effect) {
+    // 跳过store、ret、br、phi、alloca
+    if (inst->is_store() || inst->is_ret() || inst->is_br() ||
+        inst->is_phi() || inst->is_alloca())
+        return false;
+    // 只外提纯函数调用
+    if (inst->is_call()) {
+        auto callee = static_cast<Function *>(inst->get_operand(0));
+        if (callee->is_declaration() or
+            not func_info_->is_pure_function(callee))
+            return false;
     }
 
-    if (loop_invariant.empty())
-        return;
+    // 检查所有操作数是否都是循环不变的
+    for (auto op : inst->get_operands()) {
+        auto op_inst = dynamic_cast<Instruction *>(op);
+        if (op_inst and loop->contains(op_inst->get_parent()))
+            return false;
+    }
 
-    auto preheader = loop->get_preheader();
+    if (inst->is_load() and
+        not is_invariant_load(static_cast<LoadInst *>(inst)))
+        return false;
 
-    // 更新 phi 指令
-    for (auto &phi_inst_ : loop->get_header()->get_instructions()) {
-        if (phi_inst_.get_instr_type() != Instruction::phi)
-            break;
+    bool may_trap = inst->is_call() or inst->is_load();
+    if (inst->is_load())
+        may_trap = not alias_analysis_->is_known_dereferenceable(
+            static_cast<LoadInst *>(inst)->get_lval());
+    if (inst->is_div() or inst->is_rem()) {
+        auto divisor = dynamic_cast<ConstantInt *>(inst->get_operand(1));
+        may_trap = divisor == nullptr or divisor->get_value() == 0;
+    }
+    return not may_trap or (not after_side_effect and
+                            is_guaranteed_to_execute(loop, inst->get_parent()));
+}
 
-        auto phi = &phi_inst_;
-        preheader->add_instr_begin(phi);
-        loop->get_header()->erase_instr(phi);
+/**
+ * @brief 只在循环之后使用的 inst 可以下沉到的出口块，不能下沉时返回 nullptr
+ *
+ * 要求 inst 的所有使用都在循环外且被同一个出口块 E 支配，
+ * inst 所在块支配 E。这时到达 E 的最后一次迭代一定执行过 inst，
+ * 之后其操作数不再被重新定值，在 E 中计算得到相同的结果。
+ * 下沉的指令只在离开循环时执行一次；不下沉 load、call 和可能除以 0 的
+ * 除法，它们在循环中的每次执行都可能有不同的结果或出错。
+ */
+BasicBlock *LoopInvariantCodeMotion::get_sink_block(std::shared_ptr<Loop> loop,
+                                                    Instruction *inst) {
+    if (inst->is_void() or inst->is_phi() or inst->is_alloca() or
+        inst->is_load() or inst->is_call() or inst->get_use_list().empty())
+        return nullptr;
+    if (inst->is_div() or inst->is_rem()) {
+        auto divisor = dynamic_cast<ConstantInt *>(inst->get_operand(1));
+        if (divisor == nullptr or divisor->get_value() == 0)
+            return nullptr;
     }
 
-    // 用跳转指令重构控制流图
-    std::vector<BasicBlock *> pred_to_remove;
-    for (auto &pred : loop->get_header()->get_pre_basic_blocks()) {
-        auto latches = loop->get_latches();
-        if (std::find(latches.begin(), latches.end(), pred) == latches.end()) { // 不是latches
-            pred->remove_succ_basic_block(loop->get_header());
-            pred->add_succ_basic_block(preheader);
+    BasicBlock *sink = nullptr;
+    for (auto &use : inst->get_use_list()) {
+        auto user = static_cast<Instruction *>(use.val_);
+        auto bb = user->get_parent();
+        // phi 的使用位于对应前驱的末尾
+        if (user->is_phi())
+            bb = static_cast<BasicBlock *>(user->get_operand(use.arg_no_ + 1));
+        if (loop->contains(bb) or not dominators_->is_reachable(bb))
+            return nullptr;
+        if (sink == nullptr) {
+            for (auto exit : loop->get_exit_blocks())
+                if (dominators_->is_dominate(exit, bb))
+                    sink = exit;
+            if (sink == nullptr)
+                return nullptr;
+        } else if (not dominators_->is_dominate(sink, bb)) {
+            return nullptr;
         }
     }
+    if (not dominators_->is_dominate(inst->get_parent(), sink))
+        return nullptr;
+    return sink;
+}
 
-    for (auto &pred : pred_to_remove) {
-        loop->get_header()->remove_pre_basic_block(pred);
-    }
+/**
+ * @brief 对单个循环执行不变式外提与下沉
+ * @param loop 要优化的循环
+ *
+ * 按支配树先序遍历循环的块，操作数的定值先于使用被访问，
+ * 能外提的指令立即移到 preheader，一遍即可找出全部不变式；
+ * 再按相反的顺序下沉只在循环之后使用的指令，使用者先于定值被访问。
+ * 两遍的工作量都与循环的大小成线性关系。
+ */
+void LoopInvariantCodeMotion::run_on_loop(std::shared_ptr<Loop> loop) {
+    auto preheader = loop->get_preheader();
+    if (preheader == nullptr)
+        return;
+    prepare_function(preheader->get_parent());
+    collect_loop_info(loop);
+    auto blocks = sorted_blocks(loop);
 
     // 外提循环不变指令
-    for (auto inst : loop_invariant) {
-        preheader->add_instruction((Instruction *)inst);
-        for (auto bb : loop->get_blocks()) {
-            auto &instlist = bb->get_instructions();
-            for (auto &now_inst : instlist) {
-                if (&now_inst == (Instruction *)inst) {
-                    bb->erase_instr((Instruction *)inst);
-                }
+    for (auto bb : blocks) {
+        bool after_side_effect = after_side_effects_.count(bb) != 0;
+        auto &insts = bb->get_instructions();
+        for (auto it = insts.begin(); it != insts.end();) {
+            auto inst = &*it++;
+            if (not can_hoist(loop, inst, after_side_effect)) {
+                after_side_effect |= has_side_effect(inst);
+                continue;
             }
+            bb->remove_instr(inst);
+            preheader->add_instr_before_terminator(inst);
         }
     }
 
-    // 插入 preheader 的跳转指令到 header
-    BranchInst::create_br(loop->get_header(), preheader);
-
-    // 将 preheader 插入父循环
-    if (loop->get_parent() != nullptr) {
-        loop->get_parent()->add_block(preheader);
+    // 下沉只在循环之后使用的指令，插到出口块的 phi 之后；
+    // 后下沉的指令是先下沉者的操作数，放在它们之前
+    for (auto bb_it = blocks.rbegin(); bb_it != blocks.rend(); ++bb_it) {
+        auto bb = *bb_it;
+        auto &insts = bb->get_instructions();
+        for (auto it = insts.rbegin(); it != insts.rend();) {
+            auto inst = &*it++;
+            auto sink = get_sink_block(loop, inst);
+            if (sink == nullptr)
+                continue;
+            auto pos = std::find_if(
+                sink->get_instructions().begin(),
+                sink->get_instructions().end(),
+                [](auto &inst) { return not inst.is_phi(); });
+            bb->remove_instr(inst);
+            sink->insert_instr_before(&*pos, inst);
+        }
     }
 }
@@ -0,0 +1,246 @@
+#include "Liveness.hpp"
+
+#include <algorithm>
+
+void Liveness::run() {
+    for (auto &f1 : m_->get_functions()) {
+        auto f = &f1;
+        if (f->is_declaration())
+            continue;
+        run_on_func(f);
+    }
+}
+
+/**
+ * @brief 对单个函数计算活跃信息
+ * @param f 要分析的函数
+ *
+ * 1. 为参数和有结果的指令编号，并给指令线性编号
+ * 2. 计算每个块的 use/def 以及经由出边的 phi 使用
+ * 3. 用 DataFlowSolver 求解 live-in/live-out
+ * 4. 由块级结果构建每个值的活跃区间
+ */
+void Liveness::run_on_func(Function *f) {
+    values_.clear();
+    value_index_.clear();
+    use_.clear();
+    def_.clear();
+    phi_use_.clear();
+    live_in_.clear();
+    live_out_.clear();
+    instr_index_.clear();
+    block_range_.clear();
+    intervals_.clear();
+
+    number_values(f);
+    compute_local_sets(f);
+    solve(f);
+    build_intervals(f);
+}
+
+void Liveness::number_values(Function *f) {
+    for (auto &arg : f->get_args()) {
+        value_index_[&arg] = values_.size();
+        values_.push_back(&arg);
+    }
+    unsigned pos = 0;
+    for (auto &bb : f->get_basic_blocks()) {
+        unsigned start = pos;
+        for (auto &inst : bb.get_instructions()) {
+            instr_index_[&inst] = pos++;
+            if (not inst.is_void()) {
+                value_index_[&inst] = values_.size();
+                values_.push_back(&inst);
+            }
+        }
+        block_range_[&bb] = {start, pos};
+    }
+}
+
+void Liveness::compute_local_sets(Function *f) {
+    unsigned n = values_.size();
+    for (auto &bb1 : f->get_basic_blocks()) {
+        auto bb = &bb1;
+        use_[bb].resize(n);
+        def_[bb].resize(n);
+        phi_use_[bb].resize(n);
+    }
+    for (auto &bb1 : f->get_basic_blocks()) {
+        auto bb = &bb1;
+        auto &use = use_[bb];
+        auto &def = def_[bb];
+        for (auto &inst : bb->get_instructions()) {
+            if (inst.is_phi()) {
+                // phi 的操作数算作对应前驱末尾的使用
+                for (auto [val, pre_bb] :
+                     static_cast<PhiInst *>(&inst)->get_phi_pairs()) {
+                    auto it = value_index_.find(val);
+                    if (it != value_index_.end())
+                        phi_use_[pre_bb].set(it->second);
+                }
+            } else {
+                for (auto op : inst.get_operands()) {
+                    auto it = value_index_.find(op);
+                    if (it != value_index_.end() and not def.test(it->second))
+                        use.set(it->second);
+                }
+            }
+            if (not inst.is_void())
+                def.set(value_index_.at(&inst));
+        }
+    }
+}
+
+/**
+ * @brief 活跃变量的数据流方程（后向、并）
+ *
+ * live_out(B) = phi_use(B) ∪ ⋃_{S ∈ succ(B)} live_in(S)
+ * live_in(B)  = use(B) ∪ (live_out(B) - def(B))
+ */
+struct Liveness::Problem {
+    using Domain = BitVector;
+    static constexpr DataFlowDirection direction = DataFlowDirection::Backward;
+
+    Liveness &live;
+
+    Domain top() { return BitVector(live.values_.size()); }
+    Domain boundary() { return top(); }
+    void meet(Domain &acc, const Domain &val, BasicBlock *succ,
+              BasicBlock *bb) {
+        acc |= val;
+        acc |= live.phi_use_.at(bb);
+    }
+    Domain transfer(BasicBlock *bb, const Domain &out) {
+        Domain in = out;
+        in.reset(live.def_.at(bb));
+        in |= live.use_.at(bb);
+        return in;
+    }
+};
+
+void Liveness::solve(Function *f) {
+    Problem problem{*this};
+    DataFlowSolver<Problem> solver(problem);
+    solver.solve(f);
+    for (auto &bb1 : f->get_basic_blocks()) {
+        auto bb = &bb1;
+        live_in_[bb] = solver.get_block_entry(bb);
+        live_out_[bb] = solver.get_block_exit(bb);
+    }
+}
+
+/**
+ * @brief 构建活跃区间
+ *
+ * 对每个块从 live-out 出发逆序扫描：值在块内的段从其定值（或块首）
+ * 延伸到最后一次使用之后（或块尾）。phi 在块首同时定值；
+ * 没有使用的定值也占据自身所在的位置。
+ */
+void Liveness::build_intervals(Function *f) {
+    intervals_.resize(values_.size());
+    std::unordered_map<unsigned, unsigned> seg_end;
+    for (auto &bb1 : f->get_basic_blocks()) {
+        auto bb = &bb1;
+        auto [bstart, bend] = block_range_.at(bb);
+        seg_end.clear();
+        live_out_.at(bb).for_each([&](unsigned i) { seg_end[i] = bend; });
+
+        auto &insts = bb->get_instructions();
+        for (auto it = insts.rbegin(); it != insts.rend(); ++it) {
+            auto inst = &*it;
+            unsigned pos = instr_index_.at(inst);
+            if (not inst->is_void()) {
+                unsigned idx = value_index_.at(inst);
+                unsigned from = inst->is_phi() ? bstart : pos;
+                auto end = seg_end.find(idx);
+                if (end != seg_end.end()) {
+                    add_segment(idx, from, end->second);
+                    seg_end.erase(end);
+                } else {
+                    add_segment(idx, from, pos + 1);
+                }
+            }
+            if (inst->is_phi())
+                continue;
+            for (auto op : inst->get_operands()) {
+                auto vi = value_index_.find(op);
+                if (vi != value_index_.end() and
+                    seg_end.find(vi->second) == seg_end.end())
+                    seg_end[vi->second] = pos + 1;
+            }
+        }
+        // 剩下的是 live-in 的值
+        for (auto [idx, end] : seg_end)
+            add_segment(idx, bstart, end);
+    }
+
+    // 排序并合并相邻的段
+    for (auto &interval : intervals_) {
+        std::sort(interval.begin(), interval.end());
+        Interval merged;
+        for (auto seg : interval) {
+            if (not merged.empty() and merged.back().second >= seg.first)
+                merged.back().second =
+                    std::max(merged.back().second, seg.second);
+            else
+                merged.push_back(seg);
+        }
+        interval = std::move(merged);
+    }
+}
+
+void Liveness::add_segment(unsigned idx, unsigned from, unsigned to) {
+    if (from < to)
+        intervals_[idx].emplace_back(from, to);
+}
+
+bool Liveness::is_live_at(Value *val, unsigned pos) const {
+    auto it = value_index_.find(val);
+    if (it == value_index_.end())
+        return false;
+    auto &interval = intervals_[it->second];
+    auto seg = std::upper_bound(
+        interval.begin(), interval.end(), pos,
+        [](unsigned p, const Segment &s) { return p < s.first; });
+    if (seg == interval.begin())
+        return false;
+    --seg;
+    return pos < seg->second;
+}
+
+std::vector<Value *> Liveness::get_live_in_values(BasicBlock *bb) const {
+    std::vector<Value *> res;
+    live_in_.at(bb).for_each([&](unsigned i) { res.push_back(values_[i]); });
+    return res;
+}
+
+std::vector<Value *> Liveness::get_live_out_values(BasicBlock *bb) const {
+    std::vector<Value *> res;
+    live_out_.at(bb).for_each([&](unsigned i) { res.push_back(values_[i]); });
+    return res;
+}
+
+void Liveness::print(Function *f) {
+    f->get_parent()->set_print_name();
+    printf("Liveness of function %s:\n", f->get_name().c_str());
+    auto names = [](const std::vector<Value *> &vals) {
+        std::string res;
+        for (auto val : vals)
+            res += " %" + val->get_name();
+        return res;
+    };
+    for (auto &bb1 : f->get_basic_blocks()) {
+        auto bb = &bb1;
+        printf("%s [%u, %u)\n", bb->get_name().c_str(), get_block_start(bb),
+               get_block_end(bb));
+        printf("  in:%s\n", names(get_live_in_values(bb)).c_str());
+        printf("  out:%s\n", names(get_live_out_values(bb)).c_str());
+    }
+    for (auto val : values_) {
+        std::string output = "%" + val->get_name() + ":";
+        for (auto [from, to] : get_interval(val))
+            output += " [" + std::to_string(from) + ", " +
+                      std::to_string(to) + ")";
+        printf("%s\n", output.c_str());
+    }
+}
@@ -0,0 +1,127 @@
+#include "LoopDeletion.hpp"
+#include "CFGUtil.hpp"
+#include "Function.hpp"
+#include "LoopSimplify.hpp"
+#include "logging.hpp"
+
+#include <tuple>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+void LoopDeletion::run() {
+    func_info_->run();
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        LoopSimplify(m_).run();
+        scev_->run();
+        // 本轮已修改的函数，其中的循环信息已失效
+        std::unordered_set<Function *> modified;
+        auto &loops = scev_->get_loop_detection().get_loops();
+        // 同一函数中内层循环在前，逆序遍历使外层循环先被检查
+        for (auto it = loops.rbegin(); it != loops.rend(); ++it) {
+            auto loop = *it;
+            auto f = loop->get_header()->get_parent();
+            if (modified.count(f) or not loop->is_simplified() or
+                loop->get_exit_blocks().size() != 1)
+                continue;
+            if (not terminates(loop) or has_side_effects(loop) or
+                not delete_loop(loop))
+                continue;
+            modified.insert(f);
+            changed = true;
+        }
+        for (auto f : modified)
+            remove_unreachable_blocks(f);
+    }
+    LOG_INFO << "loop deletion deleted " << deleted_ << " loops";
+}
+
+// 循环及其子循环的回边执行次数都已知
+bool LoopDeletion::terminates(std::shared_ptr<Loop> loop) {
+    ScalarEvolution::Expr count;
+    if (not scev_->get_backedge_taken_count(loop, count))
+        return false;
+    for (auto &sub_loop : loop->get_sub_loops())
+        if (not terminates(sub_loop))
+            return false;
+    return true;
+}
+
+bool LoopDeletion::has_side_effects(std::shared_ptr<Loop> loop) {
+    for (auto bb : loop->get_blocks()) {
+        for (auto &inst : bb->get_instructions()) {
+            if (inst.is_store())
+                return true;
+            if (not inst.is_call())
+                continue;
+            auto callee = static_cast<Function *>(inst.get_operand(0));
+            if (callee->is_declaration() or
+                not func_info_->is_readonly_function(callee) or
+                func_info_->may_exit(callee))
+                return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief 用闭式替换循环之后的使用，并让 preheader 跳过循环
+ * @return 是否删除了循环；有使用无法替换时不修改函数
+ *
+ * 循环只有一个 exiting 块，循环之后的使用都在它之后，被使用的值所在的块
+ * 支配 exiting 块，在最后一次迭代中一定被计算过。
+ */
+bool LoopDeletion::delete_loop(std::shared_ptr<Loop> loop) {
+    ScalarEvolution::Expr count;
+    scev_->get_backedge_taken_count(loop, count);
+    auto preheader = loop->get_preheader();
+    auto exit = loop->get_exit_blocks()[0];
+
+    // 先求出所有闭式，全部成功后才修改函数
+    std::vector<std::tuple<Instruction *, Instruction *, unsigned>> uses;
+    std::unordered_map<Instruction *, ScalarEvolution::Expr> final_exprs;
+    for (auto bb : loop->get_blocks()) {
+        for (auto &inst : bb->get_instructions()) {
+            for (auto &use : inst.get_use_list()) {
+                auto user = static_cast<Instruction *>(use.val_);
+                if (loop->contains(user->get_parent()))
+                    continue;
+                uses.emplace_back(&inst, user, use.arg_no_);
+                if (final_exprs.count(&inst))
+                    continue;
+                ScalarEvolution::Expr expr, final_value;
+                if (not scev_->get_expr(&inst, loop, expr) or
+                    not scev_->evaluate_at(expr, loop, count, final_value))
+                    return false;
+                final_exprs[&inst] = final_value;
+            }
+        }
+    }
+
+    auto pos = preheader->get_terminator();
+    std::unordered_map<Instruction *, Value *> final_values;
+    for (auto &[inst, expr] : final_exprs)
+        final_values[inst] = scev_->expand(expr, pos);
+    for (auto [inst, user, arg_no] : uses)
+        user->set_operand(arg_no, final_values.at(inst));
+
+    // 出口块的 phi 中来自循环的入边改为来自 preheader
+    for (auto &inst : exit->get_instructions()) {
+        if (not inst.is_phi())
+            break;
+        auto phi = static_cast<PhiInst *>(&inst);
+        Value *val = nullptr;
+        for (auto [in_val, in_bb] : phi->get_phi_pairs()) {
+            if (not loop->contains(in_bb))
+                continue;
+            val = in_val;
+            phi->remove_phi_operand(in_bb);
+        }
+        phi->add_phi_pair_operand(val, preheader);
+    }
+    replace_successor(preheader, loop->get_header(), exit);
+    ++deleted_;
+    return true;
+}
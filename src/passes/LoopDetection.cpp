@@ -13,6 +13,8 @@
  */
 void LoopDetection::run() {
     dominators_ = std::make_unique<Dominators>(m_);
+    loops_.clear();
+    bb_to_loop_.clear();
     for (auto &f1 : m_->get_functions()) {
         auto f = &f1;
         if (f->is_declaration())
@@ -104,9 +106,11 @@ void LoopDetection::discover_loop_and_sub_loops(BasicBlock *bb, BBset &latches,
  *    - 设置循环header
  *    - 添加latch节点
  *    - 发现循环体和子循环
+ * 5. 循环体完整后，记录各循环的 preheader 与出口
  */
 void LoopDetection::run_on_func(Function *f) {
     dominators_->run_on_func(f);
+    auto first = loops_.size();
     for (auto &bb1 : dominators_->get_dom_post_order()) {
         auto bb = bb1;
         BBset latches;
@@ -130,6 +134,54 @@ void LoopDetection::run_on_func(Function *f) {
         loops_.push_back(loop);
         discover_loop_and_sub_loops(bb, latches, loop);
     }
+    for (auto i = first; i < loops_.size(); ++i) {
+        find_preheader(loops_[i]);
+        loops_[i]->compute_exits();
+    }
+}
+
+/**
+ * @brief 若 header 唯一的循环外前驱只跳向 header，把它记为 preheader
+ */
+void LoopDetection::find_preheader(std::shared_ptr<Loop> loop) {
+    BasicBlock *outside = nullptr;
+    for (auto pred : loop->get_header()->get_pre_basic_blocks()) {
+        if (loop->contains(pred))
+            continue;
+        if (outside != nullptr)
+            return;
+        outside = pred;
+    }
+    if (outside != nullptr and outside->get_succ_basic_blocks().size() == 1)
+        loop->set_preheader(outside);
+}
+
+void Loop::compute_exits() {
+    exiting_blocks_.clear();
+    exit_blocks_.clear();
+    std::unordered_set<BasicBlock *> exits;
+    for (auto bb : blocks_) {
+        bool exiting = false;
+        for (auto succ : bb->get_succ_basic_blocks()) {
+            if (contains(succ))
+                continue;
+            exiting = true;
+            if (exits.insert(succ).second)
+                exit_blocks_.push_back(succ);
+        }
+        if (exiting)
+            exiting_blocks_.push_back(bb);
+    }
+}
+
+bool Loop::is_simplified() {
+    if (preheader_ == nullptr or latches_.size() != 1)
+        return false;
+    for (auto exit : exit_blocks_)
+        for (auto pred : exit->get_pre_basic_blocks())
+            if (not contains(pred))
+                return false;
+    return true;
 }
 
 /**
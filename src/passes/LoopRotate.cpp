@@ -0,0 +1,228 @@
+#include "LoopRotate.hpp"
+#include "CFGUtil.hpp"
+#include "CloneUtil.hpp"
+#include "Constant.hpp"
+#include "LoopSimplify.hpp"
+#include "logging.hpp"
+
+#include <map>
+#include <vector>
+
+namespace {
+// 复制到 preheader 的 header 指令数上限
+constexpr int ROTATE_HEADER_LIMIT = 16;
+} // namespace
+
+void LoopRotate::run() {
+    LoopSimplify(m_).run();
+    loop_detection_ = std::make_unique<LoopDetection>(m_);
+    loop_detection_->run();
+    dominators_ = std::make_unique<Dominators>(m_);
+    for (auto &loop : loop_detection_->get_loops()) {
+        loop->compute_exits();
+        if (not can_rotate(loop))
+            continue;
+        // 前面的旋转会改变控制流，每次重新计算支配关系
+        dominators_->run_on_func(loop->get_header()->get_parent());
+        if (collect_uses(loop))
+            rotate(loop);
+    }
+    // 守卫使 preheader 有两个后继，出口块多了来自 preheader 的入边
+    LoopSimplify(m_).run();
+    LOG_INFO << "loop rotate rotated " << rotated_ << " loops";
+}
+
+/**
+ * @brief 判断循环是否为可以旋转的 while 形式
+ *
+ * header 以条件跳转结束，一个目标 B 在循环内，另一个目标 E 在循环外，
+ * 两者都只有 header 一个前驱，且 B 中没有 phi；latch 只无条件跳回 header。
+ * 此外要求 header 的 phi 来自 latch 的值不在 header 中定义，
+ * 否则合并后这些 phi 无法直接替换为入边值。
+ */
+bool LoopRotate::can_rotate(std::shared_ptr<Loop> loop) {
+    auto header = loop->get_header();
+    auto preheader = loop->get_preheader();
+    auto latch = loop->get_latch();
+    if (preheader == nullptr or latch == nullptr or latch == header)
+        return false;
+    if (preheader->get_succ_basic_blocks().size() != 1)
+        return false;
+    auto &exiting = loop->get_exiting_blocks();
+    if (std::find(exiting.begin(), exiting.end(), header) == exiting.end())
+        return false;
+    if (latch->get_succ_basic_blocks().size() != 1)
+        return false;
+
+    auto br = dynamic_cast<BranchInst *>(header->get_terminator());
+    if (br == nullptr or not br->is_cond_br())
+        return false;
+    auto body = static_cast<BasicBlock *>(br->get_operand(1));
+    auto exit = static_cast<BasicBlock *>(br->get_operand(2));
+    if (not loop->contains(body))
+        std::swap(body, exit);
+    if (body == header or not loop->contains(body) or loop->contains(exit))
+        return false;
+    if (body->get_pre_basic_blocks().size() != 1 or
+        exit->get_pre_basic_blocks().size() != 1)
+        return false;
+    if (not body->empty() and body->get_instructions().front().is_phi())
+        return false;
+
+    int size = 0;
+    for (auto &inst : header->get_instructions()) {
+        if (inst.is_phi()) {
+            auto phi = static_cast<PhiInst *>(&inst);
+            for (auto [val, bb] : phi->get_phi_pairs()) {
+                auto def = dynamic_cast<Instruction *>(val);
+                if (bb == latch and def and def->get_parent() == header)
+                    return false;
+            }
+        } else if (++size > ROTATE_HEADER_LIMIT) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief 确定 header 中定义的值的每个使用在旋转后改用哪个 phi
+ * @return 存在无法处理的使用时返回 false
+ *
+ * 旋转后 B 支配整个循环体，E 的前驱是 preheader 与 header：
+ *   - 循环内的使用，以及只能经由其他出口到达的循环外使用，改用 B 中的 phi
+ *   - 被 E 支配的循环外使用改用 E 中的 phi
+ * phi 的使用按对应入边的前驱块判断。E 中原有的 phi 另行补上入边。
+ * 既可能经由 E 又可能经由其他出口到达的使用需要更多的 phi，不做旋转。
+ */
+bool LoopRotate::collect_uses(std::shared_ptr<Loop> loop) {
+    auto header = loop->get_header();
+    auto br = static_cast<BranchInst *>(header->get_terminator());
+    auto body = static_cast<BasicBlock *>(br->get_operand(1));
+    auto exit = static_cast<BasicBlock *>(br->get_operand(2));
+    if (not loop->contains(body))
+        std::swap(body, exit);
+
+    uses_.clear();
+    for (auto &inst : header->get_instructions()) {
+        std::vector<HeaderUse> uses;
+        for (auto &use : inst.get_use_list()) {
+            auto user = static_cast<Instruction *>(use.val_);
+            auto bb = user->get_parent();
+            if (user->is_phi()) {
+                if (bb == exit)
+                    continue;
+                bb = static_cast<BasicBlock *>(
+                    user->get_operand(use.arg_no_ + 1));
+            }
+            if (bb == header)
+                continue;
+            BasicBlock *target = nullptr;
+            if (loop->contains(bb)) {
+                target = body;
+            } else if (dominators_->is_dominate(exit, bb)) {
+                target = exit;
+            } else {
+                for (auto other : loop->get_exit_blocks())
+                    if (other != exit and dominators_->is_dominate(other, bb))
+                        target = body;
+            }
+            if (target == nullptr)
+                return false;
+            uses.push_back({user, use.arg_no_, target});
+        }
+        if (not uses.empty())
+            uses_.push_back({&inst, uses});
+    }
+    return true;
+}
+
+/**
+ * @brief 旋转循环
+ *
+ * 1. 把 header 的指令以 phi 的初值复制到 preheader，作为入口守卫
+ * 2. 按 collect_uses 的结果在 B 或 E 中为 header 的值插入 phi，
+ *    入边分别来自 preheader 的副本与 header
+ * 3. header 只剩 latch 一个前驱，把它合并进 latch
+ */
+void LoopRotate::rotate(std::shared_ptr<Loop> loop) {
+    auto header = loop->get_header();
+    auto preheader = loop->get_preheader();
+    auto br = static_cast<BranchInst *>(header->get_terminator());
+    auto body = static_cast<BasicBlock *>(br->get_operand(1));
+    auto exit = static_cast<BasicBlock *>(br->get_operand(2));
+    if (not loop->contains(body))
+        std::swap(body, exit);
+
+    // header 的 phi 在守卫中取来自 preheader 的值；
+    // 省略了 preheader 入边的 phi 在该边上未定义，取 0
+    ValueMap vmap;
+    std::vector<Instruction *> header_insts;
+    for (auto &inst : header->get_instructions()) {
+        if (&inst == br)
+            break;
+        if (inst.is_phi()) {
+            vmap[&inst] = inst.get_type()->is_float_type()
+                              ? static_cast<Value *>(ConstantFP::get(0.0f, m_))
+                              : ConstantInt::get(0, m_);
+            for (auto [val, bb] : static_cast<PhiInst *>(&inst)->get_phi_pairs())
+                if (bb == preheader)
+                    vmap[&inst] = val;
+        }
+        header_insts.push_back(&inst);
+    }
+
+    // 守卫：header 的副本
+    preheader->erase_instr(preheader->get_terminator());
+    for (auto inst : header_insts)
+        if (not inst->is_phi())
+            vmap[inst] = clone_instruction(inst, preheader, vmap);
+    auto cond = map_value(vmap, br->get_operand(0));
+    BranchInst *guard;
+    if (br->get_operand(1) == body)
+        guard = BranchInst::create_cond_br(cond, body, exit, preheader);
+    else
+        guard = BranchInst::create_cond_br(cond, exit, body, preheader);
+    // 没有单独的计数，守卫沿用 header 的分支权重
+    if (br->has_branch_weights()) {
+        auto [t, f] = br->get_branch_weights();
+        guard->set_branch_weights(t, f);
+    }
+
+    std::vector<PhiInst *> exit_phis;
+    for (auto &inst : exit->get_instructions()) {
+        if (not inst.is_phi())
+            break;
+        exit_phis.push_back(static_cast<PhiInst *>(&inst));
+    }
+    for (auto phi : exit_phis)
+        for (auto [val, bb] : phi->get_phi_pairs())
+            if (bb == header) {
+                phi->add_phi_pair_operand(map_value(vmap, val), preheader);
+                break;
+            }
+
+    // 修正 header 中定义的值在循环体与循环后的使用
+    for (auto &[inst, uses] : uses_) {
+        auto init = map_value(vmap, inst);
+        std::map<BasicBlock *, PhiInst *> phis;
+        for (auto [user, arg_no, bb] : uses) {
+            auto &phi = phis[bb];
+            if (phi == nullptr) {
+                phi = PhiInst::create_phi(inst->get_type(), bb, {init, inst},
+                                          {preheader, header});
+                bb->add_instr_begin(phi);
+            }
+            user->set_operand(arg_no, phi);
+        }
+    }
+
+    // preheader 不再跳向 header，header 只剩来自 latch 的入边
+    for (auto inst : header_insts)
+        if (inst->is_phi())
+            static_cast<PhiInst *>(inst)->remove_phi_operand(preheader);
+    for (auto l = loop; l != nullptr; l = l->get_parent())
+        l->remove_block(header);
+    merge_into_predecessor(header);
+    ++rotated_;
+}
@@ -0,0 +1,103 @@
+#include "LoopSimplify.hpp"
+#include "CFGUtil.hpp"
+#include "Function.hpp"
+#include "logging.hpp"
+
+void LoopSimplify::run() {
+    loop_detection_ = std::make_unique<LoopDetection>(m_);
+    loop_detection_->run();
+    // 循环按支配树后序排列，内层循环在前
+    for (auto &loop : loop_detection_->get_loops())
+        simplify_loop(loop);
+    LOG_INFO << "loop simplify inserted " << inserted_ << " blocks";
+}
+
+void LoopSimplify::simplify_loop(std::shared_ptr<Loop> loop) {
+    if (loop->get_preheader() == nullptr)
+        insert_preheader(loop);
+    if (loop->get_latches().size() > 1)
+        merge_latches(loop);
+    form_dedicated_exits(loop);
+    loop->compute_exits();
+}
+
+/**
+ * @brief 把 header 的循环外入边汇合到新建的 preheader
+ *
+ * header 是函数入口时没有循环外前驱，新块成为函数的入口。
+ * 外层循环包含 header，因此也包含 preheader。
+ */
+void LoopSimplify::insert_preheader(std::shared_ptr<Loop> loop) {
+    auto header = loop->get_header();
+    std::vector<BasicBlock *> outside_preds;
+    for (auto pred : header->get_pre_basic_blocks())
+        if (not loop->contains(pred))
+            outside_preds.push_back(pred);
+
+    BasicBlock *preheader;
+    if (outside_preds.empty()) {
+        auto f = header->get_parent();
+        preheader = BasicBlock::create(m_, "", f);
+        f->get_basic_blocks().remove(preheader);
+        f->get_basic_blocks().push_front(preheader);
+        BranchInst::create_br(header, preheader);
+    } else {
+        preheader = split_predecessors(header, outside_preds);
+    }
+    ++inserted_;
+    loop->set_preheader(preheader);
+    for (auto parent = loop->get_parent(); parent != nullptr;
+         parent = parent->get_parent())
+        parent->add_block(preheader);
+}
+
+// 所有回边先跳到新的 latch，再由它跳回 header
+void LoopSimplify::merge_latches(std::shared_ptr<Loop> loop) {
+    std::vector<BasicBlock *> latches(loop->get_latches().begin(),
+                                      loop->get_latches().end());
+    auto latch = split_predecessors(loop->get_header(), latches);
+    ++inserted_;
+    for (auto bb : latches)
+        loop->remove_latch(bb);
+    loop->add_latch(latch);
+    for (auto l = loop; l != nullptr; l = l->get_parent())
+        l->add_block(latch);
+}
+
+/**
+ * @brief 保证每个出口块的前驱都在循环内
+ *
+ * 出口块还有循环外的前驱时，把来自循环内的边汇合到新块。
+ * 新块属于包含原出口块的各层外层循环；原出口块是外层循环的 header 时，
+ * 新块取代原来的 exiting 块成为外层循环的 latch。
+ */
+void LoopSimplify::form_dedicated_exits(std::shared_ptr<Loop> loop) {
+    loop->compute_exits();
+    auto exits = loop->get_exit_blocks();
+    for (auto exit : exits) {
+        std::vector<BasicBlock *> inside_preds;
+        bool dedicated = true;
+        for (auto pred : exit->get_pre_basic_blocks()) {
+            if (loop->contains(pred))
+                inside_preds.push_back(pred);
+            else
+                dedicated = false;
+        }
+        if (dedicated)
+            continue;
+
+        auto new_exit = split_predecessors(exit, inside_preds);
+        ++inserted_;
+        for (auto parent = loop->get_parent(); parent != nullptr;
+             parent = parent->get_parent()) {
+            if (not parent->contains(exit))
+                continue;
+            parent->add_block(new_exit);
+            if (parent->get_header() == exit) {
+                for (auto pred : inside_preds)
+                    parent->remove_latch(pred);
+                parent->add_latch(new_exit);
+            }
+        }
+    }
+}
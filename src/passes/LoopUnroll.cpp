@@ -0,0 +1,385 @@
+#include "LoopUnroll.hpp"
+#include "CFGUtil.hpp"
+#include "Constant.hpp"
+#include "Function.hpp"
+#include "LoopSimplify.hpp"
+#include "logging.hpp"
+
+#include <algorithm>
+#include <map>
+
+namespace {
+// 完全展开：迭代次数与展开后循环体指令数的上限
+constexpr long FULL_UNROLL_MAX_TRIP = 32;
+constexpr long FULL_UNROLL_SIZE = 256;
+// 部分展开后主循环体指令数的上限
+constexpr long PARTIAL_UNROLL_SIZE = 160;
+} // namespace
+
+void LoopUnroll::run() {
+    LoopSimplify(m_).run();
+    scev_->run();
+    for (auto &loop : scev_->get_loop_detection().get_loops()) {
+        if (not loop->get_sub_loops().empty() or not can_unroll(loop))
+            continue;
+        long size = 0;
+        for (auto bb : blocks_)
+            size += bb->get_num_of_instr();
+
+        auto trip_count = scev_->get_constant_trip_count(loop);
+        if (trip_count > 0 and trip_count <= FULL_UNROLL_MAX_TRIP and
+            trip_count * size <= FULL_UNROLL_SIZE) {
+            fully_unroll(loop, trip_count);
+            merge_chained_blocks();
+            ++full_;
+            continue;
+        }
+        auto factor = factor_;
+        while (factor >= 2 and factor * size > PARTIAL_UNROLL_SIZE)
+            factor /= 2;
+        // profile 中从未执行的循环不展开，平均迭代次数不足 factor 时减小 factor。
+        // 权重来自旋转前 header 的判断，back / exit 即每次进入循环的迭代次数
+        auto br = static_cast<BranchInst *>(loop->get_latch()->get_terminator());
+        if (br->has_branch_weights()) {
+            auto [back, exit] = br->get_branch_weights();
+            if (br->get_operand(1) != loop->get_header())
+                std::swap(back, exit);
+            if (back + exit == 0)
+                continue;
+            if (exit > 0)
+                while (factor >= 2 and factor > back / exit)
+                    factor /= 2;
+        }
+        if (factor < 2 or (trip_count > 0 and trip_count < factor))
+            continue;
+        if (partially_unroll(loop, factor)) {
+            merge_chained_blocks();
+            ++partial_;
+        }
+    }
+    LOG_INFO << "loop unroll fully unrolled " << full_ << " loops, partially "
+             << partial_ << " loops";
+}
+
+/**
+ * @brief 检查循环的形状，并收集展开需要的信息
+ *
+ * 要求循环有 preheader，决定循环次数的 exiting 块是 latch，
+ * 且除 exceptBB 之外只有一个出口块。exceptBB 没有 phi，也不使用循环中的值，
+ * 随循环体一同复制。
+ */
+bool LoopUnroll::can_unroll(std::shared_ptr<Loop> loop) {
+    auto latch = loop->get_latch();
+    if (loop->get_preheader() == nullptr or latch == nullptr or
+        scev_->get_exiting_block(loop) != latch)
+        return false;
+    exit_ = nullptr;
+    except_blocks_.clear();
+    for (auto bb : loop->get_exit_blocks()) {
+        if (bb->is_except_block()) {
+            except_blocks_.push_back(bb);
+            continue;
+        }
+        if (exit_ != nullptr)
+            return false;
+        exit_ = bb;
+    }
+    if (exit_ == nullptr)
+        return false;
+
+    auto f = loop->get_header()->get_parent();
+    blocks_.clear();
+    for (auto &bb : f->get_basic_blocks())
+        if (loop->contains(&bb))
+            blocks_.push_back(&bb);
+    phis_.clear();
+    for (auto &inst : loop->get_header()->get_instructions()) {
+        if (not inst.is_phi())
+            break;
+        phis_.push_back(static_cast<PhiInst *>(&inst));
+    }
+    live_out_uses_.clear();
+    for (auto bb : blocks_)
+        for (auto &inst : bb->get_instructions())
+            for (auto &use : inst.get_use_list()) {
+                auto user = static_cast<Instruction *>(use.val_);
+                if (not loop->contains(user->get_parent()))
+                    live_out_uses_.push_back({&inst, user, use.arg_no_});
+            }
+    return true;
+}
+
+Value *LoopUnroll::latch_value(std::shared_ptr<Loop> loop, PhiInst *phi) {
+    for (auto [val, bb] : phi->get_phi_pairs())
+        if (bb == loop->get_latch())
+            return val;
+    return nullptr;
+}
+
+/**
+ * @brief 把循环体复制为 count 份首尾相接
+ * @param keep_original 第 0 份是否直接使用原循环体
+ * @return 每一份的映射
+ *
+ * 每一份带有自己的 exceptBB 副本。
+ * 第 i 份 (i > 0) header 的 phi 替换为第 i - 1 份从 latch 传来的值，
+ * 前 count - 1 份的 latch 无条件跳到下一份的 header。
+ * 第 0 份 header 的 phi 与最后一份 latch 的跳转由调用者处理。
+ */
+std::vector<ValueMap>
+LoopUnroll::clone_iterations(std::shared_ptr<Loop> loop, unsigned count,
+                             bool keep_original) {
+    auto f = loop->get_header()->get_parent();
+    auto blocks = blocks_;
+    blocks.insert(blocks.end(), except_blocks_.begin(), except_blocks_.end());
+    std::vector<ValueMap> maps;
+    chained_.clear();
+    for (unsigned i = 0; i < count; ++i) {
+        ValueMap vmap;
+        if (i > 0 or not keep_original)
+            clone_blocks(blocks, f, vmap);
+        if (i > 0) {
+            for (auto phi : phis_) {
+                auto copy = static_cast<PhiInst *>(vmap[phi]);
+                auto val = map_value(maps[i - 1], latch_value(loop, phi));
+                copy->replace_all_use_with(val);
+                copy->get_parent()->erase_instr(copy);
+                vmap[phi] = val;
+            }
+        }
+        maps.push_back(std::move(vmap));
+    }
+    for (unsigned i = 0; i + 1 < count; ++i) {
+        auto latch =
+            static_cast<BasicBlock *>(map_value(maps[i], loop->get_latch()));
+        auto next =
+            static_cast<BasicBlock *>(map_value(maps[i + 1], loop->get_header()));
+        latch->erase_instr(latch->get_terminator());
+        BranchInst::create_br(next, latch);
+        chained_.push_back(next);
+    }
+    return maps;
+}
+
+/**
+ * @brief 把首尾相接的各份循环体合并为直线代码
+ *
+ * 调用者改写最后一份 latch 的跳转之后，chained_ 中的 header
+ * 只剩上一份 latch 这一个前驱，且没有 phi。
+ */
+void LoopUnroll::merge_chained_blocks() {
+    for (auto bb : chained_) {
+        auto &preds = bb->get_pre_basic_blocks();
+        if (preds.size() == 1 and
+            preds.front()->get_succ_basic_blocks().size() == 1)
+            merge_into_predecessor(bb);
+    }
+    chained_.clear();
+}
+
+/**
+ * @brief 完全展开
+ *
+ * 原循环体作为第 0 份，最后一份的 latch 直接跳到出口块；
+ * header 的 phi 只剩来自 preheader 的初值。
+ */
+void LoopUnroll::fully_unroll(std::shared_ptr<Loop> loop, unsigned trip_count) {
+    auto header = loop->get_header();
+    auto latch = loop->get_latch();
+    auto exit = exit_;
+    auto maps = clone_iterations(loop, trip_count, true);
+    auto &last = maps.back();
+
+    auto last_latch = static_cast<BasicBlock *>(map_value(last, latch));
+    last_latch->erase_instr(last_latch->get_terminator());
+    BranchInst::create_br(exit, last_latch);
+
+    for (auto [val, user, arg_no] : live_out_uses_)
+        user->set_operand(arg_no, map_value(last, val));
+    for (auto &inst : exit->get_instructions()) {
+        if (not inst.is_phi())
+            break;
+        for (unsigned i = 1; i < inst.get_num_operand(); i += 2)
+            if (inst.get_operand(i) == latch)
+                inst.set_operand(i, last_latch);
+    }
+    for (auto phi : phis_) {
+        phi->remove_phi_operand(latch);
+        phi->replace_all_use_with(phi->get_operand(0));
+        header->erase_instr(phi);
+    }
+}
+
+/**
+ * @brief 部分展开，原循环作为余数循环
+ *
+ *   preheader: tc = 回边次数 + 1; rem = tc & (factor - 1); main = tc - rem
+ *              br main > 0 ? main_ph : rem_check
+ *   主循环:    factor 份循环体，计数器从 main 每次减 factor，到 0 时退出
+ *   rem_check: 以主循环的结果（或初值）作为原循环的初值
+ *              br rem != 0 ? rem_ph : exit
+ * 从 rem_check 直接到达出口块时，循环之后的使用取主循环最后一份的值，
+ * 出口块中插入 phi 合并两条路径。
+ */
+bool LoopUnroll::partially_unroll(std::shared_ptr<Loop> loop,
+                                  unsigned factor) {
+    auto zero_of = [&](Type *type) -> Value * {
+        if (type->is_int32_type())
+            return ConstantInt::get(0, m_);
+        if (type->is_int1_type())
+            return ConstantInt::get(false, m_);
+        if (type->is_float_type())
+            return ConstantFP::get(0.0f, m_);
+        return nullptr;
+    };
+    for (auto &use : live_out_uses_)
+        if (zero_of(use.val->get_type()) == nullptr)
+            return false;
+
+    ScalarEvolution::Expr backedge_taken;
+    scev_->get_backedge_taken_count(loop, backedge_taken);
+    auto preheader = loop->get_preheader();
+    auto header = loop->get_header();
+    auto latch = loop->get_latch();
+    auto exit = exit_;
+    auto f = header->get_parent();
+    auto i32 = m_->get_int32_type();
+
+    auto maps = clone_iterations(loop, factor, false);
+    auto &first = maps.front();
+    auto &last = maps.back();
+    auto main_header = static_cast<BasicBlock *>(first[header]);
+    auto main_latch = static_cast<BasicBlock *>(last[latch]);
+    auto main_ph = BasicBlock::create(m_, "", f);
+    auto main_exit = BasicBlock::create(m_, "", f);
+    auto rem_check = BasicBlock::create(m_, "", f);
+    auto rem_ph = BasicBlock::create(m_, "", f);
+
+    // preheader 中计算主循环与余数循环的迭代次数
+    preheader->erase_instr(preheader->get_terminator());
+    auto placeholder = BranchInst::create_br(main_ph, preheader);
+    Value *main_count, *rem;
+    bool may_skip_rem = true;
+    if (backedge_taken.is_constant()) {
+        auto trip_count = backedge_taken.constant + 1;
+        rem = ConstantInt::get(static_cast<int>(trip_count % factor), m_);
+        main_count = ConstantInt::get(
+            static_cast<int>(trip_count - trip_count % factor), m_);
+        may_skip_rem = trip_count % factor == 0;
+    } else {
+        auto trip_count =
+            scev_->expand(backedge_taken + ScalarEvolution::Expr(1), placeholder);
+        rem = preheader->create_instr_before(placeholder, [&](BasicBlock *bb) {
+            return IBinaryInst::create_and(
+                trip_count, ConstantInt::get(static_cast<int>(factor - 1), m_), bb);
+        });
+        main_count =
+            preheader->create_instr_before(placeholder, [&](BasicBlock *bb) {
+                return IBinaryInst::create_sub(trip_count, rem, bb);
+            });
+        auto has_main =
+            preheader->create_instr_before(placeholder, [&](BasicBlock *bb) {
+                return ICmpInst::create_gt(main_count, ConstantInt::get(0, m_),
+                                           bb);
+            });
+        preheader->erase_instr(placeholder);
+        BranchInst::create_cond_br(has_main, main_ph, rem_check, preheader);
+    }
+    bool from_preheader = not backedge_taken.is_constant();
+
+    // 主循环
+    BranchInst::create_br(main_header, main_ph);
+    for (auto phi : phis_) {
+        auto copy = static_cast<PhiInst *>(first[phi]);
+        for (unsigned i = 0; i < copy->get_num_operand(); i += 2) {
+            if (copy->get_operand(i + 1) == preheader) {
+                copy->set_operand(i + 1, main_ph);
+            } else {
+                copy->set_operand(i, map_value(last, latch_value(loop, phi)));
+                copy->set_operand(i + 1, main_latch);
+            }
+        }
+    }
+    auto counter = PhiInst::create_phi(i32, main_header, {main_count}, {main_ph});
+    main_header->add_instr_begin(counter);
+    main_latch->erase_instr(main_latch->get_terminator());
+    auto next = IBinaryInst::create_sub(
+        counter, ConstantInt::get(static_cast<int>(factor), m_), main_latch);
+    counter->add_phi_pair_operand(next, main_latch);
+    auto again = ICmpInst::create_gt(next, ConstantInt::get(0, m_), main_latch);
+    BranchInst::create_cond_br(again, main_header, main_exit, main_latch);
+    BranchInst::create_br(rem_check, main_exit);
+
+    // 余数循环的初值，以及跳过余数循环时循环之后使用的值
+    std::map<Value *, PhiInst *> rem_values;
+    auto merge = [&](Value *init, Value *from_main) {
+        std::vector<Value *> vals;
+        std::vector<BasicBlock *> bbs;
+        if (from_preheader) {
+            vals.push_back(init);
+            bbs.push_back(preheader);
+        }
+        vals.push_back(from_main);
+        bbs.push_back(main_exit);
+        auto phi = PhiInst::create_phi(from_main->get_type(), rem_check, vals,
+                                       bbs);
+        rem_check->add_instr_begin(phi);
+        return phi;
+    };
+    for (auto phi : phis_) {
+        Value *init = nullptr;
+        for (auto [val, bb] : phi->get_phi_pairs())
+            if (bb == preheader)
+                init = val;
+        auto rem_init = merge(init, map_value(last, latch_value(loop, phi)));
+        for (unsigned i = 1; i < phi->get_num_operand(); i += 2)
+            if (phi->get_operand(i) == preheader) {
+                phi->set_operand(i - 1, rem_init);
+                phi->set_operand(i, rem_ph);
+            }
+    }
+    if (may_skip_rem)
+        for (auto &use : live_out_uses_)
+            if (rem_values.count(use.val) == 0)
+                rem_values[use.val] = merge(zero_of(use.val->get_type()),
+                                            map_value(last, use.val));
+
+    if (backedge_taken.is_constant()) {
+        BranchInst::create_br(may_skip_rem ? exit : rem_ph, rem_check);
+    } else {
+        auto has_rem = ICmpInst::create_ne(rem, ConstantInt::get(0, m_),
+                                           rem_check);
+        BranchInst::create_cond_br(has_rem, rem_ph, exit, rem_check);
+    }
+    BranchInst::create_br(header, rem_ph);
+    if (not may_skip_rem)
+        return true;
+
+    // 出口块合并余数循环与 rem_check 两条路径
+    std::map<Value *, PhiInst *> exit_values;
+    for (auto [val, user, arg_no] : live_out_uses_) {
+        if (user->is_phi() and user->get_parent() == exit)
+            continue;
+        auto &phi = exit_values[val];
+        if (phi == nullptr) {
+            phi = PhiInst::create_phi(val->get_type(), exit,
+                                      {val, rem_values[val]}, {latch, rem_check});
+            exit->add_instr_begin(phi);
+        }
+        user->set_operand(arg_no, phi);
+    }
+    for (auto &inst : exit->get_instructions()) {
+        if (not inst.is_phi())
+            break;
+        auto phi = static_cast<PhiInst *>(&inst);
+        // 跳过刚插入的 phi
+        if (std::any_of(exit_values.begin(), exit_values.end(),
+                        [&](auto &kv) { return kv.second == phi; }))
+            continue;
+        Value *val = phi->get_phi_pairs()[0].first;
+        auto it = rem_values.find(val);
+        phi->add_phi_pair_operand(it == rem_values.end() ? val : it->second,
+                                  rem_check);
+    }
+    return true;
+}
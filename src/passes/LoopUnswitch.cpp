@@ -0,0 +1,113 @@
+#include "LoopUnswitch.hpp"
+#include "CFGUtil.hpp"
+#include "Constant.hpp"
+#include "Function.hpp"
+#include "LoopSimplify.hpp"
+#include "logging.hpp"
+
+#include <unordered_set>
+
+namespace {
+// 被复制的循环的指令数上限
+constexpr unsigned UNSWITCH_MAX_SIZE = 200;
+// 每个函数因反转而复制的指令总数上限
+constexpr unsigned UNSWITCH_FUNC_BUDGET = 800;
+} // namespace
+
+void LoopUnswitch::run() {
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        LoopSimplify(m_).run();
+        LoopDetection loop_detection(m_);
+        loop_detection.run();
+        // 本轮已修改的函数，其中的循环信息已失效
+        std::unordered_set<Function *> modified;
+        auto &loops = loop_detection.get_loops();
+        // 同一函数中内层循环在前，逆序遍历使外层循环先被处理
+        for (auto it = loops.rbegin(); it != loops.rend(); ++it) {
+            auto loop = *it;
+            auto f = loop->get_header()->get_parent();
+            if (modified.count(f) or not loop->is_simplified())
+                continue;
+            if (unswitch_loop(loop)) {
+                modified.insert(f);
+                changed = true;
+            }
+        }
+        for (auto f : modified)
+            remove_unreachable_blocks(f);
+    }
+    LOG_INFO << "loop unswitch unswitched " << unswitched_ << " branches";
+}
+
+// 循环中条件不变、两个目标不同的条件跳转，没有时返回 nullptr
+BranchInst *LoopUnswitch::find_invariant_branch(std::shared_ptr<Loop> loop) {
+    for (auto bb : loop->get_blocks()) {
+        auto br = dynamic_cast<BranchInst *>(bb->get_terminator());
+        if (br == nullptr or not br->is_cond_br() or
+            br->get_operand(1) == br->get_operand(2))
+            continue;
+        auto cond = br->get_operand(0);
+        // 常量条件留给 SCCP
+        if (dynamic_cast<Constant *>(cond))
+            continue;
+        auto def = dynamic_cast<Instruction *>(cond);
+        if (def and loop->contains(def->get_parent()))
+            continue;
+        return br;
+    }
+    return nullptr;
+}
+
+/**
+ * @brief 对 loop 中的一个不变条件进行反转
+ * @return 是否修改了函数
+ */
+bool LoopUnswitch::unswitch_loop(std::shared_ptr<Loop> loop) {
+    auto br = find_invariant_branch(loop);
+    if (br == nullptr)
+        return false;
+    unsigned size = 0;
+    for (auto bb : loop->get_blocks())
+        size += bb->get_num_of_instr();
+    auto f = loop->get_header()->get_parent();
+    if (size > UNSWITCH_MAX_SIZE or
+        cloned_size_[f] + size > UNSWITCH_FUNC_BUDGET)
+        return false;
+    versioning_->prepare_function(f);
+    if (not versioning_->can_version(loop))
+        return false;
+
+    auto bb = br->get_parent();
+    auto true_bb = br->get_operand(1)->as<BasicBlock>();
+    auto false_bb = br->get_operand(2)->as<BasicBlock>();
+    bool has_weights = br->has_branch_weights();
+    auto weights = br->get_branch_weights();
+    auto vmap = versioning_->version_loop(loop, br->get_operand(0));
+    // preheader 中的选择与原跳转的走向相同
+    if (has_weights)
+        static_cast<BranchInst *>(loop->get_preheader()->get_terminator())
+            ->set_branch_weights(weights.first, weights.second);
+    fold_branch(bb, true_bb);
+    fold_branch(vmap.at(bb)->as<BasicBlock>(),
+                map_value(vmap, false_bb)->as<BasicBlock>());
+    cloned_size_[f] += size;
+    ++unswitched_;
+    return true;
+}
+
+// 把 bb 的条件跳转改为只跳向 taken，另一个后继删去来自 bb 的 phi 入边
+void LoopUnswitch::fold_branch(BasicBlock *bb, BasicBlock *taken) {
+    auto br = bb->get_terminator();
+    auto not_taken = br->get_operand(1) == taken
+                         ? br->get_operand(2)->as<BasicBlock>()
+                         : br->get_operand(1)->as<BasicBlock>();
+    bb->erase_instr(br);
+    BranchInst::create_br(taken, bb);
+    for (auto &inst : not_taken->get_instructions()) {
+        if (not inst.is_phi())
+            break;
+        static_cast<PhiInst *>(&inst)->remove_phi_operand(bb);
+    }
+}
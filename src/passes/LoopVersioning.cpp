@@ -0,0 +1,248 @@
+#include "LoopVersioning.hpp"
+#include "Constant.hpp"
+#include "Function.hpp"
+#include "LoopSimplify.hpp"
+#include "PatternMatch.hpp"
+#include "logging.hpp"
+
+#include <algorithm>
+#include <climits>
+#include <unordered_set>
+
+using namespace PatternMatch;
+
+namespace {
+// 复制的循环体指令数的上限
+constexpr unsigned VERSIONING_MAX_SIZE = 200;
+} // namespace
+
+void LoopVersioning::run() {
+    LoopSimplify(m_).run();
+    scev_->run();
+    for (auto &loop : scev_->get_loop_detection().get_loops()) {
+        if (not loop->get_sub_loops().empty() or not loop->is_simplified())
+            continue;
+        // 前一个循环的变换可能改变了 CFG
+        prepare_function(loop->get_header()->get_parent());
+        version_checks(loop);
+    }
+    LOG_INFO << "loop versioning versioned " << versioned_
+             << " loops, removed " << removed_ << " checks";
+}
+
+/**
+ * @brief 把 “第 0 次迭代的下标 init ∈ [0, INT_MAX] 且最后一次迭代的下标
+ *        last <= INT_MAX” 化为一组运行时须非负的表达式
+ * @return 无法这样表示，或静态已知不成立时返回 false
+ *
+ * Expr 按精确的整数计算，运行时按 i32 回绕，只处理 常量 与 单个值 + 常量
+ * 的形式，使运行时的判断与精确的值一致：
+ *   - init = v + c：c >= 0 时 v + c 不回绕为负即在范围内；c < 0 时还要求
+ *     v 非负，于是 v + c 不会越过 INT_MIN 回绕为正
+ *   - last = v + c：c <= 0 时总成立；否则要求 v + c 不越过 INT_MAX 回绕为负
+ * 常量直接判断，不生成条件。
+ */
+bool LoopVersioning::get_conditions(const ScalarEvolution::Expr &init,
+                                    const ScalarEvolution::Expr &last,
+                                    std::vector<ScalarEvolution::Expr> &conds) {
+    auto is_simple = [](const ScalarEvolution::Expr &e) {
+        if (e.constant < INT_MIN or e.constant > INT_MAX)
+            return false;
+        return e.is_constant() or
+               (e.terms.size() == 1 and e.terms.begin()->second == 1);
+    };
+    if (not is_simple(init) or not is_simple(last))
+        return false;
+    auto add = [&](const ScalarEvolution::Expr &e) {
+        if (std::find(conds.begin(), conds.end(), e) == conds.end())
+            conds.push_back(e);
+    };
+    if (init.is_constant()) {
+        if (init.constant < 0)
+            return false;
+    } else {
+        add(init);
+        if (init.constant < 0)
+            add(init - ScalarEvolution::Expr(init.constant));
+    }
+    if (last.constant > 0) {
+        if (last.is_constant())
+            return false;
+        add(last);
+    }
+    return true;
+}
+
+/**
+ * @brief 找出循环中下标单调不减的检查，删去或为它们建立无检查的版本
+ * @return 是否修改了函数
+ *
+ * 下标 {init,+,stride} 在各次迭代中不越过 INT_MAX 回绕时，最小值是 init、
+ * 最大值是最后一次迭代的 last（回边执行次数为 max(0, count)，count 为负时
+ * last 小于 init）。stride 不为 0 时需要 ScalarEvolution 求出 count。
+ */
+bool LoopVersioning::version_checks(std::shared_ptr<Loop> loop) {
+    bool changed = false;
+    std::vector<BasicBlock *> checks; // 以检查结束的块
+    std::vector<ScalarEvolution::Expr> conds;
+    unsigned size = 0;
+    ScalarEvolution::Expr count;
+    bool has_count = scev_->get_clamped_backedge_taken_count(loop, count);
+    for (auto bb : loop->get_blocks()) {
+        size += bb->get_num_of_instr();
+        auto br = dynamic_cast<BranchInst *>(bb->get_terminator());
+        if (br == nullptr or not br->is_cond_br())
+            continue;
+        Value *idx;
+        Instruction::OpID pred;
+        if (not match(br->get_operand(0), m_ICmp(pred, m_Value(idx), m_Zero())) or
+            pred != Instruction::lt)
+            continue;
+        auto except = static_cast<BasicBlock *>(br->get_operand(1));
+        if (loop->contains(except) or not except->is_except_block())
+            continue;
+
+        ScalarEvolution::Expr expr, init, next;
+        if (not scev_->get_expr(idx, loop, expr) or
+            not scev_->evaluate_at(expr, loop, ScalarEvolution::Expr(0), init) or
+            not scev_->evaluate_at(expr, loop, ScalarEvolution::Expr(1), next))
+            continue;
+        auto stride = next - init;
+        if (not stride.is_constant() or stride.constant < 0)
+            continue;
+        auto last = init;
+        if (stride.constant != 0 and
+            (not has_count or not scev_->evaluate_at(expr, loop, count, last)))
+            continue;
+        std::vector<ScalarEvolution::Expr> check_conds;
+        if (not get_conditions(init, last, check_conds))
+            continue;
+        if (check_conds.empty()) {
+            // 各次迭代的下标已知在 [0, INT_MAX] 之中，检查总是通过
+            remove_check(bb);
+            changed = true;
+            continue;
+        }
+        checks.push_back(bb);
+        for (auto &cond : check_conds)
+            if (std::find(conds.begin(), conds.end(), cond) == conds.end())
+                conds.push_back(cond);
+    }
+    if (checks.empty() or size > VERSIONING_MAX_SIZE or not can_version(loop))
+        return changed;
+
+    // preheader 中一次性判断所有条件：它们按位或的结果非负即都非负
+    auto preheader = loop->get_preheader();
+    auto pos = preheader->get_terminator();
+    Value *acc = nullptr;
+    for (auto &cond : conds) {
+        auto val = scev_->expand(cond, pos);
+        if (acc == nullptr) {
+            acc = val;
+            continue;
+        }
+        acc = preheader->create_instr_before(pos, [&](BasicBlock *bb) {
+            return IBinaryInst::create_or(acc, val, bb);
+        });
+    }
+    auto is_neg = preheader->create_instr_before(pos, [&](BasicBlock *bb) {
+        return ICmpInst::create_lt(acc, ConstantInt::get(0, m_), bb);
+    });
+
+    auto vmap = version_loop(loop, is_neg);
+    for (auto bb : checks)
+        remove_check(static_cast<BasicBlock *>(vmap.at(bb)));
+    ++versioned_;
+    return true;
+}
+
+// 把以检查结束的块改为直接跳到访问数组的后继，exceptBB 留给 DeadCode
+void LoopVersioning::remove_check(BasicBlock *bb) {
+    auto br = bb->get_terminator();
+    auto cont = static_cast<BasicBlock *>(br->get_operand(2));
+    bb->erase_instr(br);
+    BranchInst::create_br(cont, bb);
+    ++removed_;
+}
+
+bool LoopVersioning::can_version(std::shared_ptr<Loop> loop) {
+    live_outs_.clear();
+    auto &exits = loop->get_exit_blocks();
+    for (auto bb : loop->get_blocks()) {
+        for (auto &inst : bb->get_instructions()) {
+            for (auto &use : inst.get_use_list()) {
+                auto user = static_cast<Instruction *>(use.val_);
+                auto use_bb = user->get_parent();
+                if (loop->contains(use_bb))
+                    continue;
+                if (user->is_phi()) {
+                    // phi 的使用发生在对应的前驱中；
+                    // 来自循环的入边在复制时直接补上来自副本的入边
+                    use_bb = static_cast<BasicBlock *>(
+                        user->get_operand(use.arg_no_ + 1));
+                    if (loop->contains(use_bb))
+                        continue;
+                }
+                if (not dominators_->is_reachable(use_bb))
+                    continue;
+                auto exit =
+                    std::find_if(exits.begin(), exits.end(), [&](auto exit) {
+                        return dominators_->is_dominate(exit, use_bb);
+                    });
+                if (exit == exits.end())
+                    return false;
+                auto it = std::find_if(
+                    live_outs_.begin(), live_outs_.end(), [&](auto &live_out) {
+                        return live_out.val == &inst and live_out.exit == *exit;
+                    });
+                if (it == live_outs_.end())
+                    it = live_outs_.insert(live_outs_.end(), {&inst, *exit, {}});
+                it->uses.push_back({user, use.arg_no_});
+            }
+        }
+    }
+    return true;
+}
+
+ValueMap LoopVersioning::version_loop(std::shared_ptr<Loop> loop,
+                                      Value *cond) {
+    auto header = loop->get_header();
+    auto preheader = loop->get_preheader();
+    auto f = header->get_parent();
+    BBvec blocks;
+    for (auto &bb : f->get_basic_blocks())
+        if (loop->contains(&bb))
+            blocks.push_back(&bb);
+    ValueMap vmap;
+    auto copies = clone_blocks(blocks, f, vmap);
+    std::unordered_set<BasicBlock *> copy_set(copies.begin(), copies.end());
+
+    for (auto exit : loop->get_exit_blocks()) {
+        for (auto &inst : exit->get_instructions()) {
+            if (not inst.is_phi())
+                break;
+            auto phi = static_cast<PhiInst *>(&inst);
+            for (auto [val, bb] : phi->get_phi_pairs())
+                if (loop->contains(bb))
+                    phi->add_phi_pair_operand(map_value(vmap, val), vmap.at(bb));
+        }
+    }
+    for (auto &[val, exit, uses] : live_outs_) {
+        std::vector<Value *> vals;
+        std::vector<BasicBlock *> bbs;
+        for (auto pred : exit->get_pre_basic_blocks()) {
+            vals.push_back(copy_set.count(pred) ? vmap.at(val) : val);
+            bbs.push_back(pred);
+        }
+        auto phi = PhiInst::create_phi(val->get_type(), exit, vals, bbs);
+        exit->add_instr_begin(phi);
+        for (auto [user, arg_no] : uses)
+            user->set_operand(arg_no, phi);
+    }
+    live_outs_.clear();
+
+    preheader->erase_instr(preheader->get_terminator());
+    BranchInst::create_cond_br(cond, header, vmap.at(header)->as<BasicBlock>(),
+                               preheader);
+    return vmap;
+}
@@ -116,7 +116,10 @@ void Mem2Reg::rename(BasicBlock *bb) {
     // 遍历当前基本块中的指令
     for (auto &instr : bb->get_instructions()) {
         if (instr.is_phi()) {
+            // 跳过不是由 mem2reg 插入的 phi（例如内联时合并返回值的 phi）
             auto phi = static_cast<PhiInst *>(&instr);
+            if (phi_lval.count(phi) == 0)
+                continue;
             auto l_val = phi_lval[phi];
             var_val_stack[l_val].push_back(phi);
         } else if (instr.is_store()) {
@@ -143,6 +146,8 @@ void Mem2Reg::rename(BasicBlock *bb) {
         for (auto &instr : succ_bb->get_instructions()) {
             if (instr.is_phi()) {
                 auto phi = static_cast<PhiInst *>(&instr);
+                if (phi_lval.count(phi) == 0)
+                    continue;
                 auto l_val = phi_lval[phi];
                 if (var_val_stack.count(l_val) && !var_val_stack[l_val].empty()) {
                     auto val = var_val_stack[l_val].back();
@@ -161,6 +166,8 @@ void Mem2Reg::rename(BasicBlock *bb) {
     for (auto &instr : bb->get_instructions()) {
         if (instr.is_phi()) {
             auto phi = static_cast<PhiInst *>(&instr);
+            if (phi_lval.count(phi) == 0)
+                continue;
             auto l_val = phi_lval[phi];
             var_val_stack[l_val].pop_back();
         } else if (instr.is_store()) {
@@ -0,0 +1,216 @@
+#include "PostDominators.hpp"
+#include "Function.hpp"
+
+#include <functional>
+
+/**
+ * @brief 后向支配分析的入口函数
+ *
+ * 遍历模块中的所有函数，对每个非声明的函数计算后向支配树与控制依赖。
+ */
+void PostDominators::run() {
+    for (auto &f1 : m_->get_functions()) {
+        auto f = &f1;
+        if (f->is_declaration())
+            continue;
+        run_on_func(f);
+    }
+}
+
+/**
+ * @brief 对单个函数执行后向支配分析
+ * @param f 要分析的函数
+ *
+ * 流程与 Dominators 相同，只是在反向 CFG 上进行：
+ * 1. 从虚拟出口出发，求反向 CFG 的后序
+ * 2. 迭代计算直接后向支配者(ipdom)
+ * 3. 构建后向支配树及其 DFS 序
+ * 4. 由后向支配树导出控制依赖图
+ */
+void PostDominators::run_on_func(Function *f) {
+    post_order_vec_.clear();
+    post_order_.clear();
+    ipdom_.clear();
+    pdom_tree_succ_blocks_.clear();
+    pdom_tree_L_.clear();
+    pdom_tree_R_.clear();
+    control_dep_.clear();
+    control_dep_succ_.clear();
+    for (auto &bb1 : f->get_basic_blocks()) {
+        auto bb = &bb1;
+        control_dep_[bb] = {};
+        control_dep_succ_[bb] = {};
+    }
+    create_reverse_post_order(f);
+    create_ipdom(f);
+    create_pdom_dfs_order(f);
+    create_control_dependence(f);
+}
+
+/**
+ * @brief 在反向 CFG 上做 DFS，得到后序
+ *
+ * 虚拟出口的反向后继是所有没有后继的块（即以 ret 结尾的块），
+ * 其余块的反向后继就是它在 CFG 上的前驱。
+ */
+void PostDominators::create_reverse_post_order(Function *f) {
+    std::list<BasicBlock *> exits;
+    for (auto &bb1 : f->get_basic_blocks()) {
+        if (bb1.get_succ_basic_blocks().empty())
+            exits.push_back(&bb1);
+    }
+    BBSet visited;
+    std::function<void(BasicBlock *)> dfs = [&](BasicBlock *bb) {
+        visited.insert(bb);
+        auto &rev_succs = bb ? bb->get_pre_basic_blocks() : exits;
+        for (auto succ : rev_succs) {
+            if (visited.find(succ) == visited.end())
+                dfs(succ);
+        }
+        post_order_[bb] = post_order_vec_.size();
+        post_order_vec_.push_back(bb);
+    };
+    dfs(nullptr);
+}
+
+/**
+ * @brief 求两个块在后向支配树上的最近公共祖先
+ */
+BasicBlock *PostDominators::intersect(BasicBlock *b1, BasicBlock *b2) {
+    while (b1 != b2) {
+        while (get_post_order(b1) < get_post_order(b2)) {
+            b1 = get_ipdom(b1);
+        }
+        while (get_post_order(b2) < get_post_order(b1)) {
+            b2 = get_ipdom(b2);
+        }
+    }
+    return b1;
+}
+
+/**
+ * @brief 迭代计算每个块的直接后向支配者
+ *
+ * 与 Dominators::create_idom 对称：在反向 CFG 的逆后序上迭代，
+ * 一个块在反向 CFG 上的前驱是它的 CFG 后继；ret 块额外以虚拟出口为前驱。
+ * ipdom_ 中只保存已计算出的块，因此可以用 nullptr 表示虚拟出口。
+ */
+void PostDominators::create_ipdom(Function *f) {
+    ipdom_[nullptr] = nullptr;
+
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (auto it = post_order_vec_.rbegin(); it != post_order_vec_.rend();
+             ++it) {
+            auto b = *it;
+            if (b == nullptr)
+                continue;
+
+            bool has_new_ipdom = false;
+            BasicBlock *new_ipdom = nullptr;
+            auto merge = [&](BasicBlock *p) {
+                if (ipdom_.find(p) == ipdom_.end())
+                    return;
+                if (not has_new_ipdom) {
+                    new_ipdom = p;
+                    has_new_ipdom = true;
+                } else {
+                    new_ipdom = intersect(new_ipdom, p);
+                }
+            };
+            if (b->get_succ_basic_blocks().empty())
+                merge(nullptr);
+            for (auto s : b->get_succ_basic_blocks())
+                merge(s);
+
+            auto old = ipdom_.find(b);
+            if (has_new_ipdom and
+                (old == ipdom_.end() or old->second != new_ipdom)) {
+                ipdom_[b] = new_ipdom;
+                changed = true;
+            }
+        }
+    }
+}
+
+/**
+ * @brief 为后向支配树创建 DFS 序，用于 O(1) 判断后向支配关系
+ */
+void PostDominators::create_pdom_dfs_order(Function *f) {
+    for (auto &[bb, ipdom] : ipdom_) {
+        if (bb != nullptr)
+            pdom_tree_succ_blocks_[ipdom].insert(bb);
+    }
+    unsigned int order = 0;
+    std::function<void(BasicBlock *)> dfs = [&](BasicBlock *bb) {
+        pdom_tree_L_[bb] = ++order;
+        for (auto succ : pdom_tree_succ_blocks_[bb]) {
+            dfs(succ);
+        }
+        pdom_tree_R_[bb] = order;
+    };
+    dfs(nullptr);
+}
+
+/**
+ * @brief 由后向支配树计算控制依赖
+ *
+ * 对 CFG 中每条边 A->B，若 B 不后向支配 A，则从 B 沿后向支配树向上走到
+ * ipdom(A)（不含），路径上的块都控制依赖于 A 的终结指令。
+ * 参见 Cytron et al. "Efficiently computing static single assignment form
+ * and the control dependence graph".
+ */
+void PostDominators::create_control_dependence(Function *f) {
+    for (auto &bb1 : f->get_basic_blocks()) {
+        auto a = &bb1;
+        if (not is_reachable_to_exit(a))
+            continue;
+        auto stop = get_ipdom(a);
+        for (auto b : a->get_succ_basic_blocks()) {
+            if (not is_reachable_to_exit(b))
+                continue;
+            for (auto runner = b; runner != stop; runner = get_ipdom(runner)) {
+                control_dep_[runner].insert(a);
+                control_dep_succ_[a].insert(runner);
+            }
+        }
+    }
+}
+
+void PostDominators::print_ipdom(Function *f) {
+    f->get_parent()->set_print_name();
+    printf("Immediate post dominance of function %s:\n", f->get_name().c_str());
+    for (auto &bb1 : f->get_basic_blocks()) {
+        auto bb = &bb1;
+        std::string output = bb->get_name() + ": ";
+        if (not is_reachable_to_exit(bb))
+            output += "null";
+        else if (get_ipdom(bb) == nullptr)
+            output += "exit";
+        else
+            output += get_ipdom(bb)->get_name();
+        printf("%s\n", output.c_str());
+    }
+}
+
+void PostDominators::print_control_dependence(Function *f) {
+    f->get_parent()->set_print_name();
+    printf("Control dependence of function %s:\n", f->get_name().c_str());
+    for (auto &bb1 : f->get_basic_blocks()) {
+        auto bb = &bb1;
+        std::string output = bb->get_name() + ": ";
+        if (get_control_dependence(bb).empty()) {
+            output += "null";
+        } else {
+            bool first = true;
+            for (auto dep : get_control_dependence(bb)) {
+                if (not first)
+                    output += ", ";
+                first = false;
+                output += dep->get_name();
+            }
+        }
+        printf("%s\n", output.c_str());
+    }
+}
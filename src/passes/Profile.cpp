@@ -0,0 +1,180 @@
+#include "Profile.hpp"
+#include "Constant.hpp"
+#include "Function.hpp"
+#include "GlobalVariable.hpp"
+#include "logging.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+namespace {
+const std::string COUNTERS_NAME = "__profile_counters";
+const std::string INIT_NAME = "__profile_init";
+const std::string PROFILE_MAGIC = "cminus-profile";
+
+// 块中第一条不是 phi 或 alloca 的指令，计数代码插在它之前
+Instruction *insert_point(BasicBlock *bb) {
+    for (auto &inst : bb->get_instructions())
+        if (not inst.is_phi() and not inst.is_alloca())
+            return &inst;
+    return nullptr;
+}
+} // namespace
+
+ProfileCounters::ProfileCounters(Module *m) {
+    auto mix = [&](unsigned val) { checksum = checksum * 31 + val; };
+    for (auto &f : m->get_functions()) {
+        if (f.is_declaration())
+            continue;
+        mix(f.get_num_basic_blocks());
+        for (auto &bb : f.get_basic_blocks()) {
+            mix(bb.get_succ_basic_blocks().size());
+            // exceptBB 的次数等于进入它的边的次数，由前驱的计数器得到
+            if (not bb.is_except_block())
+                block[&bb] = num++;
+            auto term = bb.is_terminated() ? bb.get_terminator() : nullptr;
+            if (term and term->is_br() and
+                static_cast<BranchInst *>(term)->is_cond_br())
+                taken[&bb] = num++;
+        }
+    }
+}
+
+void ProfileInstrument::run() {
+    ProfileCounters counters(m_);
+    if (counters.num == 0)
+        return;
+    auto i32 = m_->get_int32_type();
+    auto array_ty = m_->get_array_type(i32, counters.num);
+    auto array = GlobalVariable::create(COUNTERS_NAME, m_, array_ty, false,
+                                        ConstantZero::get(array_ty, m_));
+    auto zero = ConstantInt::get(0, m_);
+
+    auto one = ConstantInt::get(1, m_);
+    auto all_ones = ConstantInt::get(-1, m_);
+
+    // counters[idx] += delta（delta 为 0 或 1），插在 pos 之前；
+    // 计数是 32 位的，达到 2^32-1 后不再增加，以免回绕成很小的值
+    auto increment = [&](BasicBlock *bb, Instruction *pos, unsigned idx,
+                         Value *delta) {
+        auto ptr = bb->create_instr_before(pos, [&](BasicBlock *bb) {
+            return GetElementPtrInst::create_gep(
+                array, {zero, ConstantInt::get(static_cast<int>(idx), m_)},
+                bb);
+        });
+        auto old = bb->create_instr_before(pos, [&](BasicBlock *bb) {
+            return LoadInst::create_load(ptr, bb);
+        });
+        auto not_full = bb->create_instr_before(pos, [&](BasicBlock *bb) {
+            return ICmpInst::create_ne(old, all_ones, bb);
+        });
+        Value *inc = bb->create_instr_before(pos, [&](BasicBlock *bb) {
+            return ZextInst::create_zext_to_i32(not_full, bb);
+        });
+        if (delta != one)
+            inc = bb->create_instr_before(pos, [&](BasicBlock *bb) {
+                return IBinaryInst::create_and(inc, delta, bb);
+            });
+        auto sum = bb->create_instr_before(pos, [&](BasicBlock *bb) {
+            return IBinaryInst::create_add(old, inc, bb);
+        });
+        bb->create_instr_before(pos, [&](BasicBlock *bb) {
+            return StoreInst::create_store(sum, ptr, bb);
+        });
+    };
+    for (auto [bb, idx] : counters.block) {
+        auto pos = insert_point(bb);
+        if (pos != nullptr)
+            increment(bb, pos, idx, one);
+    }
+    for (auto [bb, idx] : counters.taken) {
+        auto br = bb->get_terminator();
+        auto taken = bb->create_instr_before(br, [&](BasicBlock *bb) {
+            return ZextInst::create_zext_to_i32(br->get_operand(0), bb);
+        });
+        increment(bb, br, idx, taken);
+    }
+
+    // main 的入口登记计数器数组与校验和
+    std::vector<Type *> params = {m_->get_int32_ptr_type(), i32, i32};
+    auto init = Function::create(
+        m_->get_function_type(m_->get_void_type(), params), INIT_NAME, m_);
+    for (auto &f : m_->get_functions()) {
+        if (f.get_name() != "main" or f.is_declaration())
+            continue;
+        auto entry = f.get_entry_block();
+        auto pos = insert_point(entry);
+        auto base = entry->create_instr_before(pos, [&](BasicBlock *bb) {
+            return GetElementPtrInst::create_gep(array, {zero, zero}, bb);
+        });
+        entry->create_instr_before(pos, [&](BasicBlock *bb) {
+            return CallInst::create_call(
+                init,
+                {base, ConstantInt::get(static_cast<int>(counters.num), m_),
+                 ConstantInt::get(static_cast<int>(counters.checksum), m_)},
+                bb);
+        });
+    }
+    LOG_INFO << "profile instrumentation inserted " << counters.num
+             << " counters";
+}
+
+void ProfileUse::run() {
+    ProfileCounters counters(m_);
+    std::ifstream in(file_);
+    std::string magic;
+    unsigned checksum = 0, num = 0;
+    if (not(in >> magic >> checksum >> num) or magic != PROFILE_MAGIC or
+        checksum != counters.checksum or num != counters.num) {
+        std::cerr << "warning: profile " << file_
+                  << " does not match the input, ignored" << std::endl;
+        return;
+    }
+    std::vector<unsigned long> counts(num);
+    for (auto &count : counts) {
+        if (not(in >> count)) {
+            std::cerr << "warning: profile " << file_
+                      << " is truncated, ignored" << std::endl;
+            return;
+        }
+    }
+
+    for (auto [bb, idx] : counters.block) {
+        auto count = counts[idx];
+        if (bb == bb->get_parent()->get_entry_block())
+            bb->get_parent()->set_entry_count(count);
+        for (auto &inst : bb->get_instructions())
+            if (inst.is_call())
+                static_cast<CallInst *>(&inst)->set_profile_count(count);
+        auto taken = counters.taken.find(bb);
+        if (taken != counters.taken.end()) {
+            auto true_count = std::min(counts[taken->second], count);
+            static_cast<BranchInst *>(bb->get_terminator())
+                ->set_branch_weights(true_count, count - true_count);
+        }
+    }
+    // exceptBB 没有计数器，次数为各前驱跳向它的次数之和
+    for (auto &f : m_->get_functions())
+        for (auto &bb : f.get_basic_blocks()) {
+            if (not bb.is_except_block())
+                continue;
+            unsigned long count = 0;
+            for (auto pred : bb.get_pre_basic_blocks()) {
+                auto pred_count = counts[counters.block.at(pred)];
+                auto taken = counters.taken.find(pred);
+                if (taken == counters.taken.end())
+                    count += pred_count;
+                else if (pred->get_terminator()->get_operand(1) == &bb)
+                    count += std::min(counts[taken->second], pred_count);
+                else
+                    count += pred_count - std::min(counts[taken->second],
+                                                   pred_count);
+            }
+            for (auto &inst : bb.get_instructions())
+                if (inst.is_call())
+                    static_cast<CallInst *>(&inst)->set_profile_count(count);
+        }
+    LOG_INFO << "profile use read " << num << " counters";
+}
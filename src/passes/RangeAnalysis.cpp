@@ -0,0 +1,421 @@
+#include "RangeAnalysis.hpp"
+#include "Constant.hpp"
+#include "Function.hpp"
+#include "PatternMatch.hpp"
+#include "logging.hpp"
+
+#include <algorithm>
+#include <climits>
+#include <cstdlib>
+#include <vector>
+
+using namespace PatternMatch;
+
+namespace {
+// phi 的区间扩大这么多次之后开始放宽
+constexpr unsigned WIDEN_THRESHOLD = 3;
+
+using Range = RangeAnalysis::Range;
+
+// 可能溢出：超出 i32 的范围时取全集
+Range exact(long lo, long hi) {
+    if (lo < INT_MIN or hi > INT_MAX)
+        return Range::full();
+    return {lo, hi};
+}
+
+Instruction::OpID swap_pred(Instruction::OpID op) {
+    switch (op) {
+    case Instruction::lt:
+        return Instruction::gt;
+    case Instruction::le:
+        return Instruction::ge;
+    case Instruction::gt:
+        return Instruction::lt;
+    case Instruction::ge:
+        return Instruction::le;
+    default:
+        return op;
+    }
+}
+
+Instruction::OpID invert_pred(Instruction::OpID op) {
+    switch (op) {
+    case Instruction::lt:
+        return Instruction::ge;
+    case Instruction::le:
+        return Instruction::gt;
+    case Instruction::gt:
+        return Instruction::le;
+    case Instruction::ge:
+        return Instruction::lt;
+    case Instruction::eq:
+        return Instruction::ne;
+    default:
+        return Instruction::eq;
+    }
+}
+
+bool is_tracked(Value *val) {
+    auto type = val->get_type();
+    return type->is_int32_type() or type->is_int1_type();
+}
+} // namespace
+
+Range RangeAnalysis::Range::full() { return {INT_MIN, INT_MAX}; }
+
+Range RangeAnalysis::Range::join(const Range &rhs) const {
+    if (is_empty())
+        return rhs;
+    if (rhs.is_empty())
+        return *this;
+    return {std::min(lo, rhs.lo), std::max(hi, rhs.hi)};
+}
+
+Range RangeAnalysis::Range::intersect(const Range &rhs) const {
+    return {std::max(lo, rhs.lo), std::min(hi, rhs.hi)};
+}
+
+void RangeAnalysis::run() {
+    for (auto &f1 : m_->get_functions()) {
+        auto f = &f1;
+        if (f->is_declaration())
+            continue;
+        run_on_func(f);
+        fold_branches(f);
+    }
+    LOG_INFO << "range analysis folded " << folded_ << " branches";
+}
+
+/**
+ * @brief 求函数中各个值的区间
+ *
+ * 按支配树的先序遍历，定义先于（phi 以外的）使用被访问，
+ * 反复遍历直到没有区间变化。
+ */
+void RangeAnalysis::run_on_func(Function *f) {
+    dominators_->run_on_func(f);
+    ranges_.clear();
+    widen_count_.clear();
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (auto bb : dominators_->get_dom_dfs_order())
+            for (auto &inst : bb->get_instructions())
+                if (is_tracked(&inst))
+                    changed |= update(&inst, evaluate(&inst));
+    }
+}
+
+Range RangeAnalysis::get_range(Value *val) {
+    if (auto c = dynamic_cast<ConstantInt *>(val))
+        return Range::point(c->get_value());
+    if (dynamic_cast<Instruction *>(val) == nullptr)
+        return Range::full();
+    auto it = ranges_.find(val);
+    return it == ranges_.end() ? Range::empty() : it->second;
+}
+
+/**
+ * @brief val 在块 bb 中的区间
+ *
+ * 沿支配树向上，块只有一个前驱时，进入它的那条边支配 bb，
+ * 该边上成立的条件在 bb 中也成立。
+ */
+Range RangeAnalysis::get_range_at(Value *val, BasicBlock *bb) {
+    auto range = get_range(val);
+    if (range.is_empty() or range.is_point())
+        return range;
+    auto entry = bb->get_parent()->get_entry_block();
+    for (auto cur = bb; cur != entry; cur = dominators_->get_idom(cur)) {
+        auto &preds = cur->get_pre_basic_blocks();
+        if (preds.size() != 1)
+            continue;
+        auto br = dynamic_cast<BranchInst *>(preds.front()->get_terminator());
+        if (br == nullptr or not br->is_cond_br() or
+            br->get_operand(1) == br->get_operand(2))
+            continue;
+        range = refine(range, val, br->get_operand(0),
+                       br->get_operand(1) == cur);
+    }
+    return range;
+}
+
+// val 沿边 from -> to 传递时的区间，边不可能被执行时为空
+Range RangeAnalysis::get_edge_range(Value *val, BasicBlock *from,
+                                    BasicBlock *to) {
+    auto range = get_range_at(val, from);
+    auto br = dynamic_cast<BranchInst *>(from->get_terminator());
+    if (range.is_empty() or br == nullptr or not br->is_cond_br() or
+        br->get_operand(1) == br->get_operand(2))
+        return range;
+    bool taken = br->get_operand(1) == to;
+    auto cond = get_range_at(br->get_operand(0), from);
+    if (cond.is_empty() or (cond.is_point() and cond.lo != taken))
+        return Range::empty();
+    return refine(range, val, br->get_operand(0), taken);
+}
+
+/**
+ * @brief 用条件 cond 取值为 taken 这一事实收紧 val 的区间
+ *
+ * 只识别 val 与另一个值直接比较的条件，另一个值取其在整个函数中的区间。
+ */
+Range RangeAnalysis::refine(Range range, Value *val, Value *cond, bool taken) {
+    // 去掉 IRBuilder 生成的 zext 与 ==/!= 0 的往返
+    Value *inner;
+    while (true) {
+        if (match(cond, m_ICmpNE(m_ZExt(m_Value(inner)), m_Zero()))) {
+            cond = inner;
+        } else if (match(cond, m_ICmpEQ(m_ZExt(m_Value(inner)), m_Zero()))) {
+            cond = inner;
+            taken = not taken;
+        } else {
+            break;
+        }
+    }
+    auto cmp = dynamic_cast<ICmpInst *>(cond);
+    if (cmp == nullptr)
+        return range;
+    auto pred = cmp->get_instr_type();
+    Value *other;
+    if (cmp->get_operand(0) == val) {
+        other = cmp->get_operand(1);
+    } else if (cmp->get_operand(1) == val) {
+        other = cmp->get_operand(0);
+        pred = swap_pred(pred);
+    } else {
+        return range;
+    }
+    if (not taken)
+        pred = invert_pred(pred);
+
+    auto bound = get_range(other);
+    if (bound.is_empty())
+        return Range::empty();
+    switch (pred) {
+    case Instruction::lt:
+        range.hi = std::min(range.hi, bound.hi - 1);
+        break;
+    case Instruction::le:
+        range.hi = std::min(range.hi, bound.hi);
+        break;
+    case Instruction::gt:
+        range.lo = std::max(range.lo, bound.lo + 1);
+        break;
+    case Instruction::ge:
+        range.lo = std::max(range.lo, bound.lo);
+        break;
+    case Instruction::eq:
+        range = range.intersect(bound);
+        break;
+    case Instruction::ne:
+        if (bound.is_point() and range.lo == bound.lo)
+            ++range.lo;
+        if (bound.is_point() and range.hi == bound.lo)
+            --range.hi;
+        break;
+    default:
+        break;
+    }
+    return range;
+}
+
+Range RangeAnalysis::evaluate(Instruction *inst) {
+    auto bb = inst->get_parent();
+    if (inst->is_phi()) {
+        auto range = Range::empty();
+        for (auto [val, pre_bb] : static_cast<PhiInst *>(inst)->get_phi_pairs())
+            if (dominators_->is_reachable(pre_bb))
+                range = range.join(get_edge_range(val, pre_bb, bb));
+        return range;
+    }
+    if (inst->is_zext())
+        return get_range_at(inst->get_operand(0), bb);
+    if (inst->isBinary() or inst->is_cmp()) {
+        auto lhs = get_range_at(inst->get_operand(0), bb);
+        auto rhs = get_range_at(inst->get_operand(1), bb);
+        if (lhs.is_empty() or rhs.is_empty())
+            return Range::empty();
+        if (inst->is_cmp())
+            return evaluate_cmp(inst->get_instr_type(), lhs, rhs);
+        return evaluate_binary(inst, lhs, rhs);
+    }
+    if (inst->get_type()->is_int1_type())
+        return {0, 1};
+    return Range::full();
+}
+
+Range RangeAnalysis::evaluate_binary(Instruction *inst, Range lhs, Range rhs) {
+    switch (inst->get_instr_type()) {
+    case Instruction::add:
+        return exact(lhs.lo + rhs.lo, lhs.hi + rhs.hi);
+    case Instruction::sub:
+        return exact(lhs.lo - rhs.hi, lhs.hi - rhs.lo);
+    case Instruction::mul:
+    case Instruction::sdiv: {
+        bool is_mul = inst->get_instr_type() == Instruction::mul;
+        if (not is_mul and rhs.lo <= 0 and rhs.hi >= 0)
+            return Range::full();
+        // 两种运算对每个操作数都是分段单调的，极值在区间端点取得
+        std::vector<long> vals;
+        for (auto a : {lhs.lo, lhs.hi})
+            for (auto b : {rhs.lo, rhs.hi})
+                vals.push_back(is_mul ? a * b : a / b);
+        return exact(*std::min_element(vals.begin(), vals.end()),
+                     *std::max_element(vals.begin(), vals.end()));
+    }
+    case Instruction::srem: {
+        // 与 sdiv 相同，除数可能为 0 时结果未知
+        if (rhs.lo <= 0 and rhs.hi >= 0)
+            return Range::full();
+        // 余数的绝对值小于除数的绝对值，符号与被除数相同
+        auto m = std::max(std::abs(rhs.lo), std::abs(rhs.hi)) - 1;
+        if (lhs.lo >= 0)
+            return {0, std::min(lhs.hi, m)};
+        if (lhs.hi <= 0)
+            return {std::max(lhs.lo, -m), 0};
+        return {-m, m};
+    }
+    case Instruction::shl:
+        if (rhs.is_point() and rhs.lo >= 0 and rhs.lo < 32)
+            return exact(lhs.lo * (1L << rhs.lo), lhs.hi * (1L << rhs.lo));
+        return Range::full();
+    case Instruction::ashr:
+        if (rhs.is_point() and rhs.lo >= 0 and rhs.lo < 32)
+            return {lhs.lo >> rhs.lo, lhs.hi >> rhs.lo};
+        return {std::min(lhs.lo, 0L), std::max(lhs.hi, 0L)};
+    case Instruction::lshr:
+        if (lhs.lo < 0)
+            return Range::full();
+        if (rhs.is_point() and rhs.lo >= 0 and rhs.lo < 32)
+            return {lhs.lo >> rhs.lo, lhs.hi >> rhs.lo};
+        return {0, lhs.hi};
+    case Instruction::and_:
+        if (lhs.lo >= 0 and rhs.lo >= 0)
+            return {0, std::min(lhs.hi, rhs.hi)};
+        if (lhs.lo >= 0)
+            return {0, lhs.hi};
+        if (rhs.lo >= 0)
+            return {0, rhs.hi};
+        return Range::full();
+    case Instruction::or_:
+    case Instruction::xor_: {
+        if (lhs.lo < 0 or rhs.lo < 0)
+            return Range::full();
+        // 结果不超过较大操作数的最高位以下全为 1 的值
+        long mask = 1;
+        while (mask <= std::max(lhs.hi, rhs.hi))
+            mask <<= 1;
+        return {0, mask - 1};
+    }
+    default:
+        return Range::full();
+    }
+}
+
+// 比较的结果：确定成立为 [1, 1]，确定不成立为 [0, 0]，否则为 [0, 1]
+Range RangeAnalysis::evaluate_cmp(Instruction::OpID op, Range lhs, Range rhs) {
+    bool always = false, never = false;
+    switch (op) {
+    case Instruction::lt:
+        always = lhs.hi < rhs.lo;
+        never = lhs.lo >= rhs.hi;
+        break;
+    case Instruction::le:
+        always = lhs.hi <= rhs.lo;
+        never = lhs.lo > rhs.hi;
+        break;
+    case Instruction::gt:
+        always = lhs.lo > rhs.hi;
+        never = lhs.hi <= rhs.lo;
+        break;
+    case Instruction::ge:
+        always = lhs.lo >= rhs.hi;
+        never = lhs.hi < rhs.lo;
+        break;
+    case Instruction::eq:
+    case Instruction::ne:
+        always = lhs.is_point() and rhs.is_point() and lhs.lo == rhs.lo;
+        never = lhs.hi < rhs.lo or rhs.hi < lhs.lo;
+        if (op == Instruction::ne)
+            std::swap(always, never);
+        break;
+    default:
+        break;
+    }
+    if (always)
+        return Range::point(1);
+    if (never)
+        return Range::point(0);
+    return {0, 1};
+}
+
+/**
+ * @brief 更新指令的区间，返回是否变化
+ *
+ * 新区间与旧区间合并，保证区间只会扩大。
+ */
+bool RangeAnalysis::update(Instruction *inst, Range range) {
+    auto it = ranges_.find(inst);
+    if (it == ranges_.end()) {
+        if (range.is_empty())
+            return false;
+        ranges_.emplace(inst, range);
+        return true;
+    }
+    auto &old = it->second;
+    range = range.join(old);
+    if (range == old)
+        return false;
+    if (inst->is_phi() and ++widen_count_[inst] > WIDEN_THRESHOLD) {
+        if (range.lo < old.lo)
+            range.lo = inst->get_type()->is_int1_type() ? 0 : INT_MIN;
+        if (range.hi > old.hi)
+            range.hi = inst->get_type()->is_int1_type() ? 1 : INT_MAX;
+    }
+    old = range;
+    return true;
+}
+
+/**
+ * @brief 改写条件已知的跳转
+ *
+ * 不再被跳转到的后继删去来自本块的 phi 入边；
+ * 它若因此没有前驱且没有后继（数组下标检查的 exceptBB），直接删除。
+ */
+bool RangeAnalysis::fold_branches(Function *f) {
+    bool changed = false;
+    std::vector<BasicBlock *> to_erase;
+    for (auto bb : dominators_->get_dom_dfs_order()) {
+        auto br = dynamic_cast<BranchInst *>(bb->get_terminator());
+        if (br == nullptr or not br->is_cond_br())
+            continue;
+        auto cond = get_range_at(br->get_operand(0), bb);
+        if (not cond.is_point())
+            continue;
+        auto true_bb = static_cast<BasicBlock *>(br->get_operand(1));
+        auto false_bb = static_cast<BasicBlock *>(br->get_operand(2));
+        auto taken = cond.lo ? true_bb : false_bb;
+        auto not_taken = cond.lo ? false_bb : true_bb;
+        bb->erase_instr(br);
+        BranchInst::create_br(taken, bb);
+        ++folded_;
+        changed = true;
+        if (not_taken == taken)
+            continue;
+        for (auto &inst : not_taken->get_instructions()) {
+            if (not inst.is_phi())
+                break;
+            static_cast<PhiInst *>(&inst)->remove_phi_operand(bb);
+        }
+        if (not_taken->get_pre_basic_blocks().empty() and
+            not_taken->get_succ_basic_blocks().empty())
+            to_erase.push_back(not_taken);
+    }
+    for (auto bb : to_erase) {
+        bb->erase_from_parent();
+        delete bb;
+    }
+    return changed;
+}
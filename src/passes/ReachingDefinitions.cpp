@@ -0,0 +1,111 @@
+#include "ReachingDefinitions.hpp"
+#include "BasicBlock.hpp"
+#include "Function.hpp"
+
+/**
+ * @brief 到达定值的数据流方程（前向、并）
+ *
+ * in(B)  = ⋃_{P ∈ pred(B)} out(P)
+ * out(B) = gen(B) ∪ (in(B) - kill(B))
+ */
+struct ReachingDefinitions::Problem {
+    using Domain = BitVector;
+    static constexpr DataFlowDirection direction = DataFlowDirection::Forward;
+
+    ReachingDefinitions &rd;
+
+    Domain top() { return BitVector(rd.stores_.size()); }
+    Domain boundary() { return top(); }
+    void meet(Domain &acc, const Domain &val, BasicBlock *, BasicBlock *) {
+        acc |= val;
+    }
+    Domain transfer(BasicBlock *bb, const Domain &in) {
+        Domain out = in;
+        out.reset(rd.kill_.at(bb));
+        out |= rd.gen_.at(bb);
+        return out;
+    }
+};
+
+void ReachingDefinitions::run() {
+    for (auto &f1 : m_->get_functions()) {
+        auto f = &f1;
+        if (f->is_declaration())
+            continue;
+        run_on_func(f);
+    }
+}
+
+void ReachingDefinitions::run_on_func(Function *f) {
+    stores_.clear();
+    stores_of_addr_.clear();
+    gen_.clear();
+    kill_.clear();
+    in_.clear();
+    out_.clear();
+
+    for (auto &bb : f->get_basic_blocks())
+        for (auto &inst : bb.get_instructions())
+            if (inst.is_store())
+                stores_.push_back(static_cast<StoreInst *>(&inst));
+    unsigned n = stores_.size();
+    for (unsigned i = 0; i < n; ++i) {
+        auto &set = stores_of_addr_[stores_[i]->get_lval()];
+        if (set.size() == 0)
+            set.resize(n);
+        set.set(i);
+    }
+
+    // gen 是块内每个地址的最后一次 store，kill 是写过的地址上的所有 store
+    unsigned idx = 0;
+    for (auto &bb1 : f->get_basic_blocks()) {
+        auto bb = &bb1;
+        auto &gen = gen_[bb];
+        auto &kill = kill_[bb];
+        gen.resize(n);
+        kill.resize(n);
+        for (auto &inst : bb->get_instructions()) {
+            if (not inst.is_store())
+                continue;
+            auto &same_addr =
+                stores_of_addr_.at(static_cast<StoreInst *>(&inst)->get_lval());
+            gen.reset(same_addr);
+            gen.set(idx++);
+            kill |= same_addr;
+        }
+    }
+
+    Problem problem{*this};
+    DataFlowSolver<Problem> solver(problem);
+    solver.solve(f);
+    for (auto &bb1 : f->get_basic_blocks()) {
+        auto bb = &bb1;
+        in_[bb] = solver.get_block_entry(bb);
+        out_[bb] = solver.get_block_exit(bb);
+    }
+}
+
+std::vector<StoreInst *>
+ReachingDefinitions::get_reaching_stores(LoadInst *load) const {
+    auto addr = load->get_lval();
+    auto bb = load->get_parent();
+    // 块内在 load 之前的最后一个同地址 store 直接决定结果
+    auto &insts = bb->get_instructions();
+    auto it = insts.rbegin();
+    while (&*it != load)
+        ++it;
+    for (++it; it != insts.rend(); ++it) {
+        if (it->is_store() and
+            static_cast<StoreInst *>(&*it)->get_lval() == addr)
+            return {static_cast<StoreInst *>(&*it)};
+    }
+
+    std::vector<StoreInst *> res;
+    auto same_addr = stores_of_addr_.find(addr);
+    if (same_addr == stores_of_addr_.end())
+        return res;
+    BitVector reaching = in_.at(bb);
+    reaching &= same_addr->second;
+    reaching.for_each([&](unsigned i) { res.push_back(stores_[i]); });
+    return res;
+}
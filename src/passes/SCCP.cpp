@@ -0,0 +1,214 @@
+#include "SCCP.hpp"
+#include "ConstantFolding.hpp"
+#include "Function.hpp"
+#include "logging.hpp"
+
+#include <vector>
+
+void SCCP::run() {
+    int folded = 0;
+    for (auto &f1 : m_->get_functions()) {
+        auto f = &f1;
+        if (f->is_declaration())
+            continue;
+        folded += run_on_func(f);
+    }
+    LOG_INFO << "sccp changed " << folded << " functions";
+}
+
+/**
+ * @brief 对单个函数执行 SCCP
+ * @return 函数是否被修改
+ *
+ * 两个工作表交替处理：cfg_worklist_ 中是新变为可执行的边，
+ * ssa_worklist_ 中是格值下降过的指令，需要重新访问它们的使用者。
+ */
+bool SCCP::run_on_func(Function *f) {
+    lattice_.clear();
+    executable_blocks_.clear();
+    executable_edges_.clear();
+    cfg_worklist_.clear();
+    ssa_worklist_.clear();
+
+    cfg_worklist_.push_back({nullptr, f->get_entry_block()});
+    while (not cfg_worklist_.empty() or not ssa_worklist_.empty()) {
+        while (not cfg_worklist_.empty()) {
+            auto [from, to] = cfg_worklist_.front();
+            cfg_worklist_.pop_front();
+            // phi 在每条新的可执行入边上都要重新计算
+            for (auto &inst : to->get_instructions()) {
+                if (not inst.is_phi())
+                    break;
+                visit_phi(static_cast<PhiInst *>(&inst));
+            }
+            if (executable_blocks_.insert(to).second) {
+                for (auto &inst : to->get_instructions())
+                    if (not inst.is_phi())
+                        visit(&inst);
+            }
+        }
+        while (not ssa_worklist_.empty()) {
+            auto inst = ssa_worklist_.front();
+            ssa_worklist_.pop_front();
+            for (auto &use : inst->get_use_list()) {
+                auto user = dynamic_cast<Instruction *>(use.val_);
+                if (user and executable_blocks_.count(user->get_parent()))
+                    visit(user);
+            }
+        }
+    }
+    return rewrite(f);
+}
+
+SCCP::LatticeValue SCCP::get_lattice(Value *val) {
+    if (auto c = dynamic_cast<ConstantInt *>(val))
+        return {LatticeValue::Const, c};
+    if (auto c = dynamic_cast<ConstantFP *>(val))
+        return {LatticeValue::Const, c};
+    if (dynamic_cast<Instruction *>(val) == nullptr)
+        return {LatticeValue::Overdefined, nullptr};
+    return lattice_[val];
+}
+
+SCCP::LatticeValue SCCP::meet(const LatticeValue &a, const LatticeValue &b) {
+    if (a.state == LatticeValue::Undef)
+        return b;
+    if (b.state == LatticeValue::Undef)
+        return a;
+    if (a.state == LatticeValue::Const and b.state == LatticeValue::Const and
+        a.value == b.value)
+        return a;
+    return {LatticeValue::Overdefined, nullptr};
+}
+
+// 格值只会下降；下降时通知其使用者
+void SCCP::update(Instruction *inst, LatticeValue new_val) {
+    auto &old_val = lattice_[inst];
+    if (old_val == new_val)
+        return;
+    old_val = new_val;
+    ssa_worklist_.push_back(inst);
+}
+
+void SCCP::mark_edge(BasicBlock *from, BasicBlock *to) {
+    if (executable_edges_.insert({from, to}).second)
+        cfg_worklist_.push_back({from, to});
+}
+
+void SCCP::visit_phi(PhiInst *phi) {
+    if (get_lattice(phi).state == LatticeValue::Overdefined)
+        return;
+    LatticeValue res;
+    for (auto [val, pre_bb] : phi->get_phi_pairs()) {
+        if (executable_edges_.count({pre_bb, phi->get_parent()}) == 0)
+            continue;
+        res = meet(res, get_lattice(val));
+        if (res.state == LatticeValue::Overdefined)
+            break;
+    }
+    update(phi, res);
+}
+
+void SCCP::visit_br(BranchInst *br) {
+    auto bb = br->get_parent();
+    if (not br->is_cond_br()) {
+        mark_edge(bb, static_cast<BasicBlock *>(br->get_operand(0)));
+        return;
+    }
+    auto true_bb = static_cast<BasicBlock *>(br->get_operand(1));
+    auto false_bb = static_cast<BasicBlock *>(br->get_operand(2));
+    auto cond = get_lattice(br->get_operand(0));
+    if (cond.state == LatticeValue::Const) {
+        auto taken = static_cast<ConstantInt *>(cond.value)->get_value()
+                         ? true_bb
+                         : false_bb;
+        mark_edge(bb, taken);
+    } else if (cond.state == LatticeValue::Overdefined) {
+        mark_edge(bb, true_bb);
+        mark_edge(bb, false_bb);
+    }
+}
+
+void SCCP::visit(Instruction *inst) {
+    if (inst->is_phi())
+        return visit_phi(static_cast<PhiInst *>(inst));
+    if (inst->is_br())
+        return visit_br(static_cast<BranchInst *>(inst));
+    if (inst->is_void())
+        return;
+    if (get_lattice(inst).state == LatticeValue::Overdefined)
+        return;
+
+    // 只有纯计算指令可能折叠为常量
+    if (not(inst->isBinary() or inst->is_cmp() or inst->is_fcmp() or
+            inst->is_zext() or inst->is_fp2si() or inst->is_si2fp()))
+        return update(inst, {LatticeValue::Overdefined, nullptr});
+
+    std::vector<Constant *> ops;
+    for (auto op : inst->get_operands()) {
+        auto val = get_lattice(op);
+        if (val.state == LatticeValue::Overdefined)
+            return update(inst, val);
+        if (val.state == LatticeValue::Undef)
+            return;
+        ops.push_back(val.value);
+    }
+    auto folded = constant_fold(inst, ops);
+    if (folded == nullptr)
+        return update(inst, {LatticeValue::Overdefined, nullptr});
+    update(inst, {LatticeValue::Const, folded});
+}
+
+/**
+ * @brief 根据求解结果改写函数
+ *
+ * 1. 可执行块中格值为常量的指令被常量替换并删除
+ * 2. 只有一条出边可执行的条件跳转改写为无条件跳转，
+ *    并从另一个后继的 phi 中删去来自本块的入边
+ */
+bool SCCP::rewrite(Function *f) {
+    bool changed = false;
+    std::vector<Instruction *> to_erase;
+    for (auto &bb : f->get_basic_blocks()) {
+        if (executable_blocks_.count(&bb) == 0)
+            continue;
+        for (auto &inst : bb.get_instructions()) {
+            auto val = get_lattice(&inst);
+            if (val.state != LatticeValue::Const)
+                continue;
+            inst.replace_all_use_with(val.value);
+            to_erase.push_back(&inst);
+        }
+    }
+    for (auto inst : to_erase)
+        inst->get_parent()->erase_instr(inst);
+    changed |= not to_erase.empty();
+
+    for (auto &bb1 : f->get_basic_blocks()) {
+        auto bb = &bb1;
+        if (executable_blocks_.count(bb) == 0 or not bb->is_terminated())
+            continue;
+        auto br = dynamic_cast<BranchInst *>(bb->get_terminator());
+        if (br == nullptr or not br->is_cond_br())
+            continue;
+        auto true_bb = static_cast<BasicBlock *>(br->get_operand(1));
+        auto false_bb = static_cast<BasicBlock *>(br->get_operand(2));
+        bool true_taken = executable_edges_.count({bb, true_bb});
+        bool false_taken = executable_edges_.count({bb, false_bb});
+        if (true_taken == false_taken)
+            continue;
+        auto taken = true_taken ? true_bb : false_bb;
+        auto not_taken = true_taken ? false_bb : true_bb;
+        bb->erase_instr(br);
+        BranchInst::create_br(taken, bb);
+        if (not_taken != taken) {
+            for (auto &inst : not_taken->get_instructions()) {
+                if (not inst.is_phi())
+                    break;
+                static_cast<PhiInst *>(&inst)->remove_phi_operand(bb);
+            }
+        }
+        changed = true;
+    }
+    return changed;
+}
@@ -0,0 +1,448 @@
+#include "ScalarEvolution.hpp"
+#include "AliasAnalysis.hpp"
+#include "Constant.hpp"
+#include "Function.hpp"
+#include "PatternMatch.hpp"
+
+#include <algorithm>
+#include <climits>
+#include <iostream>
+
+using namespace PatternMatch;
+
+ScalarEvolution::Expr
+ScalarEvolution::Expr::operator+(const Expr &rhs) const {
+    auto res = *this;
+    res.constant += rhs.constant;
+    for (auto [val, coeff] : rhs.terms) {
+        if ((res.terms[val] += coeff) == 0)
+            res.terms.erase(val);
+    }
+    return res;
+}
+
+ScalarEvolution::Expr ScalarEvolution::Expr::operator*(long c) const {
+    if (c == 0)
+        return Expr(0);
+    auto res = *this;
+    res.constant *= c;
+    for (auto &[val, coeff] : res.terms)
+        coeff *= c;
+    return res;
+}
+
+void ScalarEvolution::run() {
+    loop_detection_ = std::make_unique<LoopDetection>(m_);
+    loop_detection_->run();
+    loop_info_.clear();
+    for (auto &loop : loop_detection_->get_loops())
+        analyze_loop(loop);
+}
+
+void ScalarEvolution::analyze_loop(std::shared_ptr<Loop> loop) {
+    auto &info = loop_info_[loop.get()];
+    if (loop->get_preheader() == nullptr or loop->get_latch() == nullptr)
+        return;
+    find_induction_vars(loop);
+    if (not compute_backedge_taken_count(loop))
+        info.exiting = nullptr;
+}
+
+/**
+ * @brief 找出 header 中的加法递推
+ *
+ * 先把 header 的所有 phi 当作原子，求来自 latch 的值 next 的表达式；
+ * next = phi + step 且 step 不含任何 header phi 时，phi 是归纳变量。
+ */
+void ScalarEvolution::find_induction_vars(std::shared_ptr<Loop> loop) {
+    auto &info = loop_info_[loop.get()];
+    candidates_.clear();
+    for (auto &inst : loop->get_header()->get_instructions()) {
+        if (not inst.is_phi())
+            break;
+        if (inst.get_type()->is_int32_type() and inst.get_num_operand() == 4)
+            candidates_.push_back(static_cast<PhiInst *>(&inst));
+    }
+
+    for (auto phi : candidates_) {
+        Value *start = nullptr, *next = nullptr;
+        for (auto [val, bb] : phi->get_phi_pairs()) {
+            if (bb == loop->get_preheader())
+                start = val;
+            else if (bb == loop->get_latch())
+                next = val;
+        }
+        Expr start_expr, next_expr;
+        if (start == nullptr or next == nullptr or
+            not get_expr(start, loop, start_expr) or
+            not get_expr(next, loop, next_expr))
+            continue;
+        auto step = next_expr - Expr::value(phi);
+        bool invariant = std::none_of(
+            candidates_.begin(), candidates_.end(),
+            [&](PhiInst *p) { return step.terms.count(p) != 0; });
+        if (invariant)
+            info.ivs.push_back({phi, start_expr, step});
+    }
+    candidates_.clear();
+}
+
+const ScalarEvolution::AddRec *
+ScalarEvolution::get_add_rec(std::shared_ptr<Loop> loop, Value *phi) {
+    auto it = loop_info_.find(loop.get());
+    if (it == loop_info_.end())
+        return nullptr;
+    for (auto &rec : it->second.ivs)
+        if (rec.phi == phi)
+            return &rec;
+    return nullptr;
+}
+
+/**
+ * @brief 求 val 的线性表达式
+ *
+ * 常量、参数与循环外无法再分解的值是原子；循环中的值只能是
+ * 归纳变量，或由加减、乘常量、左移常量组合而成。
+ */
+bool ScalarEvolution::get_expr(Value *val, std::shared_ptr<Loop> loop,
+                               Expr &res) {
+    if (auto c = dynamic_cast<ConstantInt *>(val)) {
+        res = Expr(c->get_value());
+        return true;
+    }
+    if (not val->get_type()->is_int32_type())
+        return false;
+    auto inst = dynamic_cast<Instruction *>(val);
+    if (inst == nullptr) {
+        res = Expr::value(val);
+        return true;
+    }
+    bool in_loop = loop->contains(inst->get_parent());
+    if (inst->is_phi() and in_loop) {
+        auto phi = static_cast<PhiInst *>(inst);
+        if (get_add_rec(loop, phi) == nullptr and
+            std::find(candidates_.begin(), candidates_.end(), phi) ==
+                candidates_.end())
+            return false;
+        res = Expr::value(val);
+        return true;
+    }
+
+    Value *x;
+    Expr lhs, rhs;
+    int c;
+    switch (inst->get_instr_type()) {
+    case Instruction::add:
+    case Instruction::sub:
+        if (not get_expr(inst->get_operand(0), loop, lhs) or
+            not get_expr(inst->get_operand(1), loop, rhs))
+            return false;
+        res = inst->is_add() ? lhs + rhs : lhs - rhs;
+        return true;
+    case Instruction::mul:
+        if (match(inst, m_c_Mul(m_Value(x), m_ConstInt(c))) and
+            get_expr(x, loop, lhs)) {
+            res = lhs * c;
+            return true;
+        }
+        break;
+    case Instruction::shl:
+        if (match(inst, m_Shl(m_Value(x), m_ConstInt(c))) and c >= 0 and
+            c < 31 and get_expr(x, loop, lhs)) {
+            res = lhs * (1l << c);
+            return true;
+        }
+        break;
+    default:
+        break;
+    }
+    if (in_loop)
+        return false;
+    res = Expr::value(inst);
+    return true;
+}
+
+bool ScalarEvolution::evaluate_at(const Expr &expr, std::shared_ptr<Loop> loop,
+                                  const Expr &k, Expr &res) {
+    res = Expr(expr.constant);
+    for (auto [val, coeff] : expr.terms) {
+        auto rec = get_add_rec(loop, val);
+        if (rec == nullptr) {
+            res = res + Expr::value(val) * coeff;
+        } else if (rec->step.is_constant()) {
+            res = res + (rec->start + k * rec->step.constant) * coeff;
+        } else if (k.is_constant()) {
+            res = res + (rec->start + rec->step * k.constant) * coeff;
+        } else {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool ScalarEvolution::get_access_function(Value *ptr,
+                                          std::shared_ptr<Loop> loop,
+                                          Value *&base, Expr &offset) {
+    auto d = AliasAnalysis::decompose(ptr);
+    base = d.base;
+    offset = Expr(d.offset);
+    for (auto [idx, scale] : d.var_indices) {
+        Expr idx_expr;
+        if (not get_expr(idx, loop, idx_expr))
+            return false;
+        offset = offset + idx_expr * scale;
+    }
+    return true;
+}
+
+/**
+ * @brief 把跳转条件化为 “base + stride × k < 0 时留在循环中”
+ * @param stay 留在循环中的后继
+ *
+ * 条件两边之差 d 是 k 的线性函数，按比较的种类变换：
+ *     d < 0;  d <= 0 即 d - 1 < 0;  d > 0 即 -d < 0;  d >= 0 即 -d - 1 < 0
+ */
+bool ScalarEvolution::get_exit_condition(BranchInst *br, BasicBlock *stay,
+                                         std::shared_ptr<Loop> loop,
+                                         ExitCondition &cond) {
+    if (not br->is_cond_br())
+        return false;
+    // 去掉 IRBuilder 生成的 zext 与 != 0 的往返
+    Value *val = br->get_operand(0), *inner;
+    while (match(val, m_ICmpNE(m_ZExt(m_Value(inner)), m_Zero())))
+        val = inner;
+    auto cmp = dynamic_cast<ICmpInst *>(val);
+    if (cmp == nullptr)
+        return false;
+
+    Expr lhs, rhs, at0, at1;
+    if (not get_expr(cmp->get_operand(0), loop, lhs) or
+        not get_expr(cmp->get_operand(1), loop, rhs))
+        return false;
+    auto diff = lhs - rhs;
+    if (not evaluate_at(diff, loop, Expr(0), at0) or
+        not evaluate_at(diff, loop, Expr(1), at1))
+        return false;
+    auto stride = at1 - at0;
+
+    auto pred = cmp->get_instr_type();
+    if (br->get_operand(1) != stay) {
+        switch (pred) {
+        case Instruction::lt:
+            pred = Instruction::ge;
+            break;
+        case Instruction::le:
+            pred = Instruction::gt;
+            break;
+        case Instruction::gt:
+            pred = Instruction::le;
+            break;
+        case Instruction::ge:
+            pred = Instruction::lt;
+            break;
+        default:
+            return false;
+        }
+    }
+    switch (pred) {
+    case Instruction::lt:
+        cond = {at0, stride, lhs, rhs};
+        return true;
+    case Instruction::le:
+        cond = {at0 - Expr(1), stride, lhs, rhs};
+        return true;
+    case Instruction::gt:
+        cond = {at0 * -1, stride * -1, lhs, rhs};
+        return true;
+    case Instruction::ge:
+        cond = {at0 * -1 - Expr(1), stride * -1, lhs, rhs};
+        return true;
+    default:
+        return false;
+    }
+}
+
+/**
+ * @brief preheader 之前的守卫是否保证 base - stride < 0
+ *
+ * LoopRotate 把 header 的判断以归纳变量的初值复制为守卫，
+ * 守卫的条件正是退出条件在第 -1 次迭代时的取值。
+ */
+bool ScalarEvolution::is_guarded(std::shared_ptr<Loop> loop,
+                                 const ExitCondition &cond) {
+    auto preheader = loop->get_preheader();
+    if (preheader->get_pre_basic_blocks().size() != 1)
+        return false;
+    auto guard = preheader->get_pre_basic_blocks().front();
+    auto br = dynamic_cast<BranchInst *>(guard->get_terminator());
+    ExitCondition guard_cond;
+    if (br == nullptr or
+        not get_exit_condition(br, preheader, loop, guard_cond))
+        return false;
+    return guard_cond.stride == Expr(0) and
+           guard_cond.base == cond.base - cond.stride;
+}
+
+/**
+ * @brief 比较的两个操作数在各次判断中是否都不越出 i32 的范围
+ * @param k 回边执行次数
+ * @param nonneg k 是否已知非负；否则 k 为负时只有第 0 次判断
+ *
+ * 运行时的加法按 i32 回绕，而 Expr 按精确的整数计算。单个的值（系数为 1）
+ * 与 i32 范围内的常量按两种方式计算相同；操作数是迭代次数的线性函数，
+ * 在第 k 次迭代与第 0 次（k 非负时也可以是守卫所在的第 -1 次）迭代
+ * 都是这样的形式时，
+ * 中间的迭代也不越界，两者才一致。否则例如 i = i + 2 越过 INT_MAX 后
+ * 变为负数，或 i <= n 在 n 为 INT_MAX 时，循环实际上不会退出。
+ */
+bool ScalarEvolution::fits_at(const ExitCondition &cond,
+                              std::shared_ptr<Loop> loop, const Expr &k,
+                              bool nonneg) {
+    auto fits = [&](const Expr &operand, const Expr &iter) {
+        Expr res;
+        if (not evaluate_at(operand, loop, iter, res))
+            return false;
+        if (res.is_constant())
+            return res.constant >= INT_MIN and res.constant <= INT_MAX;
+        return res.constant == 0 and res.terms.size() == 1 and
+               res.terms.begin()->second == 1;
+    };
+    for (auto &operand : {cond.lhs, cond.rhs})
+        if (not fits(operand, k) or
+            not (fits(operand, Expr(0)) or
+                 (nonneg and fits(operand, Expr(-1)))))
+            return false;
+    return true;
+}
+
+bool ScalarEvolution::compute_backedge_taken_count(std::shared_ptr<Loop> loop) {
+    auto &info = loop_info_[loop.get()];
+    // 只跳向 exceptBB 的 exiting 块结束整个程序，不影响循环正常执行的次数
+    std::vector<BasicBlock *> exiting;
+    for (auto bb : loop->get_exiting_blocks()) {
+        auto &succs = bb->get_succ_basic_blocks();
+        if (std::any_of(succs.begin(), succs.end(), [&](BasicBlock *succ) {
+                return not loop->contains(succ) and not succ->is_except_block();
+            }))
+            exiting.push_back(bb);
+    }
+    if (exiting.size() != 1)
+        return false;
+    auto bb = exiting[0];
+    if (bb != loop->get_header() and bb != loop->get_latch())
+        return false;
+    auto br = dynamic_cast<BranchInst *>(bb->get_terminator());
+    if (br == nullptr or not br->is_cond_br())
+        return false;
+    auto stay = static_cast<BasicBlock *>(br->get_operand(1));
+    if (not loop->contains(stay))
+        stay = static_cast<BasicBlock *>(br->get_operand(2));
+
+    ExitCondition cond;
+    if (not get_exit_condition(br, stay, loop, cond))
+        return false;
+    if (not cond.stride.is_constant() or cond.stride.constant <= 0)
+        return false;
+    auto stride = cond.stride.constant;
+
+    if (cond.base.is_constant()) {
+        auto dist = -cond.base.constant;
+        long count = dist <= 0 ? 0 : (dist + stride - 1) / stride;
+        if (count > INT_MAX or not fits_at(cond, loop, Expr(count), true))
+            return false;
+        info.backedge_taken = Expr(count);
+    } else {
+        info.clamped = not is_guarded(loop, cond);
+        if (stride != 1 or
+            not fits_at(cond, loop, cond.base * -1, not info.clamped))
+            return false;
+        info.backedge_taken = cond.base * -1;
+    }
+    info.exiting = bb;
+    return true;
+}
+
+bool ScalarEvolution::get_backedge_taken_count(std::shared_ptr<Loop> loop,
+                                               Expr &res) {
+    auto &info = loop_info_.at(loop.get());
+    if (info.exiting == nullptr or info.clamped)
+        return false;
+    res = info.backedge_taken;
+    return true;
+}
+
+bool ScalarEvolution::get_clamped_backedge_taken_count(
+    std::shared_ptr<Loop> loop, Expr &res) {
+    auto &info = loop_info_.at(loop.get());
+    if (info.exiting == nullptr)
+        return false;
+    res = info.backedge_taken;
+    return true;
+}
+
+long ScalarEvolution::get_constant_trip_count(std::shared_ptr<Loop> loop) {
+    Expr count;
+    if (not get_backedge_taken_count(loop, count) or not count.is_constant())
+        return 0;
+    return count.constant + 1;
+}
+
+// 在 pos 之前生成计算 expr 的指令
+Value *ScalarEvolution::expand(const Expr &expr, Instruction *pos) {
+    auto bb = pos->get_parent();
+    auto create = [&](Instruction::OpID op, Value *lhs, Value *rhs) {
+        return bb->create_instr_before(pos, [&](BasicBlock *bb) {
+            switch (op) {
+            case Instruction::add:
+                return IBinaryInst::create_add(lhs, rhs, bb);
+            case Instruction::sub:
+                return IBinaryInst::create_sub(lhs, rhs, bb);
+            default:
+                return IBinaryInst::create_mul(lhs, rhs, bb);
+            }
+        });
+    };
+    // 常量按 i32 回绕，与运行时的补码运算一致
+    auto constant = [&](long c) {
+        return ConstantInt::get(static_cast<int>(c), m_);
+    };
+
+    Value *res = nullptr;
+    for (auto [val, coeff] : expr.terms) {
+        if (coeff == -1) {
+            res = create(Instruction::sub, res ? res : constant(0), val);
+            continue;
+        }
+        Value *term =
+            coeff == 1 ? val : create(Instruction::mul, val, constant(coeff));
+        res = res ? create(Instruction::add, res, term) : term;
+    }
+    if (res == nullptr)
+        return constant(expr.constant);
+    if (static_cast<int>(expr.constant) != 0)
+        res = create(Instruction::add, res, constant(expr.constant));
+    return res;
+}
+
+void ScalarEvolution::print() {
+    m_->set_print_name();
+    auto print_expr = [](const Expr &e) {
+        std::string res;
+        for (auto [val, coeff] : e.terms)
+            res += std::to_string(coeff) + "*%" + val->get_name() + " + ";
+        return res + std::to_string(e.constant);
+    };
+    std::cerr << "Scalar Evolution Result:" << std::endl;
+    for (auto &loop : loop_detection_->get_loops()) {
+        std::cerr << "Loop header: " << loop->get_header()->get_name()
+                  << std::endl;
+        for (auto &rec : get_induction_vars(loop))
+            std::cerr << "  %" << rec.phi->get_name() << " = {"
+                      << print_expr(rec.start) << ",+,"
+                      << print_expr(rec.step) << "}" << std::endl;
+        Expr count;
+        if (get_backedge_taken_count(loop, count))
+            std::cerr << "  backedge taken count: " << print_expr(count)
+                      << std::endl;
+    }
+}
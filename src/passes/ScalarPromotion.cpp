@@ -0,0 +1,219 @@
+#include "ScalarPromotion.hpp"
+#include "CFGUtil.hpp"
+#include "Function.hpp"
+#include "LoopSimplify.hpp"
+#include "logging.hpp"
+
+#include <algorithm>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace {
+// 去掉重复的前驱（两个目标相同的条件跳转）
+std::vector<BasicBlock *> unique_preds(BasicBlock *bb) {
+    std::vector<BasicBlock *> preds;
+    for (auto pred : bb->get_pre_basic_blocks())
+        if (std::find(preds.begin(), preds.end(), pred) == preds.end())
+            preds.push_back(pred);
+    return preds;
+}
+
+Value *get_pointer(Instruction *inst) {
+    return inst->is_load() ? static_cast<LoadInst *>(inst)->get_lval()
+                           : static_cast<StoreInst *>(inst)->get_lval();
+}
+} // namespace
+
+void ScalarPromotion::run() {
+    LoopSimplify(m_).run();
+    loop_detection_ = std::make_unique<LoopDetection>(m_);
+    loop_detection_->run();
+    alias_analysis_->run();
+    Function *func = nullptr;
+    // 同一函数中内层循环在前
+    for (auto &loop : loop_detection_->get_loops()) {
+        if (not loop->is_simplified())
+            continue;
+        auto f = loop->get_header()->get_parent();
+        if (f != func) {
+            // 提升不改变 CFG，支配树与逆后序在函数内一直有效
+            dominators_->run_on_func(f);
+            rpo_ = reverse_post_order(f);
+            func = f;
+        }
+        run_on_loop(loop);
+    }
+    LOG_INFO << "scalar promotion promoted " << promoted_ << " locations";
+}
+
+void ScalarPromotion::run_on_loop(std::shared_ptr<Loop> loop) {
+    loads_stores_.clear();
+    calls_.clear();
+    std::vector<Value *> candidates;
+    for (auto bb : loop->get_blocks()) {
+        for (auto &inst : bb->get_instructions()) {
+            if (inst.is_load() or inst.is_store())
+                loads_stores_.push_back(&inst);
+            else if (inst.is_call())
+                calls_.push_back(static_cast<CallInst *>(&inst));
+            if (not inst.is_store())
+                continue;
+            auto ptr = get_pointer(&inst);
+            auto def = dynamic_cast<Instruction *>(ptr);
+            if ((def == nullptr or not loop->contains(def->get_parent())) and
+                std::find(candidates.begin(), candidates.end(), ptr) ==
+                    candidates.end())
+                candidates.push_back(ptr);
+        }
+    }
+
+    for (auto ptr : candidates) {
+        std::vector<Instruction *> accesses;
+        if (not can_promote(loop, ptr, accesses))
+            continue;
+        promote(loop, ptr, accesses);
+        ++promoted_;
+        std::unordered_set<Instruction *> removed(accesses.begin(),
+                                                  accesses.end());
+        loads_stores_.erase(
+            std::remove_if(loads_stores_.begin(), loads_stores_.end(),
+                           [&](auto inst) { return removed.count(inst); }),
+            loads_stores_.end());
+    }
+}
+
+/**
+ * @brief 检查能否提升 ptr 指向的位置
+ * @param accesses 返回循环中访问该位置的 load/store
+ */
+bool ScalarPromotion::can_promote(std::shared_ptr<Loop> loop, Value *ptr,
+                                  std::vector<Instruction *> &accesses) {
+    auto type = ptr->get_type()->get_pointer_element_type();
+    if (not type->is_int32_type() and not type->is_float_type())
+        return false;
+    // 只要进入循环就一定执行：所在块支配 latch 与所有 exiting 块
+    auto guaranteed_to_execute = [&](BasicBlock *bb) {
+        auto &exiting = loop->get_exiting_blocks();
+        return dominators_->is_dominate(bb, loop->get_latch()) and
+               std::all_of(exiting.begin(), exiting.end(), [&](auto exit) {
+                   return dominators_->is_dominate(bb, exit);
+               });
+    };
+    bool safe = alias_analysis_->is_known_dereferenceable(ptr);
+    for (auto inst : loads_stores_) {
+        auto res = alias_analysis_->alias(get_pointer(inst), ptr);
+        if (res == AliasResult::NoAlias)
+            continue;
+        if (res == AliasResult::MayAlias)
+            return false;
+        accesses.push_back(inst);
+        if (not safe and guaranteed_to_execute(inst->get_parent()))
+            safe = true;
+    }
+    for (auto call : calls_)
+        if (alias_analysis_->get_mod_ref(call, ptr) != NoModRef)
+            return false;
+    return safe;
+}
+
+/**
+ * @brief 把 accesses 改为对 SSA 值的读写
+ *
+ * 按逆后序遍历循环的块，块的入口值来自其 phi 或唯一的前驱，
+ * 回边与内层循环的回边在全部块处理完之后补到 phi 上。
+ */
+void ScalarPromotion::promote(std::shared_ptr<Loop> loop, Value *ptr,
+                              const std::vector<Instruction *> &accesses) {
+    auto type = ptr->get_type()->get_pointer_element_type();
+    auto preheader = loop->get_preheader();
+    auto init = preheader->create_instr_before(
+        preheader->get_terminator(),
+        [&](BasicBlock *bb) { return LoadInst::create_load(ptr, bb); });
+
+    std::unordered_map<BasicBlock *, PhiInst *> phis;
+    for (auto bb : loop->get_blocks()) {
+        if (unique_preds(bb).size() < 2)
+            continue;
+        auto phi = PhiInst::create_phi(type, bb);
+        bb->add_instr_begin(phi);
+        phis[bb] = phi;
+    }
+
+    std::unordered_set<Instruction *> access_set(accesses.begin(),
+                                                 accesses.end());
+    std::unordered_map<BasicBlock *, Value *> value_out;
+    // 不可达的前驱取初值即可
+    auto out = [&](BasicBlock *bb) -> Value * {
+        auto it = value_out.find(bb);
+        return it == value_out.end() ? init : it->second;
+    };
+    for (auto bb : rpo_) {
+        if (not loop->contains(bb))
+            continue;
+        Value *cur = phis.count(bb)
+                         ? static_cast<Value *>(phis.at(bb))
+                         : out(bb->get_pre_basic_blocks().front());
+        auto &insts = bb->get_instructions();
+        for (auto it = insts.begin(); it != insts.end();) {
+            auto inst = &*it++;
+            if (not access_set.count(inst))
+                continue;
+            if (inst->is_load())
+                inst->replace_all_use_with(cur);
+            else
+                cur = inst->get_operand(0);
+            bb->erase_instr(inst);
+        }
+        value_out[bb] = cur;
+    }
+    for (auto [bb, phi] : phis)
+        for (auto pred : unique_preds(bb))
+            phi->add_phi_pair_operand(out(pred), pred);
+
+    // 出口块开头写回；exceptBB 之后程序直接结束，不需要写回
+    for (auto exit : loop->get_exit_blocks()) {
+        if (exit->is_except_block())
+            continue;
+        auto preds = unique_preds(exit);
+        Value *val = out(preds.front());
+        if (preds.size() > 1) {
+            auto phi = PhiInst::create_phi(type, exit);
+            for (auto pred : preds)
+                phi->add_phi_pair_operand(out(pred), pred);
+            exit->add_instr_begin(phi);
+            val = phi;
+        }
+        auto pos = std::find_if(
+            exit->get_instructions().begin(), exit->get_instructions().end(),
+            [](auto &inst) { return not inst.is_phi(); });
+        exit->create_instr_before(&*pos, [&](BasicBlock *bb) {
+            return StoreInst::create_store(val, ptr, bb);
+        });
+    }
+
+    // 所有入边取值相同（不计自身）的 phi 替换为该值
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (auto it = phis.begin(); it != phis.end();) {
+            auto [bb, phi] = *it;
+            Value *same = nullptr;
+            bool trivial = true;
+            for (auto [val, pred] : phi->get_phi_pairs()) {
+                if (val == phi or val == same)
+                    continue;
+                if (same != nullptr)
+                    trivial = false;
+                same = val;
+            }
+            if (not trivial or same == nullptr) {
+                ++it;
+                continue;
+            }
+            phi->replace_all_use_with(same);
+            bb->erase_instr(phi);
+            it = phis.erase(it);
+            changed = true;
+        }
+    }
+}
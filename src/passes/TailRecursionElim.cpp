@@ -0,0 +1,181 @@
+#include "TailRecursionElim.hpp"
+#include "AliasAnalysis.hpp"
+#include "Constant.hpp"
+#include "Function.hpp"
+#include "logging.hpp"
+
+void TailRecursionElim::run() {
+    call_graph_.run();
+    for (auto &f : m_->get_functions()) {
+        if (f.is_declaration())
+            continue;
+        if (run_on_func(&f))
+            ++eliminated_;
+    }
+    LOG_INFO << "tail recursion eliminated in " << eliminated_
+             << " functions";
+}
+
+// 实参是否可能指向函数自己的局部变量
+bool TailRecursionElim::may_pass_local(CallInst *call) {
+    for (unsigned i = 1; i < call->get_num_operand(); ++i) {
+        auto arg = call->get_operand(i);
+        if (not arg->get_type()->is_pointer_type())
+            continue;
+        auto obj = AliasAnalysis::get_underlying_object(arg);
+        auto inst = dynamic_cast<Instruction *>(obj);
+        if (obj == nullptr or (inst and inst->is_alloca()))
+            return true;
+    }
+    return false;
+}
+
+/**
+ * @brief 判断 bb 是否以对自身的尾调用结束
+ *
+ * 调用与 ret 之间只能有无副作用的指令，且只有累加指令使用调用结果；
+ * 累加指令只被 ret 使用。函数会写内存时，调用之后的 load 不能提前。
+ */
+bool TailRecursionElim::find_tail_call(BasicBlock *bb, TailCall &tail_call) {
+    if (not bb->is_terminated() or not bb->get_terminator()->is_ret())
+        return false;
+    auto ret = static_cast<ReturnInst *>(bb->get_terminator());
+    auto f = bb->get_parent();
+
+    CallInst *call = nullptr;
+    std::vector<Instruction *> between;
+    auto &insts = bb->get_instructions();
+    for (auto it = ret->getIterator(); it != insts.begin();) {
+        auto inst = &*--it;
+        if (inst->is_call()) {
+            if (inst->get_operand(0) != f)
+                return false;
+            call = static_cast<CallInst *>(inst);
+            break;
+        }
+        if (inst->is_store() or
+            (inst->is_load() and not call_graph_.is_readonly(f)))
+            return false;
+        between.push_back(inst);
+    }
+    if (call == nullptr or may_pass_local(call))
+        return false;
+
+    tail_call = {call, nullptr};
+    if (ret->is_void_ret())
+        return true;
+    auto ret_val = ret->get_operand(0);
+    if (ret_val == call)
+        return call->get_use_list().size() == 1;
+
+    // 累加形式：ret (call op k)
+    auto acc = dynamic_cast<Instruction *>(ret_val);
+    if (acc == nullptr or not(acc->is_add() or acc->is_mul()) or
+        acc->get_parent() != bb or acc->get_use_list().size() != 1 or
+        call->get_use_list().size() != 1)
+        return false;
+    if ((acc->get_operand(0) == call) == (acc->get_operand(1) == call))
+        return false;
+    tail_call = {call, acc};
+    return true;
+}
+
+/**
+ * @brief 把函数中的尾调用改写为循环
+ * @return 是否改写
+ */
+bool TailRecursionElim::run_on_func(Function *f) {
+    std::vector<TailCall> tail_calls;
+    std::vector<ReturnInst *> other_rets;
+    // 所有累加形式的尾调用须使用同一种运算，其余的调用保持不变
+    Instruction::OpID acc_op = Instruction::ret;
+    for (auto &bb : f->get_basic_blocks()) {
+        TailCall tail_call;
+        if (find_tail_call(&bb, tail_call)) {
+            auto op = tail_call.acc_inst ? tail_call.acc_inst->get_instr_type()
+                                         : acc_op;
+            if (acc_op == Instruction::ret or op == acc_op) {
+                acc_op = op;
+                tail_calls.push_back(tail_call);
+                continue;
+            }
+        }
+        if (bb.is_terminated() and bb.get_terminator()->is_ret())
+            other_rets.push_back(static_cast<ReturnInst *>(bb.get_terminator()));
+    }
+    if (tail_calls.empty())
+        return false;
+
+    // 新的入口块只保留 alloca，原入口块成为循环头
+    auto m = f->get_parent();
+    auto header = f->get_entry_block();
+    auto entry = BasicBlock::create(m, "", f);
+    f->get_basic_blocks().remove(entry);
+    f->get_basic_blocks().push_front(entry);
+    for (auto it = header->get_instructions().begin();
+         it != header->get_instructions().end();) {
+        auto inst = &*it++;
+        if (not inst->is_alloca())
+            continue;
+        header->remove_instr(inst);
+        inst->set_parent(entry);
+        entry->add_instruction(inst);
+    }
+    BranchInst::create_br(header, entry);
+
+    std::vector<PhiInst *> arg_phis;
+    for (auto &arg : f->get_args()) {
+        auto phi = PhiInst::create_phi(arg.get_type(), header);
+        arg.replace_all_use_with(phi);
+        phi->add_phi_pair_operand(&arg, entry);
+        arg_phis.push_back(phi);
+    }
+    PhiInst *acc_phi = nullptr;
+    if (acc_op == Instruction::add or acc_op == Instruction::mul) {
+        auto identity = ConstantInt::get(acc_op == Instruction::add ? 0 : 1, m);
+        acc_phi = PhiInst::create_phi(f->get_return_type(), header);
+        acc_phi->add_phi_pair_operand(identity, entry);
+    }
+    // 按参数顺序排在块首
+    if (acc_phi)
+        header->add_instr_begin(acc_phi);
+    for (auto phi = arg_phis.rbegin(); phi != arg_phis.rend(); ++phi)
+        header->add_instr_begin(*phi);
+
+    auto accumulate = [&](Value *val, Instruction *pos) -> Value * {
+        return pos->get_parent()->create_instr_before(
+            pos, [&](BasicBlock *bb) {
+                return acc_op == Instruction::add
+                           ? IBinaryInst::create_add(acc_phi, val, bb)
+                           : IBinaryInst::create_mul(acc_phi, val, bb);
+            });
+    };
+
+    for (auto &tail_call : tail_calls) {
+        auto call = tail_call.call;
+        auto bb = call->get_parent();
+        auto ret = bb->get_terminator();
+        for (unsigned i = 0; i < arg_phis.size(); ++i)
+            arg_phis[i]->add_phi_pair_operand(call->get_operand(i + 1), bb);
+        if (acc_phi) {
+            Value *next = acc_phi;
+            if (auto acc = tail_call.acc_inst) {
+                // 参数已被替换为 phi，这里重新读取累加的另一个操作数
+                auto k = acc->get_operand(acc->get_operand(0) == call ? 1 : 0);
+                next = accumulate(k, ret);
+            }
+            acc_phi->add_phi_pair_operand(next, bb);
+        }
+        bb->erase_instr(ret);
+        if (tail_call.acc_inst)
+            bb->erase_instr(tail_call.acc_inst);
+        bb->erase_instr(call);
+        BranchInst::create_br(header, bb);
+    }
+
+    // 其余的返回点返回 v op 累加值
+    if (acc_phi)
+        for (auto ret : other_rets)
+            ret->set_operand(0, accumulate(ret->get_operand(0), ret));
+    return true;
+}
@@ -0,0 +1,18 @@
+#!/bin/sh
+# 检查 for_loop.cminus 中 f 的循环被版本化：
+# 循环体（store）被复制为两份，下标与 0 的比较只剩原循环中的检查
+# 与 preheader 中对 n 的判断，副本中的检查已被删去
+set -e
+cminusfc=$1
+src=$(dirname "$0")/for_loop.cminus
+out=${TMPDIR:-/tmp}/loop_versioning_for_loop.$$.ll
+trap 'rm -f "$out"' EXIT
+"$cminusfc" -emit-llvm -mem2reg -loop-versioning "$src" -o "$out"
+f=$(sed -n '/^define void @f(/,/^}/p' "$out")
+stores=$(echo "$f" | grep -c 'store i32')
+checks=$(echo "$f" | grep -c 'icmp slt i32 %[a-z0-9]*, 0$')
+if [ "$stores" -ne 2 ] || [ "$checks" -ne 2 ]; then
+    echo "expected 2 stores and 2 checks against 0, got $stores and $checks"
+    echo "$f"
+    exit 1
+fi